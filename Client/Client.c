@@ -16,6 +16,7 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
@@ -143,7 +144,7 @@ int pollServer(int sockfd, char *ip, int port)
         {
             sleep(SLEEP_TIME);
             printf("[-]recv: Error in receiving Client ID.Retrying\n");
-            iRecvStatus = recv(sockfd, &iClientID, sizeof(int), 0);
+            iRecvStatus = RecvID(sockfd, &iClientID);
             if (iRecvStatus == 0)
             {
                 printf(RED "[-]Client: Connection to server failed\n" reset);
@@ -152,6 +153,11 @@ int pollServer(int sockfd, char *ip, int port)
             }
         } while (CheckError(iRecvStatus, "[-]Error in receiving Client ID"));
 
+        // Replies parked for the old connection will never be awaited
+        DiscardPendingReplies();
+        // Revocations may have been missed while disconnected
+        LeaseFlush();
+
         printf(GRN "[+]pollServer: Reconnected to the server with ID-%lu\n" reset, iClientID);
         fprintf(Clientlog, "[+]pollServer: Reconnected to the server with ID-%lu [Time Stamp: %f]\n", iClientID, GetCurrTime(Clock));
     }
@@ -290,7 +296,7 @@ int main(int argc, char *argv[])
     fprintf(Clientlog, "[+]Connected to the server [Time Stamp: %f]\n", GetCurrTime(Clock));
 
     // Connection established, receive identification ID (Client ID)
-    int iRecvStatus = recv(iClientSocket, &iClientID, sizeof(unsigned long), 0);
+    int iRecvStatus = RecvID(iClientSocket, &iClientID);
     printf("[+]Getting ID from Server\n");
 
     if (CheckError(iRecvStatus, "[-]recv: Error in receiving Client ID"))
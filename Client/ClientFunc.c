@@ -7,6 +7,7 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 #include "Headers.h"
 #include "Hash.h"
@@ -36,8 +37,8 @@ void Ecmd(char* arg, int ServerSockfd)
     req.iRequestOperation = CLOSE_CONNECTION;
     req.iRequestClientID = iClientID;
 
-    int err = send(ServerSockfd, &req, sizeof(REQUEST_STRUCT), 0);
-    if(err < sizeof(REQUEST_STRUCT))
+    int err = SendRequest(ServerSockfd, &req);
+    if(err < 0)
     {
         char* Msg = ErrorMsg("Error in sending request to the server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s"reset"\n", Msg);
@@ -54,6 +55,7 @@ void Ecmd(char* arg, int ServerSockfd)
     printf("Thank you for using this Network File System\n");
 
     fclose(Clientlog);
+    CloseStorageConnections();
     close(ServerSockfd);
     destroyHashTable(table);
     exit(EXIT_SUCCESS);
@@ -80,8 +82,8 @@ void Hcmd(char* arg, int ServerSockfd)
     printf(GRNHB"=====================HELP MENU======================"reset"\n");
     printf(YELB"Avaliable Commands:\n"reset
             BGRN
-            "1. READ <Path>: Reads the file at the given path\n"
-            "2. WRITE <Flag> <Path>: Writes to the file at the given path. Flag can set to either \'O\': Overwrite or to \'A\': Append\n"
+            "1. READ [-r <Offset> <Length>] <Path> [<Path> ...]: Reads the file(s) at the given path(s). With -r only <Length> bytes from <Offset> are read (Length 0: till the end of the file)\n"
+            "2. WRITE <Flag> [<Offset> <Length>] <Path>: Writes to the file at the given path. Flag can set to either \'O\': Overwrite, \'A\': Append or \'P\': Patch <Length> bytes at <Offset> in place\n"
             "3. COPY <Source Path> <Destination Path>: Copies the file(s) from the source path to the destination path (Note: If source path is a Directory, Everthing Under the source path is copied)\n"
             "4. MOVE <Source Path> <Destination Path>: Moves the file(s) from the source path to the destination path (Note: If source path is a Directory, Everthing Under the source path is moved)\n"   
             "5. DELETE <Path>: Deletes the file at the given path (Note: If source path is a Directory, Everthing Under the source path is deleted)\n"
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
@@ -9,62 +10,71 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
 #include "./ErrorCodes.h"
 
-void Rcmd(char* arg, int ServerSockfd)
+/**
+ * @brief Resolves the paths of a command, from leases where possible and with a single batched request for the rest
+ * @param ServerSockfd: The socket connected to the naming server
+ * @param paths: The paths to be resolved
+ * @param count: The number of paths
+ * @param res: Filled with a response (IP and Port of the storage server) for every path
+ * @return: 1 on success, 0 if the server closed the connection, -1 on failure
+ */
+static int ResolvePaths(int ServerSockfd, char* paths[], int count, RESPONSE_STRUCT* res)
 {
-    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: READ <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
-    {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
+    RESOLVE_RESULT_STRUCT results[MAX_PIPELINED_REQUESTS];
+    char* missed[MAX_PIPELINED_REQUESTS];
+    int iMissedIndex[MAX_PIPELINED_REQUESTS];
+    int iMissCount = 0;
 
-    arg = strtok(arg, " \t\n");
-    if(strtok(NULL, " \t\n") != NULL)
+    // Revocations pushed since the last command are applied before trusting a lease
+    PollRevocations(ServerSockfd);
+    for(int i = 0; i < count; i++)
     {
-        fprintf(Clientlog, "[-]Rcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
+        if(LeaseLookup(paths[i], &results[i])) continue;
+        missed[iMissCount] = paths[i];
+        iMissedIndex[iMissCount++] = i;
     }
+    fprintf(Clientlog, "[+]ResolvePaths: %d of %d paths resolved from leases [Time Stamp: %f]\n", count - iMissCount, count, GetCurrTime(Clock));
 
-    char* path = arg;
-    fprintf(Clientlog, "[+]Rcmd: Reading Path %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
-
-    REQUEST_STRUCT req_struct;
-    REQUEST_STRUCT* req = &req_struct;
-    memset(req, 0, sizeof(REQUEST_STRUCT));
-
-    req->iRequestOperation = CMD_READ;
-    req->iRequestClientID = iClientID;
-    strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
-    // req->iRequestFlags = 0;
-
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    if(iMissCount > 0)
     {
-        char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
-        printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
-        free(Msg);
-        return;
+        RESOLVE_RESULT_STRUCT fetched[MAX_PIPELINED_REQUESTS];
+        int iStatus = ResolveBatch(ServerSockfd, missed, iMissCount, fetched);
+        if(iStatus != 1) return iStatus;
+        for(int i = 0; i < iMissCount; i++)
+        {
+            results[iMissedIndex[i]] = fetched[i];
+            LeaseStore(missed[i], &fetched[i]);
+        }
     }
-    
-    RESPONSE_STRUCT res_struct;
-    RESPONSE_STRUCT* res = &res_struct;
-    memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    for(int i = 0; i < count; i++)
     {
-        char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
-        printf(RED"%s"reset, Msg);
-        fprintf(Clientlog, "[-]Rcmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
+        memset(&res[i], 0, sizeof(RESPONSE_STRUCT));
+        res[i].iResponseErrorCode = results[i].iErrorCode;
+        res[i].iResponseFlags = results[i].iFlags;
+        res[i].iResponseServerID = results[i].iServerID;
+        if(results[i].iFlags != RESPONSE_FLAG_FAILURE)
+            snprintf(res[i].sResponseData, MAX_BUFFER_SIZE, "%s %d", results[i].sServerIP, results[i].iServerPort);
     }
-    
+    return 1;
+}
+
+/**
+ * @brief Reads a file from the storage server serving it
+ * @param path: The path as given by the user
+ * @param req: The request resolved by the naming server (forwarded to the storage server)
+ * @param res: The naming server's response (IP and Port of the storage server)
+ */
+static void ReadFromStorageServer(char* path, REQUEST_STRUCT* req, RESPONSE_STRUCT* res)
+{
+    int iBytesSent, iBytesRecv;
+
     if(res->iResponseFlags == RESPONSE_FLAG_FAILURE )
     {
         char* Msg = ErrorMsg("Failed to read file", res->iResponseErrorCode);
@@ -98,86 +108,102 @@ void Rcmd(char* arg, int ServerSockfd)
         return;
     }
 
-    // Connect to the storage server
-    int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
-    {
-        fprintf(Clientlog, "[-]Rcmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-
-    struct sockaddr_in StorageServer;
-    memset(&StorageServer, 0, sizeof(StorageServer));
-    StorageServer.sin_family = AF_INET;
-    StorageServer.sin_addr.s_addr = inet_addr(ip);
-    StorageServer.sin_port = htons(atoi(port));
-    memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
-
-    int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
-    if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
+    // Connect to the storage server (or reuse the session left open by an earlier command)
+    int StorageSockfd = GetStorageConnection(ip, atoi(port));
+    if(StorageSockfd < 0)
     {
         fprintf(Clientlog, "[-]Rcmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LeaseDrop(path);
         return;
     }
 
     // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    iBytesSent = SendRequest(StorageSockfd, req);
+    if(iBytesSent < 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Rcmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
-    // Receive stop sequence from server
-    char stop[MAX_BUFFER_SIZE];
-    iBytesRecv = recv(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesRecv, ErrorMsg("Failed to receive stop sequence from storage server", CMD_ERROR_RECV_FAILED)))
+    // Wait for the storage server to start the stream (or refuse the request)
+    uint32_t ChunkSize = 0;
+    uint64_t TotalLength = STREAM_LENGTH_UNKNOWN;
+    int iStreamStatus = RecvStreamStart(StorageSockfd, &ChunkSize, &TotalLength, res);
+    if(iStreamStatus <= 0)
     {
-        fprintf(Clientlog, "[-]Rcmd: Failed to receive stop sequence from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        char* Msg = ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Rcmd: Failed to receive stream start from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+    else if(iStreamStatus == PACKET_TYPE_RESPONSE)
+    {
+        char* Msg = ErrorMsg("Failed to read file from storage server", res->iResponseErrorCode);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Rcmd: Storage server refused the request: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
+        free(Msg);
+        LeaseDrop(path);
+        ReleaseStorageConnection(StorageSockfd, 1);
         return;
     }
-    // printf("Stop Sequence: %s\n", stop);
 
-    // Receive the File from the storage server in chunks of MAX_BUFFER_SIZE until the server sends a chunk of size less than MAX_BUFFER_SIZE
+    char* buffer = (char*)malloc(ChunkSize);
+    if(CheckNull(buffer, ErrorMsg("Failed to allocate stream buffer", CMD_ERROR_RECV_FAILED)))
+    {
+        fprintf(Clientlog, "[-]Rcmd: Failed to allocate stream buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+
+    // Receive the File from the storage server chunk by chunk until the end of stream frame
     long long int FileSize = 0;
+    uint32_t ChunkLen = 0;
+    int iStreamError = 0;
     printf("File Contents:\n"MAG"----------------------------------------\n");
-    while(1)
+    while((iStreamStatus = RecvChunk(StorageSockfd, buffer, ChunkSize, &ChunkLen, &iStreamError)) > 0)
     {
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-
-        iBytesRecv = recv(StorageSockfd, buffer, MAX_BUFFER_SIZE, 0);
-        if(CheckError(iBytesRecv, ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED)))
-        {
-            fprintf(Clientlog, "[-]Rcmd: Failed to receive file from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
-            return;
-        }
-
-        // Check if the server has sent the stop sequence
-        if(strncmp(buffer, stop, MAX_BUFFER_SIZE) == 0)
-        {
-            break;
-        }
-
         // print the recieved data
-        printf("%s", buffer);
-        FileSize += strlen(buffer);
-
+        fwrite(buffer, 1, ChunkLen, stdout);
+        FileSize += ChunkLen;
     }
-    
+    free(buffer);
+
     printf("\n----------------------------------------\n"reset);
     printf("Read Bytes: %lld Bytes\n", FileSize);
+    if(iStreamStatus < 0)
+    {
+        char* Msg = ErrorMsg("Failed to receive file from storage server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Rcmd: Failed to receive file from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+    else if(iStreamError)
+    {
+        fprintf(Clientlog, "[-]Rcmd: Storage server cut the stream short (Error Code: %d) [Time Stamp: %f]\n", iStreamError, GetCurrTime(Clock));
+    }
+    else if(TotalLength != STREAM_LENGTH_UNKNOWN && (uint64_t)FileSize != TotalLength)
+    {
+        printf(RED"Expected %llu Bytes, received %lld Bytes\n"reset, (unsigned long long)TotalLength, FileSize);
+        fprintf(Clientlog, "[-]Rcmd: Expected %llu Bytes, received %lld Bytes [Time Stamp: %f]\n", (unsigned long long)TotalLength, FileSize, GetCurrTime(Clock));
+    }
+
     // Receive the response from the storage server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = RecvResponse(StorageSockfd, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Rcmd: Failed to receive response from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
@@ -187,20 +213,108 @@ void Rcmd(char* arg, int ServerSockfd)
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Rcmd: Failed to read file from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 1);
         return;
     }
 
     // log the response
     fprintf(Clientlog, "[+]Rcmd: Server Response: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
 
-    // Close the socket
-    close(StorageSockfd);
+    // Keep the session for the next request
+    ReleaseStorageConnection(StorageSockfd, 1);
     fprintf(Clientlog, "[+]Rcmd: Successfully read file [Time Stamp: %f]\n", GetCurrTime(Clock));
     return;
 }
+void Rcmd(char* arg, int ServerSockfd)
+{
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: READ [-r <Offset> <Length>] <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS)))
+    {
+        fprintf(Clientlog, "[-]Rcmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    // Parse the optional byte range (applies to every path)
+    int iFlag = REQUEST_FLAG_NONE;
+    unsigned long long Offset = 0, Length = 0;
+    char* path = strtok(arg, " \t\n");
+    if(path != NULL && strcmp(path, "-r") == 0)
+    {
+        char* sOffset = strtok(NULL, " \t\n");
+        char* sLength = strtok(NULL, " \t\n");
+        char* end1 = NULL;
+        char* end2 = NULL;
+        if(sOffset != NULL) Offset = strtoull(sOffset, &end1, 10);
+        if(sLength != NULL) Length = strtoull(sLength, &end2, 10);
+        if(sOffset == NULL || sLength == NULL || *end1 != '\0' || *end2 != '\0' || sOffset[0] == '-' || sLength[0] == '-')
+        {
+            char* Msg = ErrorMsg("Invalid Range\nUSAGE: READ [-r <Offset> <Length>] <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS_TYPE);
+            printf(RED"%s\n"reset, Msg);
+            fprintf(Clientlog, "[-]Rcmd: Invalid Range [Time Stamp: %f]\n", GetCurrTime(Clock));
+            free(Msg);
+            return;
+        }
+        iFlag = REQUEST_FLAG_RANGE;
+        path = strtok(NULL, " \t\n");
+    }
+
+    // Collect the paths
+    char* paths[MAX_PIPELINED_REQUESTS];
+    int iPathCount = 0;
+    for(; path != NULL; path = strtok(NULL, " \t\n"))
+    {
+        if(iPathCount == MAX_PIPELINED_REQUESTS)
+        {
+            char* Msg = ErrorMsg("Too many paths\nUSAGE: READ [-r <Offset> <Length>] <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
+            printf(RED"%s\n"reset, Msg);
+            fprintf(Clientlog, "[-]Rcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+            free(Msg);
+            return;
+        }
+        paths[iPathCount++] = path;
+    }
+
+    if(iPathCount == 0)
+    {
+        fprintf(Clientlog, "[-]Rcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    // Prepare the request forwarded to the storage server for every path
+    REQUEST_STRUCT reqs[MAX_PIPELINED_REQUESTS];
+    for(int i = 0; i < iPathCount; i++)
+    {
+        fprintf(Clientlog, "[+]Rcmd: Reading Path %s [Time Stamp: %f]\n", paths[i], GetCurrTime(Clock));
+
+        REQUEST_STRUCT* req = &reqs[i];
+        memset(req, 0, sizeof(REQUEST_STRUCT));
+
+        req->iRequestOperation = CMD_READ;
+        req->iRequestClientID = iClientID;
+        req->iRequestFlags = iFlag;
+        req->iRequestOffset = Offset;
+        req->iRequestLength = Length;
+        req->iRequestChunkSize = STREAM_CHUNK_DEFAULT;
+        strncpy(req->sRequestPath, paths[i], MAX_BUFFER_SIZE);
+    }
+
+    // Resolve every path with a single round trip to the naming server
+    RESPONSE_STRUCT res[MAX_PIPELINED_REQUESTS];
+    int iBytesRecv = ResolvePaths(ServerSockfd, paths, iPathCount, res);
+    if(iBytesRecv <= 0)
+    {
+        char* Msg = ErrorMsg("Failed to resolve paths on server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Rcmd: Failed to resolve paths [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        return;
+    }
+
+    for(int i = 0; i < iPathCount; i++)
+        ReadFromStorageServer(paths[i], &reqs[i], &res[i]);
+}
 void Wcmd(char* arg, int ServerSockfd)
 {
-    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: WRITE <Flag> [<Offset> <Length>] <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
         fprintf(Clientlog, "[-]Wcmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
         return;
@@ -211,8 +325,9 @@ void Wcmd(char* arg, int ServerSockfd)
     char* path = strtok(NULL, " \t\n");
 
     // process the flag 
-    // 0 for append(default), 1 for overwrite
+    // 0 for append(default), 1 for overwrite, 3 for a positional write
     int iFlag = REQUEST_FLAG_APPEND; 
+    unsigned long long Offset = 0, Length = 0;
     if(flag != NULL)
     {
         if(strncmp(flag, "a", 1) == 0)
@@ -223,9 +338,29 @@ void Wcmd(char* arg, int ServerSockfd)
         {
             iFlag = REQUEST_FLAG_OVERWRITE;
         }
+        else if(strncmp(flag, "p", 1) == 0)
+        {
+            // The offset and length come before the path
+            char* sOffset = path;
+            char* sLength = strtok(NULL, " \t\n");
+            char* end1 = NULL;
+            char* end2 = NULL;
+            if(sOffset != NULL) Offset = strtoull(sOffset, &end1, 10);
+            if(sLength != NULL) Length = strtoull(sLength, &end2, 10);
+            if(sOffset == NULL || sLength == NULL || *end1 != '\0' || *end2 != '\0' || sOffset[0] == '-' || sLength[0] == '-' || Length == 0)
+            {
+                char* Msg = ErrorMsg("Invalid Range\nUSAGE: WRITE p <Offset> <Length> <Path>", CMD_ERROR_INVALID_ARGUMENTS_TYPE);
+                printf(RED"%s\n"reset, Msg);
+                fprintf(Clientlog, "[-]Wcmd: Invalid Range [Time Stamp: %f]\n", GetCurrTime(Clock));
+                free(Msg);
+                return;
+            }
+            iFlag = REQUEST_FLAG_POSITIONAL;
+            path = strtok(NULL, " \t\n");
+        }
         else
         {
-            char* Msg = ErrorMsg("Invalid Flag\nUSAGE: WRITE <Flag> <Path>\nFlag: a for append, o for overwrite", CMD_ERROR_INVALID_ARGUMENTS);
+            char* Msg = ErrorMsg("Invalid Flag\nUSAGE: WRITE <Flag> [<Offset> <Length>] <Path>\nFlag: a for append, o for overwrite, p to patch <Length> bytes at <Offset>", CMD_ERROR_INVALID_ARGUMENTS);
             printf(RED"%s\n"reset, Msg);
             fprintf(Clientlog, "[-]Wcmd: Invalid Flag [Time Stamp: %f]\n", GetCurrTime(Clock));
             free(Msg);
@@ -235,7 +370,7 @@ void Wcmd(char* arg, int ServerSockfd)
     }
 
     // Check if the path is valid
-    if(CheckNull(path, ErrorMsg("Invalid Path\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
+    if(CheckNull(path, ErrorMsg("Invalid Path\nUSAGE: WRITE <Flag> [<Offset> <Length>] <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
     {
         fprintf(Clientlog, "[-]Wcmd: Invalid Path [Time Stamp: %f]\n", GetCurrTime(Clock));
         return;
@@ -244,7 +379,7 @@ void Wcmd(char* arg, int ServerSockfd)
     // Check if there are any extra arguments
     if(strtok(NULL, " \t\n") != NULL)
     {
-        char* Msg = ErrorMsg("Invalid Argument Count\nUSAGE: WRITE <Flag> <Path>", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
+        char* Msg = ErrorMsg("Invalid Argument Count\nUSAGE: WRITE <Flag> [<Offset> <Length>] <Path>", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
@@ -259,30 +394,23 @@ void Wcmd(char* arg, int ServerSockfd)
     req->iRequestOperation = CMD_WRITE;
     req->iRequestClientID = iClientID;
     req->iRequestFlags = iFlag;
+    req->iRequestOffset = Offset;
+    req->iRequestLength = Length;
+    req->iRequestChunkSize = STREAM_CHUNK_DEFAULT;
     strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
     
-    // Send the request to the server
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
-    {
-        char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
-        printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Wcmd: Failed to send request to server [Time Stamp: %f]\n", GetCurrTime(Clock));
-        free(Msg);
-        return;
-    }
-
-    // Receive the response from the server
+    // Resolve the path (from its lease if the naming server issued one)
     RESPONSE_STRUCT res_struct;
     RESPONSE_STRUCT* res = &res_struct;
-    memset(res, 0, sizeof(RESPONSE_STRUCT));
+    int iBytesSent;
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = ResolvePaths(ServerSockfd, &path, 1, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Failed to receive response from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
         return;
     }
 
@@ -299,7 +427,8 @@ void Wcmd(char* arg, int ServerSockfd)
         printf(YEL"Corresponding Storage Server is down.\n"reset);
         fprintf(Clientlog, "[+]Wcmd: Corresponding Storage Server is down.[Time Stamp: %f]\n", GetCurrTime(Clock));
 
-        char* Msg = ErrorMsg("Failed to write file", res->iResponseErrorCode);
+        // Writes are not sent to backups
+        char* Msg = ErrorMsg("Failed to write file", CMD_ERROR_SERVER_UNAVAILABLE);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Failed to write file [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
@@ -322,89 +451,105 @@ void Wcmd(char* arg, int ServerSockfd)
         return;
     }
 
-    // Connect to the storage server
-    int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
-    {
-        fprintf(Clientlog, "[-]Rcmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-
-    struct sockaddr_in StorageServer;
-    memset(&StorageServer, 0, sizeof(StorageServer));
-    StorageServer.sin_family = AF_INET;
-    StorageServer.sin_addr.s_addr = inet_addr(ip);
-    StorageServer.sin_port = htons(atoi(port));
-    memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
-
-    int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
-    if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
+    // Connect to the storage server (or reuse the session left open by an earlier command)
+    int StorageSockfd = GetStorageConnection(ip, atoi(port));
+    if(StorageSockfd < 0)
     {
         fprintf(Clientlog, "[-]Rcmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LeaseDrop(path);
         return;
     }
 
     // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    iBytesSent = SendRequest(StorageSockfd, req);
+    if(iBytesSent < 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
-    // Receive stop sequence from server
-    char stop[MAX_BUFFER_SIZE];
-    iBytesRecv = recv(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesRecv, ErrorMsg("Failed to receive stop sequence from storage server", CMD_ERROR_RECV_FAILED)))
+    // Wait for the storage server to start the stream (or refuse the request)
+    uint32_t ChunkSize = 0;
+    int iStreamStatus = RecvStreamStart(StorageSockfd, &ChunkSize, NULL, res);
+    if(iStreamStatus <= 0)
     {
-        fprintf(Clientlog, "[-]Wcmd: Failed to receive stop sequence from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        char* Msg = ErrorMsg("Failed to receive stream start from storage server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Wcmd: Failed to receive stream start from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+    else if(iStreamStatus == PACKET_TYPE_RESPONSE)
+    {
+        char* Msg = ErrorMsg("Failed to write file to storage server", res->iResponseErrorCode);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Wcmd: Storage server refused the request: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
+        free(Msg);
+        LeaseDrop(path);
+        ReleaseStorageConnection(StorageSockfd, 1);
         return;
     }
-    // printf("Stop Sequence: %s\n", stop);
 
-    // Take the input from the user and send it to the storage server
+    char* buffer = (char*)malloc(ChunkSize);
+    if(CheckNull(buffer, ErrorMsg("Failed to allocate stream buffer", CMD_ERROR_SEND_FAILED)))
+    {
+        fprintf(Clientlog, "[-]Wcmd: Failed to allocate stream buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+
+    // Take the input from the user and send it to the storage server in chunks of atmost ChunkSize bytes
+    // A positional write sends exactly the bytes of its range
     printf("\n"GRN"Enter the data to be written to the file. Press Ctrl+D to stop\n"reset);
-    char buffer[MAX_BUFFER_SIZE];
-    memset(buffer, 0, MAX_BUFFER_SIZE);
-    while(fgets(buffer, MAX_BUFFER_SIZE, stdin) != NULL)
+    size_t iBytesRead;
+    int iStreamError = 0;
+    unsigned long long Remaining = (iFlag == REQUEST_FLAG_POSITIONAL) ? Length : ULLONG_MAX;
+    while(Remaining > 0 && (iBytesRead = fread(buffer, 1, Remaining < ChunkSize ? Remaining : ChunkSize, stdin)) > 0)
     {
-        int iBytesSent = send(StorageSockfd, buffer, MAX_BUFFER_SIZE, 0);
-        if(CheckError(iBytesSent, ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
+        Remaining -= iBytesRead;
+        if(CheckError(SendChunk(StorageSockfd, CMD_WRITE, buffer, iBytesRead), ErrorMsg("Failed to send data to storage server", CMD_ERROR_SEND_FAILED)))
         {
             fprintf(Clientlog, "[-]Wcmd: Failed to send data to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
-            return;
-        }
-        memset(buffer, 0, MAX_BUFFER_SIZE);
-        if(feof(stdin)) break;
-        else if(ferror(stdin)) {
-            printf(RED"Error reading from stdin\n"reset);
-            fprintf(Clientlog, "[-]Wcmd: Error reading from stdin [Time Stamp: %f]\n", GetCurrTime(Clock));
+            free(buffer);
+            ReleaseStorageConnection(StorageSockfd, 0);
             return;
         }
     }
-    
+    free(buffer);
+
+    if(ferror(stdin))
+    {
+        printf(RED"Error reading from stdin\n"reset);
+        fprintf(Clientlog, "[-]Wcmd: Error reading from stdin [Time Stamp: %f]\n", GetCurrTime(Clock));
+        iStreamError = CMD_ERROR_INVALID_ARGUMENTS;
+    }
+
     // clear the EOF flag
     clearerr(stdin);
 
-    // Send the stop sequence to the server
-    iBytesSent = send(StorageSockfd, stop, MAX_BUFFER_SIZE, 0);
-    if(CheckError(iBytesSent, ErrorMsg("Failed to send stop sequence to storage server", CMD_ERROR_SEND_FAILED)))
+    // Send the end of stream frame to the server
+    iBytesSent = SendStreamEnd(StorageSockfd, CMD_WRITE, iStreamError);
+    if(CheckError(iBytesSent, ErrorMsg("Failed to send end of stream to storage server", CMD_ERROR_SEND_FAILED)))
     {
-        fprintf(Clientlog, "[-]Wcmd: Failed to send stop sequence to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        fprintf(Clientlog, "[-]Wcmd: Failed to send end of stream to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
     // Receive the response from the storage server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = RecvResponse(StorageSockfd, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Failed to receive response from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
@@ -414,68 +559,29 @@ void Wcmd(char* arg, int ServerSockfd)
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Wcmd: Failed to write file to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 1);
         return;
     }
 
     // log the response
     fprintf(Clientlog, "[+]Wcmd: Server Response: %s [Time Stamp: %f]\n", res->sResponseData, GetCurrTime(Clock));
 
-    close(StorageSockfd);
+    // Keep the session for the next request
+    ReleaseStorageConnection(StorageSockfd, 1);
     fprintf(Clientlog, "[+]Wcmd: Successfully wrote file [Time Stamp: %f]\n", GetCurrTime(Clock));
     printf(GRN"File wrote to successfully\n"reset);
 
     return;
 }
-void Icmd(char* arg, int ServerSockfd)
+/**
+ * @brief Fetches the information of a path from the storage server serving it
+ * @param path: The path as given by the user
+ * @param req: The request resolved by the naming server (forwarded to the storage server)
+ * @param res: The naming server's response (IP and Port of the storage server)
+ */
+static void InfoFromStorageServer(char* path, REQUEST_STRUCT* req, RESPONSE_STRUCT* res)
 {
-    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: INFO <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
-    {
-        fprintf(Clientlog, "[-]Icmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-
-    arg = strtok(arg, " \t\n");
-    if(strtok(NULL, " \t\n") != NULL)
-    {
-        printf(RED"Invalid Argument Count\nUSAGE: INFO <Path>\n"reset);
-        fprintf(Clientlog, "[-]Icmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-
-    char* path = arg;
-    fprintf(Clientlog, "[+]Icmd: Describing Path %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
-
-    REQUEST_STRUCT req_struct;
-    REQUEST_STRUCT* req = &req_struct;
-    memset(req, 0, sizeof(REQUEST_STRUCT));
-
-    req->iRequestOperation = CMD_INFO;
-    req->iRequestClientID = iClientID;
-    strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
-
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
-    {
-        char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
-        printf(RED"%s\n"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to send request [Time Stamp: %f]\n", GetCurrTime(Clock));
-        free(Msg);
-        return;
-    }
-
-    RESPONSE_STRUCT res_struct;
-    RESPONSE_STRUCT* res = &res_struct;
-    memset(res, 0, sizeof(RESPONSE_STRUCT));
-
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
-    {
-        char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
-        printf(RED"%s"reset, Msg);
-        fprintf(Clientlog, "[-]Icmd: Failed to receive response [Time Stamp: %f]\n", GetCurrTime(Clock));
-        free(Msg);
-        return;
-    }
+    int iBytesSent, iBytesRecv;
 
     if(res->iResponseFlags == RESPONSE_FLAG_FAILURE)
     {
@@ -511,47 +617,36 @@ void Icmd(char* arg, int ServerSockfd)
         return;
     }
 
-    // Connect to the storage server
-    int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
-    {
-        fprintf(Clientlog, "[-]Icmd: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return;
-    }
-
-    struct sockaddr_in StorageServer;
-    memset(&StorageServer, 0, sizeof(StorageServer));
-    StorageServer.sin_family = AF_INET;
-    StorageServer.sin_addr.s_addr = inet_addr(ip);
-    StorageServer.sin_port = htons(atoi(port));
-    memset(StorageServer.sin_zero, '\0', sizeof(StorageServer.sin_zero));
-
-    int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
-    if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
+    // Connect to the storage server (or reuse the session left open by an earlier command)
+    int StorageSockfd = GetStorageConnection(ip, atoi(port));
+    if(StorageSockfd < 0)
     {
         fprintf(Clientlog, "[-]Icmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        LeaseDrop(path);
         return;
     }
 
     // Send the request to the storage server
-    iBytesSent = send(StorageSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    iBytesSent = SendRequest(StorageSockfd, req);
+    if(iBytesSent < 0)
     {
         char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Icmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
 
     // Recieve the Confirmation from the server
-    iBytesRecv = recv(StorageSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    iBytesRecv = RecvResponse(StorageSockfd, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive confirmation from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Icmd: Failed to receive confirmation from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
     else if(res->iResponseFlags == RESPONSE_FLAG_FAILURE)
@@ -560,6 +655,8 @@ void Icmd(char* arg, int ServerSockfd)
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Icmd: Failed to get info of file [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        LeaseDrop(path);
+        ReleaseStorageConnection(StorageSockfd, 1);
         return;
     }
 
@@ -568,15 +665,17 @@ void Icmd(char* arg, int ServerSockfd)
     PATH_INFO_STRUCT* path_info = &path_info_struct;
     memset(path_info, 0, sizeof(PATH_INFO_STRUCT));
 
-    iBytesRecv = recv(StorageSockfd, path_info, sizeof(PATH_INFO_STRUCT), 0);
-    if(iBytesRecv != sizeof(PATH_INFO_STRUCT))
+    iBytesRecv = RecvPathInfo(StorageSockfd, path_info);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive path info from storage server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
         fprintf(Clientlog, "[-]Icmd: Failed to receive path info from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
         free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
         return;
     }
+    ReleaseStorageConnection(StorageSockfd, 1);
 
     // Extract the information from the path_info struct
     // Convert the permission to corresponding string
@@ -643,4 +742,62 @@ void Icmd(char* arg, int ServerSockfd)
     fprintf(Clientlog, "[+]Icmd: Path Information:\nPath: %s\nType: %s\nSize: %d Bytes\nPermission: %d (%s)\nCreation Time: %s\nModification Time: %s [Time Stamp: %f]\n", path_info->sPath, path_info->iPathType == 0 ? "File" :path_info->iPathType == 1? "Folder": "Executable", path_info->iPathSize, path_info->iPathPermission, permission, ctime, mtime, GetCurrTime(Clock));
       
     return;
-}
\ No newline at end of file
+}void Icmd(char* arg, int ServerSockfd)
+{
+    if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: INFO <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS)))
+    {
+        fprintf(Clientlog, "[-]Icmd: Invalid Argument [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    // Collect the paths
+    char* paths[MAX_PIPELINED_REQUESTS];
+    int iPathCount = 0;
+    for(char* path = strtok(arg, " \t\n"); path != NULL; path = strtok(NULL, " \t\n"))
+    {
+        if(iPathCount == MAX_PIPELINED_REQUESTS)
+        {
+            char* Msg = ErrorMsg("Too many paths\nUSAGE: INFO <Path> [<Path> ...]", CMD_ERROR_INVALID_ARGUMENTS_COUNT);
+            printf(RED"%s\n"reset, Msg);
+            fprintf(Clientlog, "[-]Icmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+            free(Msg);
+            return;
+        }
+        paths[iPathCount++] = path;
+    }
+
+    if(iPathCount == 0)
+    {
+        fprintf(Clientlog, "[-]Icmd: Invalid Argument Count [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    // Prepare the request forwarded to the storage server for every path
+    REQUEST_STRUCT reqs[MAX_PIPELINED_REQUESTS];
+    for(int i = 0; i < iPathCount; i++)
+    {
+        fprintf(Clientlog, "[+]Icmd: Describing Path %s [Time Stamp: %f]\n", paths[i], GetCurrTime(Clock));
+
+        REQUEST_STRUCT* req = &reqs[i];
+        memset(req, 0, sizeof(REQUEST_STRUCT));
+
+        req->iRequestOperation = CMD_INFO;
+        req->iRequestClientID = iClientID;
+        strncpy(req->sRequestPath, paths[i], MAX_BUFFER_SIZE);
+    }
+
+    // Resolve every path with a single round trip to the naming server
+    RESPONSE_STRUCT res[MAX_PIPELINED_REQUESTS];
+    int iBytesRecv = ResolvePaths(ServerSockfd, paths, iPathCount, res);
+    if(iBytesRecv <= 0)
+    {
+        char* Msg = ErrorMsg("Failed to resolve paths on server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]Icmd: Failed to resolve paths [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        return;
+    }
+
+    for(int i = 0; i < iPathCount; i++)
+        InfoFromStorageServer(paths[i], &reqs[i], &res[i]);
+}
@@ -12,5 +12,6 @@
 #define CMD_ERROR_INVALID_RECV_VALUE 107
 #define CMD_ERROR_SOCKET_FAILED 109
 #define CMD_ERROR_CONNECT_FAILED 110
+#define CMD_ERROR_SERVER_UNAVAILABLE 203 // Same as the naming server's
 
 #endif // __CLIENT_ERRORCODES_H__
\ No newline at end of file
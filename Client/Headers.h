@@ -6,6 +6,7 @@
 #include <stdio.h>
 
 // Custom Libraries
+#include "../Externals.h"
 #include "./Hash.h"
 
 #define POLL_TIMEOUT 2
@@ -13,6 +14,12 @@
 #define FUNCTION_COUNT 127
 
 #define PROMPT_LEN 1024
+#define MAX_PIPELINED_REQUESTS 32 // Paths accepted by a single READ/INFO command
+#define MAX_PENDING_REPLIES 64    // Replies parked while awaiting another request
+#define MAX_SS_CONNECTIONS 8      // Storage server sessions kept open between commands
+#define SS_SESSION_IDLE 25        // Seconds a parked session is reused for (below the storage server's idle timeout)
+#define LEASE_CACHE_SIZE 256      // Leased path resolutions kept
+#define LEASE_CACHE_BUCKETS 64
 
 // structure for clock object
 typedef struct Clock
@@ -35,6 +42,26 @@ extern CLOCK* Clock;
 int pollServer(int sockfd, char* ip, int port);
 void prompt();
 
+// Naming Server Connection (pipelined requests)
+int SubmitRequest(int ServerSockfd, REQUEST_STRUCT* req);
+int AwaitResponse(int ServerSockfd, unsigned int iRequestID, RESPONSE_STRUCT* res);
+int AwaitAck(int ServerSockfd, unsigned int iRequestID, ACK_STRUCT* ack);
+int ResolveBatch(int ServerSockfd, char* const paths[], int count, RESOLVE_RESULT_STRUCT* results);
+void DiscardPendingReplies();
+void PollRevocations(int ServerSockfd);
+
+// Leased Path Resolutions
+int LeaseLookup(const char* path, RESOLVE_RESULT_STRUCT* result);
+void LeaseStore(const char* path, const RESOLVE_RESULT_STRUCT* result);
+void LeaseDrop(const char* path);
+void LeaseRevoke(unsigned long long iEpoch, unsigned long iServerID, const char* prefix);
+void LeaseFlush();
+
+// Storage Server Connections (sessions reused across commands)
+int GetStorageConnection(char* ip, int port);
+void ReleaseStorageConnection(int StorageSockfd, int iReusable);
+void CloseStorageConnections();
+
 //Client Side Commands
 void Ecmd(char* arg, int ServerSockfd);
 void Hcmd(char* arg, int ServerSockfd);
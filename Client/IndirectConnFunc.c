@@ -7,11 +7,74 @@
 
 // Custom Header Files
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 #include "./Headers.h"
 #include "./Hash.h"
 #include "./ErrorCodes.h"
 
+/**
+ * @brief Lists a directory below an export point from the storage server exporting it
+ * @param req: The list request (forwarded to the storage server)
+ * @param res: The naming server's redirect (IP and Port of the storage server)
+ */
+static void ListFromStorageServer(REQUEST_STRUCT* req, RESPONSE_STRUCT* res)
+{
+    // The response data is the IP and Port of the storage server seperated by a space
+    char* ip = strtok(res->sResponseData, " ");
+    char* port = strtok(NULL, " ");
+
+    if(CheckNull(ip, ErrorMsg("Invalid IP received from server", CMD_ERROR_INVALID_RECV_VALUE)))
+    {
+        fprintf(Clientlog, "[-]LScmd: Invalid IP received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+    else if(CheckNull(port, ErrorMsg("Invalid Port received from server", CMD_ERROR_INVALID_RECV_VALUE)))
+    {
+        fprintf(Clientlog, "[-]LScmd: Invalid Port received from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    int StorageSockfd = GetStorageConnection(ip, atoi(port));
+    if(StorageSockfd < 0)
+    {
+        fprintf(Clientlog, "[-]LScmd: Failed to connect to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return;
+    }
+
+    if(SendRequest(StorageSockfd, req) < 0)
+    {
+        char* Msg = ErrorMsg("Failed to send request to storage server", CMD_ERROR_SEND_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]LScmd: Failed to send request to storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+
+    if(RecvResponse(StorageSockfd, res) <= 0)
+    {
+        char* Msg = ErrorMsg("Failed to receive response from storage server", CMD_ERROR_RECV_FAILED);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "[-]LScmd: Failed to receive response from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+        free(Msg);
+        ReleaseStorageConnection(StorageSockfd, 0);
+        return;
+    }
+    ReleaseStorageConnection(StorageSockfd, 1);
+
+    if(res->iResponseFlags != RESPONSE_FLAG_SUCCESS)
+    {
+        char* Msg = ErrorMsg(res->sResponseData, res->iResponseErrorCode);
+        printf(RED"%s\n"reset, Msg);
+        fprintf(Clientlog, "%s [Time Stamp: %f]\n", Msg, GetCurrTime(Clock));
+        free(Msg);
+        return;
+    }
+
+    printf(GRN"%s\n"reset, res->sResponseData);
+    fprintf(Clientlog, "[+]LScmd: Successfully listed directory from storage server [Time Stamp: %f]\n", GetCurrTime(Clock));
+}
 void LScmd(char* arg, int ServerSockfd)
 {
     if(CheckNull(arg, ErrorMsg("NULL Argument\nUSAGE: LIST <Path>", CMD_ERROR_INVALID_ARGUMENTS)))
@@ -40,9 +103,9 @@ void LScmd(char* arg, int ServerSockfd)
     strncpy(req->sRequestPath, path, MAX_BUFFER_SIZE);
     // req->iRequestFlags = 0;
 
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
+    int iBytesSent = SubmitRequest(ServerSockfd, req);
 
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    if(iBytesSent < 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
@@ -55,8 +118,8 @@ void LScmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = AwaitResponse(ServerSockfd, req->iRequestID, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
@@ -65,6 +128,14 @@ void LScmd(char* arg, int ServerSockfd)
         return;
     }
 
+    // Below an export point the listing is served by the storage server
+    if(res->iResponseFlags == RESPONSE_FLAG_REDIRECT)
+    {
+        fprintf(Clientlog, "[+]LScmd: Listing of %s redirected to storage server %s [Time Stamp: %f]\n", path, res->sResponseData, GetCurrTime(Clock));
+        ListFromStorageServer(req, res);
+        return;
+    }
+
     if(res->iResponseFlags != RESPONSE_FLAG_SUCCESS)
     {
         char* Msg = ErrorMsg(res->sResponseData, res->iResponseErrorCode);
@@ -139,8 +210,8 @@ void Rncmd(char* arg, int ServerSockfd)
     snprintf(req->sRequestPath, MAX_BUFFER_SIZE, "%s %s", src, target);
 
     // Send the request to the server
-    int iBytesSent = send(ServerSockfd, req, sizeof(REQUEST_STRUCT), 0);
-    if(iBytesSent != sizeof(REQUEST_STRUCT))
+    int iBytesSent = SubmitRequest(ServerSockfd, req);
+    if(iBytesSent < 0)
     {
         char* Msg = ErrorMsg("Failed to send request to server", CMD_ERROR_SEND_FAILED);
         printf(RED"%s\n"reset, Msg);
@@ -154,8 +225,8 @@ void Rncmd(char* arg, int ServerSockfd)
     RESPONSE_STRUCT* res = &res_struct;
     memset(res, 0, sizeof(RESPONSE_STRUCT));
 
-    int iBytesRecv = recv(ServerSockfd, res, sizeof(RESPONSE_STRUCT), 0);
-    if(iBytesRecv != sizeof(RESPONSE_STRUCT))
+    int iBytesRecv = AwaitResponse(ServerSockfd, req->iRequestID, res);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
@@ -179,8 +250,8 @@ void Rncmd(char* arg, int ServerSockfd)
     ACK_STRUCT* ack = &ack_struct;
     memset(ack, 0, sizeof(ACK_STRUCT));
 
-    iBytesRecv = recv(ServerSockfd, ack, sizeof(ACK_STRUCT), 0);
-    if(iBytesRecv != sizeof(ACK_STRUCT))
+    iBytesRecv = AwaitAck(ServerSockfd, req->iRequestID, ack);
+    if(iBytesRecv <= 0)
     {
         char* Msg = ErrorMsg("Failed to receive response from server", CMD_ERROR_RECV_FAILED);
         printf(RED"%s\n"reset, Msg);
@@ -193,7 +264,7 @@ void Rncmd(char* arg, int ServerSockfd)
     fprintf(Clientlog, "[+]Rncmd: Received ACK with data %s [Time Stamp: %f]\n", ack->sAckData, GetCurrTime(Clock));
 
     // Check if the operation was successful
-    if(ack->iAckFlags == ACK_FLAG_SUCCESS)
+    if(ack->iAckFlags != ACK_FLAG_SUCCESS)
     {
         char* Msg = ErrorMsg("Failed to rename file", ack->iAckErrorCode);
         printf(RED"%s\n"reset, Msg);
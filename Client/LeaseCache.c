@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Custom Header Files
+#include "../Externals.h"
+#include "../Protocol.h"
+#include "./Headers.h"
+
+/*
+LEASED PATH RESOLUTIONS
+    1. Results of a batched resolution that carry a lease are kept until the lease expires,
+       the next READ/WRITE/INFO of the path then goes straight to the storage server
+    2. The naming server pushes a REVOKE when mappings change, revocations are applied
+       before the cache is consulted (see PollRevocations)
+    3. A lease issued in an epoch older than the newest revocation applied is not kept,
+       its reply may have been overtaken by the revocation
+    4. Atmost LEASE_CACHE_SIZE leases are kept, the least recently used one makes room
+*/
+
+typedef struct LEASE_ENTRY
+{
+    char* path;
+    RESOLVE_RESULT_STRUCT result;
+    double dExpiry;         // GetCurrTime() at which the lease runs out
+    unsigned long iLastUsed;
+    struct LEASE_ENTRY* next; // Bucket chain
+} LEASE_ENTRY;
+
+static LEASE_ENTRY* LeaseBuckets[LEASE_CACHE_BUCKETS];
+static int iLeaseCount = 0;
+static unsigned long iLeaseClock = 0;
+static unsigned long long iLeaseEpoch = 0; // Newest epoch seen in a revocation
+
+static unsigned int LeaseHash(const char* path)
+{
+    // djb2
+    unsigned int hash = 5381;
+    int c;
+    while((c = (unsigned char)*path++))
+        hash = ((hash << 5) + hash) + c;
+    return hash % LEASE_CACHE_BUCKETS;
+}
+
+/**
+ * @brief Unlinks and frees an entry
+ * @param link The link pointing to the entry
+ */
+static void LeaseRemove(LEASE_ENTRY** link)
+{
+    LEASE_ENTRY* entry = *link;
+    *link = entry->next;
+    free(entry->path);
+    free(entry);
+    iLeaseCount--;
+}
+
+/**
+ * @brief Drops the expired leases, and the least recently used one if none expired
+ */
+static void LeaseMakeRoom()
+{
+    double now = GetCurrTime(Clock);
+    LEASE_ENTRY** oldest = NULL;
+    for(int i = 0; i < LEASE_CACHE_BUCKETS; i++)
+    {
+        LEASE_ENTRY** link = &LeaseBuckets[i];
+        while(*link != NULL)
+        {
+            if((*link)->dExpiry <= now)
+            {
+                LeaseRemove(link);
+                continue;
+            }
+            if(oldest == NULL || (*link)->iLastUsed < (*oldest)->iLastUsed)
+                oldest = link;
+            link = &(*link)->next;
+        }
+    }
+    if(iLeaseCount >= LEASE_CACHE_SIZE && oldest != NULL)
+        LeaseRemove(oldest);
+}
+
+/**
+ * @brief Looks up the leased resolution of a path
+ * @param path The path
+ * @param result Filled with the resolution on a hit
+ * @return 1 if a valid lease was found, 0 otherwise
+ */
+int LeaseLookup(const char* path, RESOLVE_RESULT_STRUCT* result)
+{
+    LEASE_ENTRY** link = &LeaseBuckets[LeaseHash(path)];
+    while(*link != NULL)
+    {
+        LEASE_ENTRY* entry = *link;
+        if(strcmp(entry->path, path) == 0)
+        {
+            if(entry->dExpiry <= GetCurrTime(Clock))
+            {
+                LeaseRemove(link);
+                return 0;
+            }
+            entry->iLastUsed = ++iLeaseClock;
+            *result = entry->result;
+            return 1;
+        }
+        link = &entry->next;
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps the resolution of a path for as long as its lease lasts
+ * @param path The path
+ * @param result The resolution received from the naming server
+ * @note Results without a lease, or with a lease of a revoked epoch, are not kept
+ */
+void LeaseStore(const char* path, const RESOLVE_RESULT_STRUCT* result)
+{
+    if(result->iLeaseTTL == 0 || result->iEpoch < iLeaseEpoch) return;
+
+    LeaseDrop(path);
+    if(iLeaseCount >= LEASE_CACHE_SIZE) LeaseMakeRoom();
+
+    LEASE_ENTRY* entry = (LEASE_ENTRY*)malloc(sizeof(LEASE_ENTRY));
+    if(entry == NULL) return;
+    entry->path = strdup(path);
+    if(entry->path == NULL)
+    {
+        free(entry);
+        return;
+    }
+    entry->result = *result;
+    entry->dExpiry = GetCurrTime(Clock) + result->iLeaseTTL / 1000.0;
+    entry->iLastUsed = ++iLeaseClock;
+
+    unsigned int bucket = LeaseHash(path);
+    entry->next = LeaseBuckets[bucket];
+    LeaseBuckets[bucket] = entry;
+    iLeaseCount++;
+}
+
+/**
+ * @brief Drops the lease of a path (e.g. the storage server no longer serves it)
+ * @param path The path
+ */
+void LeaseDrop(const char* path)
+{
+    LEASE_ENTRY** link = &LeaseBuckets[LeaseHash(path)];
+    while(*link != NULL)
+    {
+        if(strcmp((*link)->path, path) == 0)
+        {
+            LeaseRemove(link);
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+/**
+ * @brief Applies a revocation pushed by the naming server
+ * @param iEpoch The epoch the naming server moved to
+ * @param iServerID The server whose leases are void (0 for any server)
+ * @param prefix The path at or below which leases are void ("" for every path)
+ */
+void LeaseRevoke(unsigned long long iEpoch, unsigned long iServerID, const char* prefix)
+{
+    if(iEpoch > iLeaseEpoch) iLeaseEpoch = iEpoch;
+
+    size_t len = strlen(prefix);
+    while(len > 0 && prefix[len - 1] == '/') len--;
+
+    int iDropped = 0;
+    for(int i = 0; i < LEASE_CACHE_BUCKETS; i++)
+    {
+        LEASE_ENTRY** link = &LeaseBuckets[i];
+        while(*link != NULL)
+        {
+            LEASE_ENTRY* entry = *link;
+            int bServer = iServerID == 0 || entry->result.iServerID == iServerID;
+            int bPath = len == 0 || (strncmp(entry->path, prefix, len) == 0 && (entry->path[len] == '\0' || entry->path[len] == '/'));
+            if(bServer && bPath)
+            {
+                LeaseRemove(link);
+                iDropped++;
+                continue;
+            }
+            link = &entry->next;
+        }
+    }
+    fprintf(Clientlog, "[+]LeaseRevoke: Epoch %llu, dropped %d leases under '%s' (server %lu) [Time Stamp: %f]\n", iEpoch, iDropped, prefix, iServerID, GetCurrTime(Clock));
+}
+
+/**
+ * @brief Drops every lease
+ * @note Called when the connection to the naming server is re-established (revocations may have been missed)
+ */
+void LeaseFlush()
+{
+    for(int i = 0; i < LEASE_CACHE_BUCKETS; i++)
+        while(LeaseBuckets[i] != NULL) LeaseRemove(&LeaseBuckets[i]);
+}
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+// Custom Header Files
+#include "../Externals.h"
+#include "../Protocol.h"
+#include "../colour.h"
+#include "./Headers.h"
+#include "./ErrorCodes.h"
+
+/*
+PIPELINED REQUESTS ON THE NAMING SERVER CONNECTION
+    1. SubmitRequest tags the request with a fresh ID and sends it without waiting
+    2. Any number of requests can be submitted before their replies are awaited
+    3. AwaitResponse / AwaitAck return the reply carrying the given ID, replies to
+       other requests that arrive first are parked until they are awaited
+    4. ResolveBatch resolves many paths with a single request and a single reply
+    5. REVOKEs pushed by the naming server are applied to the lease cache as soon as they
+       are received, they are never parked
+*/
+
+// Reply parked until its request is awaited
+typedef struct PENDING_REPLY
+{
+    int iType;                // PACKET_TYPE_RESPONSE, PACKET_TYPE_ACK, PACKET_TYPE_RESOLVE_RESULT (or PACKET_TYPE_REVOKE, already applied)
+    unsigned int iRequestID;  // Request the reply belongs to
+    RESPONSE_STRUCT response; // Valid if iType is PACKET_TYPE_RESPONSE
+    ACK_STRUCT ack;           // Valid if iType is PACKET_TYPE_ACK
+    RESOLVE_RESULT_STRUCT* results; // Valid if iType is PACKET_TYPE_RESOLVE_RESULT (malloced)
+    int iResultCount;         // Number of results
+} PENDING_REPLY;
+
+static PENDING_REPLY PendingReplies[MAX_PENDING_REPLIES];
+static int iPendingCount = 0;
+static unsigned int iNextRequestID = 1;
+
+/**
+ * @brief Returns a fresh request ID
+ * @return The request ID
+ */
+static unsigned int NextRequestID()
+{
+    // 0 is reserved for packets that do not belong to a request
+    if(iNextRequestID == 0) iNextRequestID = 1;
+    return iNextRequestID++;
+}
+
+/**
+ * @brief Tags the request with a new request ID and sends it to the naming server
+ * @param ServerSockfd The socket connected to the naming server
+ * @param req The request to be sent (iRequestID is filled in)
+ * @return The number of bytes sent on success, -1 on failure
+ */
+int SubmitRequest(int ServerSockfd, REQUEST_STRUCT* req)
+{
+    req->iRequestID = NextRequestID();
+
+    int iBytesSent = SendRequest(ServerSockfd, req);
+    if(iBytesSent >= 0)
+        fprintf(Clientlog, "[+]SubmitRequest: Request %u (Operation: %d) sent [Time Stamp: %f]\n", req->iRequestID, req->iRequestOperation, GetCurrTime(Clock));
+    return iBytesSent;
+}
+
+/**
+ * @brief Receives the next reply from the naming server
+ * @param ServerSockfd The socket connected to the naming server
+ * @param reply The reply to be filled (results are malloced for PACKET_TYPE_RESOLVE_RESULT)
+ * @return The number of bytes read on success, 0 if the server closed the connection, -1 on failure
+ */
+static int RecvNSReply(int ServerSockfd, PENDING_REPLY* reply)
+{
+    static unsigned char payload[RESOLVE_RESULT_MAX_PAYLOAD];
+
+    PACKET_HEADER header;
+    int iBytesRecv = RecvPacket(ServerSockfd, &header, payload, sizeof(payload));
+    if(iBytesRecv <= 0) return iBytesRecv;
+
+    reply->iType = header.iType;
+    reply->iRequestID = header.iRequestID;
+    reply->results = NULL;
+    reply->iResultCount = 0;
+    if(header.iType == PACKET_TYPE_RESPONSE)
+    {
+        reply->response.iResponseOperation = header.iOpcode;
+        reply->response.iResponseRequestID = header.iRequestID;
+        if(DecodeResponse(payload, header.iLength, &reply->response) >= 0) return iBytesRecv;
+    }
+    else if(header.iType == PACKET_TYPE_ACK)
+    {
+        reply->ack.iAckRequestID = header.iRequestID;
+        if(DecodeAck(payload, header.iLength, &reply->ack) >= 0) return iBytesRecv;
+    }
+    else if(header.iType == PACKET_TYPE_RESOLVE_RESULT)
+    {
+        reply->results = (RESOLVE_RESULT_STRUCT*)malloc(MAX_RESOLVE_BATCH * sizeof(RESOLVE_RESULT_STRUCT));
+        if(reply->results == NULL) return -1;
+        reply->iResultCount = DecodeResolveResults(payload, header.iLength, reply->results, MAX_RESOLVE_BATCH);
+        if(reply->iResultCount >= 0) return iBytesRecv;
+        free(reply->results);
+        reply->results = NULL;
+    }
+    else if(header.iType == PACKET_TYPE_REVOKE)
+    {
+        uint64_t iEpoch;
+        unsigned long iServerID;
+        char prefix[MAX_BUFFER_SIZE];
+        if(DecodeRevoke(payload, header.iLength, &iEpoch, &iServerID, prefix, sizeof(prefix)) >= 0)
+        {
+            LeaseRevoke(iEpoch, iServerID, prefix);
+            return iBytesRecv;
+        }
+    }
+
+    errno = EPROTO;
+    return -1;
+}
+
+/**
+ * @brief Waits for the reply of the given type to the given request
+ * @param ServerSockfd The socket connected to the naming server
+ * @param iType The type of reply expected
+ * @param iRequestID The ID of the request
+ * @param out Filled with the reply
+ * @return 1 on success, 0 if the server closed the connection, -1 on failure
+ */
+static int AwaitReply(int ServerSockfd, int iType, unsigned int iRequestID, PENDING_REPLY* out)
+{
+    // Check if the reply already arrived
+    for(int i = 0; i < iPendingCount; i++)
+    {
+        PENDING_REPLY* pending = &PendingReplies[i];
+        if(pending->iType != iType || pending->iRequestID != iRequestID) continue;
+
+        *out = *pending;
+        PendingReplies[i] = PendingReplies[--iPendingCount];
+        return 1;
+    }
+
+    // Receive replies until the awaited one arrives, parking the others
+    while(1)
+    {
+        PENDING_REPLY reply;
+        int iBytesRecv = RecvNSReply(ServerSockfd, &reply);
+        if(iBytesRecv <= 0) return iBytesRecv;
+
+        if(reply.iType == iType && reply.iRequestID == iRequestID)
+        {
+            *out = reply;
+            return 1;
+        }
+        if(reply.iType == PACKET_TYPE_REVOKE) continue;
+
+        if(iPendingCount == MAX_PENDING_REPLIES)
+        {
+            fprintf(Clientlog, "[-]AwaitReply: Too many pending replies, dropping reply to request %u [Time Stamp: %f]\n", reply.iRequestID, GetCurrTime(Clock));
+            free(reply.results);
+            continue;
+        }
+        PendingReplies[iPendingCount++] = reply;
+    }
+}
+
+/**
+ * @brief Waits for the response to a submitted request
+ * @param ServerSockfd The socket connected to the naming server
+ * @param iRequestID The ID of the request (set by SubmitRequest)
+ * @param res The response to be filled
+ * @return 1 on success, 0 if the server closed the connection, -1 on failure
+ */
+int AwaitResponse(int ServerSockfd, unsigned int iRequestID, RESPONSE_STRUCT* res)
+{
+    PENDING_REPLY reply;
+    int iStatus = AwaitReply(ServerSockfd, PACKET_TYPE_RESPONSE, iRequestID, &reply);
+    if(iStatus == 1) *res = reply.response;
+    return iStatus;
+}
+
+/**
+ * @brief Waits for the ack to a submitted request
+ * @param ServerSockfd The socket connected to the naming server
+ * @param iRequestID The ID of the request (set by SubmitRequest)
+ * @param ack The ack to be filled
+ * @return 1 on success, 0 if the server closed the connection, -1 on failure
+ */
+int AwaitAck(int ServerSockfd, unsigned int iRequestID, ACK_STRUCT* ack)
+{
+    PENDING_REPLY reply;
+    int iStatus = AwaitReply(ServerSockfd, PACKET_TYPE_ACK, iRequestID, &reply);
+    if(iStatus == 1) *ack = reply.ack;
+    return iStatus;
+}
+
+/**
+ * @brief Resolves a batch of paths with a single request to the naming server
+ * @param ServerSockfd The socket connected to the naming server
+ * @param paths The paths to be resolved
+ * @param count The number of paths (atmost MAX_RESOLVE_BATCH)
+ * @param results Filled with the resolution of every path, in order
+ * @return 1 on success, 0 if the server closed the connection, -1 on failure
+ */
+int ResolveBatch(int ServerSockfd, char* const paths[], int count, RESOLVE_RESULT_STRUCT* results)
+{
+    unsigned int iRequestID = NextRequestID();
+    if(SendResolveBatch(ServerSockfd, iRequestID, paths, count) < 0) return -1;
+    fprintf(Clientlog, "[+]ResolveBatch: Request %u (%d paths) sent [Time Stamp: %f]\n", iRequestID, count, GetCurrTime(Clock));
+
+    PENDING_REPLY reply;
+    int iStatus = AwaitReply(ServerSockfd, PACKET_TYPE_RESOLVE_RESULT, iRequestID, &reply);
+    if(iStatus != 1) return iStatus;
+
+    // The naming server answers a batch it could not parse with no results
+    if(reply.iResultCount != count)
+    {
+        fprintf(Clientlog, "[-]ResolveBatch: Expected %d results, got %d [Time Stamp: %f]\n", count, reply.iResultCount, GetCurrTime(Clock));
+        free(reply.results);
+        return -1;
+    }
+    memcpy(results, reply.results, count * sizeof(RESOLVE_RESULT_STRUCT));
+    free(reply.results);
+    return 1;
+}
+
+/**
+ * @brief Drops all parked replies
+ * @note Called when the connection to the naming server is re-established
+ */
+void DiscardPendingReplies()
+{
+    if(iPendingCount)
+        fprintf(Clientlog, "[-]DiscardPendingReplies: Dropping %d pending replies [Time Stamp: %f]\n", iPendingCount, GetCurrTime(Clock));
+    for(int i = 0; i < iPendingCount; i++)
+        free(PendingReplies[i].results);
+    iPendingCount = 0;
+}
+
+/**
+ * @brief Applies the revocations the naming server pushed since the last command
+ * @param ServerSockfd The socket connected to the naming server
+ * @note Does not block, other replies received on the way are parked
+ */
+void PollRevocations(int ServerSockfd)
+{
+    struct pollfd fds[1];
+    fds[0].fd = ServerSockfd;
+    fds[0].events = POLLIN;
+
+    while(poll(fds, 1, 0) > 0 && (fds[0].revents & POLLIN))
+    {
+        PENDING_REPLY reply;
+        if(RecvNSReply(ServerSockfd, &reply) <= 0) return;
+        if(reply.iType == PACKET_TYPE_REVOKE) continue;
+
+        if(iPendingCount == MAX_PENDING_REPLIES)
+        {
+            fprintf(Clientlog, "[-]PollRevocations: Too many pending replies, dropping reply to request %u [Time Stamp: %f]\n", reply.iRequestID, GetCurrTime(Clock));
+            free(reply.results);
+            continue;
+        }
+        PendingReplies[iPendingCount++] = reply;
+    }
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h> //inet_addr
+
+// Custom Header Files
+#include "../Externals.h"
+#include "../colour.h"
+#include "./Headers.h"
+#include "./ErrorCodes.h"
+
+/*
+STORAGE SERVER SESSIONS
+    1. A storage server serves any number of requests on a client connection until the
+       connection stays idle for too long
+    2. GetStorageConnection hands out a parked connection to the server or opens a new one
+    3. ReleaseStorageConnection parks the connection for the next request, or closes it if it
+       can not be reused (e.g. a stream was cut short and the connection is out of sync)
+*/
+
+// Connection to a storage server
+typedef struct SS_CONNECTION
+{
+    char sIP[IP_LENGTH];
+    int iPort;
+    int iSockfd;
+    int iInUse;       // Handed out by GetStorageConnection
+    double fLastUsed; // Time the connection was released
+} SS_CONNECTION;
+
+static SS_CONNECTION Connections[MAX_SS_CONNECTIONS];
+static int iConnectionCount = 0;
+
+/**
+ * @brief Closes a parked connection and removes it from the cache
+ * @param i The index of the connection
+ */
+static void DropConnection(int i)
+{
+    close(Connections[i].iSockfd);
+    Connections[i] = Connections[--iConnectionCount];
+}
+
+/**
+ * @brief Checks if a parked connection can still be used
+ * @param conn The connection
+ * @return 1 if the connection is usable, 0 otherwise
+ * @note A parked connection must not be readable, data or EOF means the server closed it
+ */
+static int IsConnectionUsable(SS_CONNECTION* conn)
+{
+    if(GetCurrTime(Clock) - conn->fLastUsed > SS_SESSION_IDLE) return 0;
+
+    struct pollfd pfd = {.fd = conn->iSockfd, .events = POLLIN};
+    return poll(&pfd, 1, 0) == 0;
+}
+
+/**
+ * @brief Returns a connection to the storage server, reusing a parked one if possible
+ * @param ip The IP of the storage server
+ * @param port The port on which the storage server listens for clients
+ * @return The socket connected to the storage server, -1 on failure
+ */
+int GetStorageConnection(char* ip, int port)
+{
+    for(int i = 0; i < iConnectionCount; i++)
+    {
+        SS_CONNECTION* conn = &Connections[i];
+        if(conn->iInUse || conn->iPort != port || strcmp(conn->sIP, ip) != 0) continue;
+
+        if(!IsConnectionUsable(conn))
+        {
+            fprintf(Clientlog, "[-]GetStorageConnection: Dropping stale connection to %s:%d [Time Stamp: %f]\n", ip, port, GetCurrTime(Clock));
+            DropConnection(i--);
+            continue;
+        }
+
+        conn->iInUse = 1;
+        fprintf(Clientlog, "[+]GetStorageConnection: Reusing connection to %s:%d [Time Stamp: %f]\n", ip, port, GetCurrTime(Clock));
+        return conn->iSockfd;
+    }
+
+    // Connect to the storage server
+    int StorageSockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if(CheckError(StorageSockfd, ErrorMsg("Failed to create socket", CMD_ERROR_SOCKET_FAILED)))
+    {
+        fprintf(Clientlog, "[-]GetStorageConnection: Failed to create socket [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return -1;
+    }
+
+    struct sockaddr_in StorageServer;
+    memset(&StorageServer, 0, sizeof(StorageServer));
+    StorageServer.sin_family = AF_INET;
+    StorageServer.sin_addr.s_addr = inet_addr(ip);
+    StorageServer.sin_port = htons(port);
+
+    int iConnectStatus = connect(StorageSockfd, (struct sockaddr *)&StorageServer, sizeof(StorageServer));
+    if(CheckError(iConnectStatus, ErrorMsg("Failed to connect to storage server", CMD_ERROR_CONNECT_FAILED)))
+    {
+        fprintf(Clientlog, "[-]GetStorageConnection: Failed to connect to storage server %s:%d [Time Stamp: %f]\n", ip, port, GetCurrTime(Clock));
+        close(StorageSockfd);
+        return -1;
+    }
+
+    // Make room for the connection by closing the least recently used parked one
+    if(iConnectionCount == MAX_SS_CONNECTIONS)
+    {
+        int iOldest = -1;
+        for(int i = 0; i < iConnectionCount; i++)
+        {
+            if(Connections[i].iInUse) continue;
+            if(iOldest < 0 || Connections[i].fLastUsed < Connections[iOldest].fLastUsed) iOldest = i;
+        }
+        if(iOldest >= 0) DropConnection(iOldest);
+    }
+
+    if(iConnectionCount < MAX_SS_CONNECTIONS)
+    {
+        SS_CONNECTION* conn = &Connections[iConnectionCount++];
+        memset(conn, 0, sizeof(SS_CONNECTION));
+        strncpy(conn->sIP, ip, IP_LENGTH - 1);
+        conn->iPort = port;
+        conn->iSockfd = StorageSockfd;
+        conn->iInUse = 1;
+    }
+
+    fprintf(Clientlog, "[+]GetStorageConnection: Connected to storage server %s:%d [Time Stamp: %f]\n", ip, port, GetCurrTime(Clock));
+    return StorageSockfd;
+}
+
+/**
+ * @brief Gives back a connection returned by GetStorageConnection
+ * @param StorageSockfd The socket connected to the storage server
+ * @param iReusable 1 if the last request completed and the connection can serve another one
+ */
+void ReleaseStorageConnection(int StorageSockfd, int iReusable)
+{
+    for(int i = 0; i < iConnectionCount; i++)
+    {
+        if(Connections[i].iSockfd != StorageSockfd) continue;
+
+        if(!iReusable)
+        {
+            DropConnection(i);
+            return;
+        }
+        Connections[i].iInUse = 0;
+        Connections[i].fLastUsed = GetCurrTime(Clock);
+        return;
+    }
+
+    // The connection did not fit in the cache
+    close(StorageSockfd);
+}
+
+/**
+ * @brief Closes all connections to storage servers
+ * @note Called when the client exits
+ */
+void CloseStorageConnections()
+{
+    while(iConnectionCount > 0)
+        DropConnection(0);
+}
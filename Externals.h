@@ -29,17 +29,21 @@
 #define CMD_COPY 8
 #define CMD_RENAME 9
 #define CLOSE_CONNECTION 10
+#define CMD_RESOLVE_BATCH 11
 
 // Response Flags
 #define RESPONSE_FLAG_SUCCESS 0
 #define RESPONSE_FLAG_FAILURE -1
 #define BACKUP_RESPONSE 1
+#define RESPONSE_FLAG_REDIRECT 2 // The path is served by the storage server whose "IP Port" is the response data
 
 // Request Flags
 #define REQUEST_FLAG_SUCCESS -1
 #define REQUEST_FLAG_NONE 0
 #define REQUEST_FLAG_APPEND 0
 #define REQUEST_FLAG_OVERWRITE 1
+#define REQUEST_FLAG_RANGE 2 // READ of iRequestLength bytes from iRequestOffset (length 0 reads till the end)
+#define REQUEST_FLAG_POSITIONAL 3 // WRITE of exactly iRequestLength bytes at iRequestOffset (in place)
 
 // ACK Flags
 #define ACK_FLAG_SUCCESS 0
@@ -74,6 +78,10 @@ typedef struct REQUEST_STRUCT
     unsigned long iRequestClientID;  // Client ID
     char sRequestPath[MAX_BUFFER_SIZE]; // Path
     int iRequestFlags;     // Flags
+    unsigned int iRequestChunkSize; // Preferred chunk size for READ/WRITE data streams (0 for default)
+    unsigned int iRequestID; // ID to match the response(s) to the request
+    unsigned long long iRequestOffset; // First byte of a REQUEST_FLAG_RANGE read or REQUEST_FLAG_POSITIONAL write
+    unsigned long long iRequestLength; // Bytes of the range (a REQUEST_FLAG_RANGE read of 0 goes till the end of the file)
 } REQUEST_STRUCT;
 
 // Response Struct
@@ -84,6 +92,7 @@ typedef struct RESPONSE_STRUCT
     char sResponseData[MAX_BUFFER_SIZE]; // Data
     int iResponseFlags;     // Flags
     unsigned long iResponseServerID; // Server ID
+    unsigned int iResponseRequestID; // ID of the request being answered
 } RESPONSE_STRUCT;
 
 // Storage-Server Init Struct
@@ -101,6 +110,7 @@ typedef struct ACK_STRUCT
     int iAckErrorCode; // Error Code
     char sAckData[MAX_BUFFER_SIZE]; // Data
     int iAckFlags; // Flags
+    unsigned int iAckRequestID; // ID of the request being acknowledged
 } ACK_STRUCT;
 
 // Path Information Struct
@@ -116,6 +126,18 @@ typedef struct PATH_INFO_STRUCT
     int iPathLinks; // Count of Links
 } PATH_INFO_STRUCT;
 
+// Resolution of one path of a CMD_RESOLVE_BATCH request
+typedef struct RESOLVE_RESULT_STRUCT
+{
+    int iErrorCode; // Error Code
+    int iFlags;     // RESPONSE_FLAG_SUCCESS, RESPONSE_FLAG_FAILURE or BACKUP_RESPONSE
+    unsigned long iServerID; // Server ID
+    char sServerIP[IP_LENGTH]; // IP of the storage server serving the path
+    int iServerPort; // Port on which the storage server listens for clients
+    unsigned int iLeaseTTL; // Milliseconds the result may be cached for (0: not cacheable)
+    unsigned long long iEpoch; // Namespace epoch the lease was issued in
+} RESOLVE_RESULT_STRUCT;
+
 // // Error Catch buffer
 // extern jmp_buf jmpbuffer;
 
@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Arena.h"
+
+/**
+ * @brief Rounds a size up to its size class
+ * @param size: The requested size (updated to the rounded size)
+ * @return: The index of the free list of the class
+ */
+static int SizeClass(size_t *size)
+{
+    size_t rounded = (*size + 7) & ~(size_t)7;
+    if (rounded == 0)
+        rounded = 8;
+    if (rounded <= ARENA_SMALL_MAX)
+    {
+        *size = rounded;
+        return (int)(rounded / 8);
+    }
+    int shift = 0;
+    while (((size_t)1 << shift) < rounded)
+        shift++;
+    *size = (size_t)1 << shift;
+    return ARENA_SMALL_MAX / 8 + 1 + shift;
+}
+
+/**
+ * @brief Adds a block to the arena
+ * @param arena: The arena
+ * @param size: The usable size of the block
+ * @param current: Whether the block becomes the one being filled (else it is kept behind it)
+ * @return: The block, NULL on failure
+ */
+static ARENA_BLOCK *NewBlock(ARENA *arena, size_t size, int current)
+{
+    ARENA_BLOCK *block = (ARENA_BLOCK *)malloc(sizeof(ARENA_BLOCK) + size);
+    if (block == NULL)
+        return NULL;
+    block->size = size;
+    block->used = 0;
+    if (current || arena->blocks == NULL)
+    {
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    else
+    {
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+    }
+    arena->reserved += size;
+    return block;
+}
+
+/**
+ * @brief Creates an empty arena
+ * @return: The arena on success, NULL on failure
+ */
+ARENA *InitArena()
+{
+    return (ARENA *)calloc(1, sizeof(ARENA));
+}
+
+/**
+ * @brief Allocates memory from the arena
+ * @param arena: The arena
+ * @param size: The number of bytes
+ * @return: 8 byte aligned memory, NULL on failure
+ * @note: Memory reused from a free list is not zeroed
+ */
+void *ArenaAlloc(ARENA *arena, size_t size)
+{
+    if (arena == NULL)
+        return NULL;
+    int class = SizeClass(&size);
+
+    // Reuse a freed allocation of the same class
+    void *ptr = arena->free_lists[class];
+    if (ptr != NULL)
+    {
+        arena->free_lists[class] = *(void **)ptr;
+        arena->used += size;
+        return ptr;
+    }
+
+    ARENA_BLOCK *block = arena->blocks;
+    if (size > ARENA_BLOCK_SIZE / 4)
+    {
+        // Large allocations (e.g. child tables of big directories) get a block of their own
+        block = NewBlock(arena, size, 0);
+    }
+    else if (block == NULL || block->size - block->used < size)
+    {
+        block = NewBlock(arena, ARENA_BLOCK_SIZE, 1);
+    }
+    if (block == NULL)
+        return NULL;
+
+    ptr = block->data + block->used;
+    block->used += size;
+    arena->used += size;
+    return ptr;
+}
+
+/**
+ * @brief Allocates zeroed memory from the arena
+ * @param arena: The arena
+ * @param size: The number of bytes
+ * @return: 8 byte aligned zeroed memory, NULL on failure
+ */
+void *ArenaCalloc(ARENA *arena, size_t size)
+{
+    void *ptr = ArenaAlloc(arena, size);
+    if (ptr != NULL)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * @brief Keeps an allocation for reuse
+ * @param arena: The arena
+ * @param ptr: Memory returned by ArenaAlloc
+ * @param size: The size it was allocated with
+ */
+void ArenaFree(ARENA *arena, void *ptr, size_t size)
+{
+    if (arena == NULL || ptr == NULL)
+        return;
+    int class = SizeClass(&size);
+    *(void **)ptr = arena->free_lists[class];
+    arena->free_lists[class] = ptr;
+    arena->used -= size;
+}
+
+/**
+ * @brief Frees the arena and every allocation made from it
+ * @param arena: The arena
+ */
+void DestroyArena(ARENA *arena)
+{
+    if (arena == NULL)
+        return;
+    ARENA_BLOCK *block = arena->blocks;
+    while (block != NULL)
+    {
+        ARENA_BLOCK *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
@@ -0,0 +1,37 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_SMALL_MAX 512                           // Sizes upto this are rounded to 8 bytes, larger ones to a power of two
+#define ARENA_CLASSES (ARENA_SMALL_MAX / 8 + 1 + 64)  // One free list per rounded size
+
+typedef struct ARENA_BLOCK
+{
+    struct ARENA_BLOCK *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ARENA_BLOCK;
+
+// Bump allocator over large blocks, freed allocations are kept for reuse by size and released with the arena
+typedef struct ARENA
+{
+    ARENA_BLOCK *blocks;             // The first block is the one being filled
+    void *free_lists[ARENA_CLASSES];
+    size_t reserved;                 // Bytes held by the blocks
+    size_t used;                     // Bytes handed out and not freed
+} ARENA;
+
+ARENA *InitArena();
+// Returns 8 byte aligned memory (not zeroed when reused), NULL on failure
+void *ArenaAlloc(ARENA *arena, size_t size);
+// Zeroed ArenaAlloc
+void *ArenaCalloc(ARENA *arena, size_t size);
+// Keeps memory from ArenaAlloc for a later allocation of the same size
+void ArenaFree(ARENA *arena, void *ptr, size_t size);
+// Releases every block at once
+void DestroyArena(ARENA *arena);
+
+#endif
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Bloom.h"
+
+/*
+PATH BLOOM FILTER
+    1. A path is keyed by its tokens below the mount root, so "Mount/a//b/" and "x/a/b" are
+       the same key, like they are for the trie
+    2. The key is hashed token by token (FNV-1a with a separator after every token), the
+       state after each token is the hash of that prefix, so adding a path adds its
+       directories with no extra pass and the trie can be rehashed while it is walked
+    3. The bit positions are derived from one 64 bit hash by double hashing
+    4. Files below an export point are not in the trie, a path may be mounted if any of its
+       prefixes may be (the hash of each prefix falls out of the same pass)
+*/
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t HashToken(uint64_t hash, const char *token, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)token[i];
+        hash *= FNV_PRIME;
+    }
+    hash ^= '/';
+    hash *= FNV_PRIME;
+    return hash;
+}
+
+/**
+ * @brief Finds the next token of a path
+ * @param path: Where to start looking
+ * @param len: Set to the length of the token
+ * @return: The start of the token, NULL if the path has no more tokens
+ */
+static const char *NextToken(const char *path, size_t *len)
+{
+    while (*path == '/')
+        path++;
+    if (*path == '\0')
+        return NULL;
+    const char *end = path;
+    while (*end && *end != '/')
+        end++;
+    *len = end - path;
+    return path;
+}
+
+static void SetBits(BLOOM_FILTER *filter, uint64_t hash)
+{
+    uint64_t h1 = hash, h2 = (hash >> 33) | 1;
+    for (int i = 0; i < filter->nhashes; i++)
+    {
+        size_t bit = (h1 + i * h2) % filter->nbits;
+        __atomic_fetch_or(&filter->bits[bit / 64], 1ULL << (bit % 64), __ATOMIC_RELAXED);
+    }
+}
+
+static int TestBits(BLOOM_FILTER *filter, uint64_t hash)
+{
+    uint64_t h1 = hash, h2 = (hash >> 33) | 1;
+    for (int i = 0; i < filter->nhashes; i++)
+    {
+        size_t bit = (h1 + i * h2) % filter->nbits;
+        if ((__atomic_load_n(&filter->bits[bit / 64], __ATOMIC_RELAXED) & (1ULL << (bit % 64))) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Creates an empty filter
+ * @param nbits: The number of bits
+ * @param nhashes: The number of bits set per key
+ * @return: The filter on success, NULL on failure
+ */
+BLOOM_FILTER *InitBloomFilter(size_t nbits, int nhashes)
+{
+    BLOOM_FILTER *filter = (BLOOM_FILTER *)calloc(1, sizeof(BLOOM_FILTER));
+    if (filter == NULL)
+        return NULL;
+    filter->nbits = (nbits + 63) / 64 * 64;
+    filter->nhashes = nhashes;
+    filter->bits = (uint64_t *)calloc(filter->nbits / 64, sizeof(uint64_t));
+    if (filter->bits == NULL)
+    {
+        free(filter);
+        return NULL;
+    }
+    pthread_rwlock_init(&filter->lock, NULL);
+    return filter;
+}
+
+/**
+ * @brief Frees the filter
+ * @param filter: The filter
+ */
+void DestroyBloomFilter(BLOOM_FILTER *filter)
+{
+    if (filter == NULL)
+        return;
+    pthread_rwlock_destroy(&filter->lock);
+    free(filter->bits);
+    free(filter);
+}
+
+/**
+ * @brief Adds a path and all of its prefixes to the filter
+ * @param filter: The filter
+ * @param path: The path (first token is the mount root and is skipped)
+ */
+void BloomAddPath(BLOOM_FILTER *filter, const char *path)
+{
+    if (filter == NULL || path == NULL)
+        return;
+
+    size_t len;
+    const char *token = NextToken(path, &len);
+    if (token == NULL)
+        return;
+
+    uint64_t hash = FNV_OFFSET;
+    pthread_rwlock_rdlock(&filter->lock);
+    while ((token = NextToken(token + len, &len)) != NULL)
+    {
+        hash = HashToken(hash, token, len);
+        SetBits(filter, hash);
+    }
+    pthread_rwlock_unlock(&filter->lock);
+}
+
+/**
+ * @brief Checks if a path may be in the trie or below one of its export points
+ * @param filter: The filter
+ * @param path: The path (first token is the mount root and is skipped)
+ * @return: 0 if neither the path nor any of its prefixes is in the trie, 1 if one may be
+ * @note: The mount root itself has no server and is reported as absent
+ */
+int BloomMayContainPath(BLOOM_FILTER *filter, const char *path)
+{
+    if (filter == NULL || path == NULL)
+        return 1;
+
+    size_t len;
+    const char *token = NextToken(path, &len);
+    if (token == NULL)
+        return 0;
+
+    uint64_t hash = FNV_OFFSET;
+    int found = 0;
+    pthread_rwlock_rdlock(&filter->lock);
+    while (!found && (token = NextToken(token + len, &len)) != NULL)
+    {
+        hash = HashToken(hash, token, len);
+        found = TestBits(filter, hash);
+    }
+    pthread_rwlock_unlock(&filter->lock);
+    return found;
+}
+
+static void AddSubtree(BLOOM_FILTER *filter, TrieNode *node, uint64_t hash)
+{
+    for (uint32_t i = 0; i < node->child_capacity; i++)
+    {
+        TrieNode *child = node->children[i];
+        if (child == NULL)
+            continue;
+        // Every token of a compressed label is a path of its own
+        uint64_t child_hash = hash;
+        size_t len;
+        const char *token = NextToken(child->path_token, &len);
+        for (; token != NULL; token = NextToken(token + len, &len))
+        {
+            child_hash = HashToken(child_hash, token, len);
+            SetBits(filter, child_hash);
+        }
+        AddSubtree(filter, child, child_hash);
+    }
+}
+
+/**
+ * @brief Rebuilds the filter from the trie
+ * @param filter: The filter
+ * @param root: The root node of the trie
+ * @note: Lookups wait for the rebuild, so they never see a half filled filter
+ */
+void BloomRebuild(BLOOM_FILTER *filter, TrieNode *root)
+{
+    if (filter == NULL || root == NULL)
+        return;
+    pthread_rwlock_wrlock(&filter->lock);
+    memset(filter->bits, 0, filter->nbits / 8);
+    AddSubtree(filter, root, FNV_OFFSET);
+    pthread_rwlock_unlock(&filter->lock);
+}
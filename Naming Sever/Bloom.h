@@ -0,0 +1,30 @@
+#ifndef __BLOOM_H__
+#define __BLOOM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "./Trie.h"
+
+#define BLOOM_FILTER_BITS (1 << 20) // 128 KB, keeps false positives rare for ~100k registered paths
+#define BLOOM_FILTER_HASHES 7
+
+// Bloom filter of the paths in the mount trie (every node, keyed by its path below the mount root)
+typedef struct BLOOM_FILTER
+{
+    uint64_t *bits;
+    size_t nbits;
+    int nhashes;
+    pthread_rwlock_t lock; // Shared by lookups and adds (bits are set atomically), exclusive while rebuilding
+} BLOOM_FILTER;
+
+BLOOM_FILTER *InitBloomFilter(size_t nbits, int nhashes);
+void DestroyBloomFilter(BLOOM_FILTER *filter);
+// Adds a path and all of its prefixes (the first token, the mount root, is skipped like in the trie)
+void BloomAddPath(BLOOM_FILTER *filter, const char *path);
+// Returns 0 if neither the path nor any of its prefixes is in the trie, 1 if one may be
+int BloomMayContainPath(BLOOM_FILTER *filter, const char *path);
+// Clears the filter and adds every node of the trie (caller holds the trie lock)
+void BloomRebuild(BLOOM_FILTER *filter, TrieNode *root);
+
+#endif
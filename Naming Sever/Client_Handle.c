@@ -1,9 +1,13 @@
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
 #include <arpa/inet.h>
 #include "Headers.h"
 #include "Client_Handle.h"
+#include "../Protocol.h"
 #include "../colour.h"
 
 /**
@@ -27,8 +31,11 @@ unsigned long GetClientID(CLIENT_HANDLE_STRUCT *clientHandle)
 CLIENT_HANDLE_LIST_STRUCT* InitializeClientHandleList()
 {
     CLIENT_HANDLE_LIST_STRUCT *clientHandleList = (CLIENT_HANDLE_LIST_STRUCT *) malloc(sizeof(CLIENT_HANDLE_LIST_STRUCT));
-    memset(clientHandleList, 0, sizeof(clientHandleList));
+    memset(clientHandleList, 0, sizeof(CLIENT_HANDLE_LIST_STRUCT));
     pthread_mutex_init(&clientHandleList->clientListMutex, NULL);
+    // Slots are reused, their locks live as long as the list
+    for(int i = 0; i < MAX_CLIENTS; i++)
+        pthread_mutex_init(&clientHandleList->clientList[i].sendLock, NULL);
     return clientHandleList;
 }
 
@@ -38,6 +45,7 @@ CLIENT_HANDLE_LIST_STRUCT* InitializeClientHandleList()
  * @param clientHandle The client handle of the client to be added.
  * @return -1 if the maximum number of clients have been reached, otherwise 0.
  * @note The client handle is modified to include the client ID.
+ * @note The connection is copied into the slot field by field, the send lock of the slot is never overwritten.
  */
 int AddClient(CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
 {
@@ -58,7 +66,21 @@ int AddClient(CLIENT_HANDLE_STRUCT *clientHandle, CLIENT_HANDLE_LIST_STRUCT *cli
         {
             clientHandle->ClientID = GetClientID(clientHandle);
             clientHandleList->InUseList[i] = 1;
-            clientHandleList->clientList[i] = *clientHandle;
+            CLIENT_HANDLE_STRUCT *slot = &clientHandleList->clientList[i];
+            pthread_mutex_lock(&slot->sendLock);
+            slot->ClientID = clientHandle->ClientID;
+            memcpy(slot->sClientIP, clientHandle->sClientIP, IP_LENGTH);
+            slot->sClientPort = clientHandle->sClientPort;
+            slot->iClientSocket = clientHandle->iClientSocket;
+            slot->iEpollFd = clientHandle->iEpollFd;
+            slot->inHave = 0;
+            slot->inPayload = NULL;
+            slot->inCap = 0;
+            slot->outBuf = NULL;
+            slot->outLen = slot->outSent = slot->outCap = 0;
+            slot->outArmed = 0;
+            slot->bHoldsLeases = 0;
+            pthread_mutex_unlock(&slot->sendLock);
             clientHandleList->iClientCount++;
             pthread_mutex_unlock(&clientHandleList->clientListMutex);
             printf(GRN"[+]AddClient: Client-%lu (%s:%d) added to client list\n"reset, clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
@@ -93,7 +115,7 @@ int RemoveClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandle
     CLIENT_HANDLE_STRUCT *clientHandle = NULL;
     for(int i = 0; i < MAX_CLIENTS; i++)
     {
-        if(clientHandleList->clientList[i].ClientID == ClientID)
+        if(clientHandleList->InUseList[i] && clientHandleList->clientList[i].ClientID == ClientID)
         {
             clientHandle = &clientHandleList->clientList[i];
             clientHandleList->InUseList[i] = 0;
@@ -114,12 +136,15 @@ int RemoveClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandle
 
     printf(GRN"[+]RemoveClient: Client-%lu (%s:%d) removed from client list\n"reset, clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort);
     fprintf(logs, "[+]RemoveClient: Client-%lu (%s:%d) removed from client list [Time Stamp: %f]\n", clientHandle->ClientID, clientHandle->sClientIP, clientHandle->sClientPort, GetCurrTime(Clock));
+    return 0;
 }
 /**
  * @brief Gets the client handle of the client.
  * @param ClientID The ID of the client.
  * @param clientHandleList The list of client handles.
  * @return The client handle of the client if found, otherwise NULL.
+ * @note The slot may be reused once the list is unlocked, only the owner of the connection (acceptor or reactor) may keep it.
+ *       Other threads reply through SendClientAckByID.
  */
 CLIENT_HANDLE_STRUCT* GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList)
 {
@@ -136,7 +161,7 @@ CLIENT_HANDLE_STRUCT* GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUC
     CLIENT_HANDLE_STRUCT *clientHandle = NULL;
     for(int i = 0; i < MAX_CLIENTS; i++)
     {
-        if(clientHandleList->clientList[i].ClientID == ClientID)
+        if(clientHandleList->InUseList[i] && clientHandleList->clientList[i].ClientID == ClientID)
         {
             clientHandle = &clientHandleList->clientList[i];
             break;
@@ -153,3 +178,249 @@ CLIENT_HANDLE_STRUCT* GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUC
     pthread_mutex_unlock(&clientHandleList->clientListMutex);
     return clientHandle;
 }
+
+/**
+ * @brief Sends as much of the queued output as the socket takes without blocking.
+ * @param client The client handle of the client (sendLock held).
+ * @return 0 on success (some output may still be queued), -1 if the connection failed.
+ * @note Asks the reactor for EPOLLOUT while output is left, and stops asking once it is drained.
+ */
+static int FlushClientLocked(CLIENT_HANDLE_STRUCT *client)
+{
+    while(client->outSent < client->outLen)
+    {
+        ssize_t n = send(client->iClientSocket, client->outBuf + client->outSent, client->outLen - client->outSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        client->outSent += n;
+    }
+    if(client->outSent == client->outLen)
+        client->outSent = client->outLen = 0;
+
+    int wantOut = client->outLen > 0;
+    if(wantOut != client->outArmed)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | (wantOut ? EPOLLOUT : 0);
+        event.data.ptr = client;
+        if(epoll_ctl(client->iEpollFd, EPOLL_CTL_MOD, client->iClientSocket, &event) < 0)
+            return -1;
+        client->outArmed = wantOut;
+    }
+    return 0;
+}
+
+/**
+ * @brief Queues a packet for the client and sends what the socket takes right away.
+ * @param client The client handle of the client.
+ * @param iType The type of the packet (PACKET_TYPE_*).
+ * @param iOpcode The operation the packet belongs to.
+ * @param iRequestID The request the packet belongs to.
+ * @param payload The encoded payload.
+ * @param len The length of the payload.
+ * @return The number of bytes queued on success, -1 on failure.
+ * @note A client that lets more than CLIENT_MAX_BACKLOG bytes pile up is shut down, the reactor then closes it.
+ */
+static int QueueClientPacket(CLIENT_HANDLE_STRUCT *client, int iType, int iOpcode, uint32_t iRequestID, const unsigned char *payload, uint32_t len)
+{
+    pthread_mutex_lock(&client->sendLock);
+    if(client->iClientSocket < 0)
+    {
+        pthread_mutex_unlock(&client->sendLock);
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    // Drop what was already sent before appending
+    if(client->outSent)
+    {
+        memmove(client->outBuf, client->outBuf + client->outSent, client->outLen - client->outSent);
+        client->outLen -= client->outSent;
+        client->outSent = 0;
+    }
+
+    size_t need = client->outLen + PACKET_HEADER_SIZE + len;
+    if(need > CLIENT_MAX_BACKLOG)
+    {
+        fprintf(logs, "[-]QueueClientPacket: Client %lu is not reading its replies, dropping it [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
+        shutdown(client->iClientSocket, SHUT_RDWR);
+        pthread_mutex_unlock(&client->sendLock);
+        errno = ENOBUFS;
+        return -1;
+    }
+    if(need > client->outCap)
+    {
+        size_t cap = client->outCap ? client->outCap : 4096;
+        while(cap < need)
+            cap *= 2;
+        unsigned char *buffer = (unsigned char *)realloc(client->outBuf, cap);
+        if(buffer == NULL)
+        {
+            pthread_mutex_unlock(&client->sendLock);
+            return -1;
+        }
+        client->outBuf = buffer;
+        client->outCap = cap;
+    }
+
+    PACKET_HEADER header;
+    header.iMagic = PROTOCOL_MAGIC;
+    header.iVersion = PROTOCOL_VERSION;
+    header.iType = (uint8_t)iType;
+    header.iOpcode = iOpcode;
+    header.iRequestID = iRequestID;
+    header.iLength = len;
+    EncodeHeader(&header, client->outBuf + client->outLen);
+    if(len)
+        memcpy(client->outBuf + client->outLen + PACKET_HEADER_SIZE, payload, len);
+    client->outLen = need;
+
+    int err = FlushClientLocked(client);
+    if(err < 0)
+        shutdown(client->iClientSocket, SHUT_RDWR);
+    pthread_mutex_unlock(&client->sendLock);
+    return err < 0 ? -1 : (int)(PACKET_HEADER_SIZE + len);
+}
+
+/**
+ * @brief Sends the queued replies that the socket did not take earlier.
+ * @param client The client handle of the client.
+ * @return 0 on success, -1 if the connection failed.
+ * @note Called by the reactor when the socket becomes writable.
+ */
+int FlushClient(CLIENT_HANDLE_STRUCT *client)
+{
+    pthread_mutex_lock(&client->sendLock);
+    int err = client->iClientSocket < 0 ? -1 : FlushClientLocked(client);
+    pthread_mutex_unlock(&client->sendLock);
+    return err;
+}
+
+/**
+ * @brief Sends the client the ID alloted to it.
+ * @param client The client handle of the client.
+ * @return The number of bytes queued on success, -1 on failure.
+ */
+int SendClientID(CLIENT_HANDLE_STRUCT *client)
+{
+    unsigned char payload[8];
+    int len = EncodeID(client->ClientID, payload);
+    return QueueClientPacket(client, PACKET_TYPE_ID, 0, 0, payload, len);
+}
+
+/**
+ * @brief Sends a response to the client.
+ * @param client The client handle of the client.
+ * @param response The response to be sent.
+ * @return The number of bytes queued on success, -1 on failure.
+ * @note Replies to pipelined requests may be sent from different threads, the lock keeps packets whole.
+ */
+int SendClientResponse(CLIENT_HANDLE_STRUCT *client, const RESPONSE_STRUCT *response)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeResponse(response, payload, sizeof(payload));
+    if(len < 0)
+        return -1;
+    return QueueClientPacket(client, PACKET_TYPE_RESPONSE, response->iResponseOperation, response->iResponseRequestID, payload, len);
+}
+
+/**
+ * @brief Sends an ack to the client.
+ * @param client The client handle of the client.
+ * @param iOpcode The operation being acknowledged.
+ * @param ack The ack to be sent.
+ * @return The number of bytes queued on success, -1 on failure.
+ */
+int SendClientAck(CLIENT_HANDLE_STRUCT *client, int iOpcode, const ACK_STRUCT *ack)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeAck(ack, payload, sizeof(payload));
+    if(len < 0)
+        return -1;
+    return QueueClientPacket(client, PACKET_TYPE_ACK, iOpcode, ack->iAckRequestID, payload, len);
+}
+
+/**
+ * @brief Sends an ack to a client that may disconnect meanwhile.
+ * @param ClientID The ID of the client.
+ * @param clientHandleList The client list.
+ * @param iOpcode The operation being acknowledged.
+ * @param ack The ack to be sent.
+ * @return The number of bytes queued on success, -1 if the client is gone or the send failed.
+ * @note The list is locked so that the slot is not reused by another client while the ack is queued.
+ */
+int SendClientAckByID(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList, int iOpcode, const ACK_STRUCT *ack)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeAck(ack, payload, sizeof(payload));
+    if(len < 0)
+        return -1;
+
+    int err = -1;
+    errno = ENOENT;
+    pthread_mutex_lock(&clientHandleList->clientListMutex);
+    for(int i = 0; i < MAX_CLIENTS; i++)
+    {
+        CLIENT_HANDLE_STRUCT *client = &clientHandleList->clientList[i];
+        if(clientHandleList->InUseList[i] && client->ClientID == ClientID)
+        {
+            err = QueueClientPacket(client, PACKET_TYPE_ACK, iOpcode, ack->iAckRequestID, payload, len);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&clientHandleList->clientListMutex);
+    return err;
+}
+
+/**
+ * @brief Sends the results of a batched resolution to the client.
+ * @param client The client handle of the client.
+ * @param iRequestID The request the results belong to.
+ * @param results The result of every path of the batch.
+ * @param count The number of results.
+ * @return The number of bytes queued on success, -1 on failure.
+ */
+int SendClientResolveResults(CLIENT_HANDLE_STRUCT *client, uint32_t iRequestID, const RESOLVE_RESULT_STRUCT *results, int count)
+{
+    unsigned char payload[RESOLVE_RESULT_MAX_PAYLOAD];
+    int len = EncodeResolveResults(results, count, payload, sizeof(payload));
+    if(len < 0)
+        return -1;
+    return QueueClientPacket(client, PACKET_TYPE_RESOLVE_RESULT, CMD_RESOLVE_BATCH, iRequestID, payload, len);
+}
+
+/**
+ * @brief Pushes a lease revocation to every client holding leases.
+ * @param clientHandleList The client list.
+ * @param iEpoch The namespace epoch after the change.
+ * @param iServerID The server whose leases are void (0 for any server).
+ * @param prefix The path at or below which leases are void ("" for every path).
+ * @return The number of clients the revocation was queued for.
+ * @note The list is locked so that no slot is reused while the revocation is queued.
+ */
+int RevokeClientLeases(CLIENT_HANDLE_LIST_STRUCT *clientHandleList, uint64_t iEpoch, unsigned long iServerID, const char *prefix)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeRevoke(iEpoch, iServerID, prefix, payload, sizeof(payload));
+    if(len < 0)
+        return -1;
+
+    int notified = 0;
+    pthread_mutex_lock(&clientHandleList->clientListMutex);
+    for(int i = 0; i < MAX_CLIENTS; i++)
+    {
+        CLIENT_HANDLE_STRUCT *client = &clientHandleList->clientList[i];
+        if(!clientHandleList->InUseList[i] || !client->bHoldsLeases)
+            continue;
+        if(QueueClientPacket(client, PACKET_TYPE_REVOKE, 0, 0, payload, len) >= 0)
+            notified++;
+    }
+    pthread_mutex_unlock(&clientHandleList->clientListMutex);
+    return notified;
+}
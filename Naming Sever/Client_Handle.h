@@ -2,17 +2,33 @@
 #define __CLIENT_HANDLE_H__
 
 #include "../Externals.h"
+#include "../Protocol.h"
 #include <stdio.h>
 #include <pthread.h>
+#include <stdint.h>
 
-#define MAX_CLIENTS 5
+#define MAX_CLIENTS 4096
+#define CLIENT_MAX_BACKLOG (4 * 1024 * 1024) // Unsent reply bytes after which a client that stopped reading is dropped
 
 typedef struct CLIENT_HANDLE_STRUCT
 {
     unsigned long ClientID;
     char sClientIP[IP_LENGTH];
     int sClientPort;
-    int iClientSocket;
+    int iClientSocket;        // Non-blocking, -1 once the connection is closed
+    pthread_mutex_t sendLock; // Guards the output buffer and iClientSocket (reactor and forwarded ACKs)
+
+    // Connection state, driven by the reactor the socket is attached to
+    int iEpollFd;                               // Epoll instance of the reactor
+    unsigned char inHeader[PACKET_HEADER_SIZE]; // Header of the packet being received
+    PACKET_HEADER inPacket;                     // Decoded header (valid once inHave >= PACKET_HEADER_SIZE)
+    uint32_t inHave;                            // Bytes of the packet received so far
+    unsigned char *inPayload;                   // Payload of the packet being received
+    uint32_t inCap;                             // Capacity of inPayload
+    unsigned char *outBuf;                      // Encoded replies not yet taken by the socket
+    size_t outLen, outSent, outCap;
+    int outArmed;                               // 1 if the reactor waits for the socket to be writable
+    int bHoldsLeases;                           // 1 once the client was issued a lease (gets REVOKEs)
 } CLIENT_HANDLE_STRUCT;
 
 typedef struct CLIENT_HANDLE_LIST_STRUCT
@@ -31,4 +47,14 @@ int RemoveClient(unsigned long clientID, CLIENT_HANDLE_LIST_STRUCT *clientHandle
 unsigned long GetClientID(CLIENT_HANDLE_STRUCT *clientHandle);
 CLIENT_HANDLE_STRUCT *GetClient(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList);
 
+// Replies to a client (safe to call from any thread), queued and sent as the socket accepts them
+int SendClientID(CLIENT_HANDLE_STRUCT *client);
+int SendClientResponse(CLIENT_HANDLE_STRUCT *client, const RESPONSE_STRUCT *response);
+int SendClientAck(CLIENT_HANDLE_STRUCT *client, int iOpcode, const ACK_STRUCT *ack);
+int SendClientAckByID(unsigned long ClientID, CLIENT_HANDLE_LIST_STRUCT *clientHandleList, int iOpcode, const ACK_STRUCT *ack);
+int SendClientResolveResults(CLIENT_HANDLE_STRUCT *client, uint32_t iRequestID, const RESOLVE_RESULT_STRUCT *results, int count);
+int FlushClient(CLIENT_HANDLE_STRUCT *client);
+// Pushes a REVOKE to every client holding leases, returns the number of clients notified
+int RevokeClientLeases(CLIENT_HANDLE_LIST_STRUCT *clientHandleList, uint64_t iEpoch, unsigned long iServerID, const char *prefix);
+
 #endif
\ No newline at end of file
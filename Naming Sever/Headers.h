@@ -4,14 +4,18 @@
 #include <stdio.h>
 #include <sys/time.h>
 #include "./Server_Handle.h"
+#include "./Client_Handle.h"
+#include "../Protocol.h"
 
 
 #define MAX_QUEUE_SIZE 5
+#define CLIENT_LISTEN_BACKLOG 128 // Pending client connections (clients connect in bursts)
 #define MAX_PATH_LEN 1024
 #define LOG_FLUSH_INTERVAL 10
 // #define CLOCK_MONOTONIC_RAW 4
 #define MAX_CONN_REQ 10
 #define CONN_TIMEOUT 2
+#define NS_LEASE_TTL_MS 5000 // How long clients may cache a resolution (cut short by a REVOKE)
 
 
 
@@ -28,11 +32,12 @@ double GetCurrTime(CLOCK* clock);
 // global variables
 extern FILE *logs;
 extern CLOCK* Clock;
+extern CLIENT_HANDLE_LIST_STRUCT *clientHandleList;
 
 // Thread to Asynchronously accept client connections
 void* Client_Acceptor_Thread();
-// Thread to handle a client
-void* Client_Handler_Thread(void* clientHandle);
+// Serves one packet of a client (called by the reactor the client is attached to)
+int HandleClientPacket(CLIENT_HANDLE_STRUCT* client, PACKET_HEADER* header, unsigned char* payload);
 
 // Thread to Asynchronously accept Storage Server connections
 void* Storage_Server_Acceptor_Thread();
@@ -45,10 +50,15 @@ void* Log_Flusher_Thread();
 // Function to handle server exit
 void exit_handler();
 
-// Function to check if a socket is connected (Readable)
-int IsSocketConnected(int sockfd);
-
 // Function for path resolution
 SERVER_HANDLE_STRUCT* ResolvePath(char* path);
+// Drops the cached misses (and rebuilds the path filter) when servers register or leave
+void InvalidatePathFilters(int rebuild);
+// Starts a new namespace epoch and pushes a REVOKE to the clients holding leases
+void RevokeLeases(unsigned long ServerID, const char* prefix);
+// Drops cached resolutions under a path (rename, delete) or to a server (server loss)
+void InvalidatePathPrefix(const char* path);
+void InvalidateServerPaths(SERVER_HANDLE_STRUCT* server);
+int ResolveBatch(CLIENT_HANDLE_STRUCT* client, PACKET_HEADER* header, unsigned char* payload);
 
 #endif
\ No newline at end of file
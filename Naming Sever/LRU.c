@@ -3,63 +3,166 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/*
+SHARDED LRU CACHE
+    1. A key is hashed once, the high bits pick the shard and the low bits the bucket
+    2. Every shard has its own mutex, LRU list and chained hash table, so lookups of
+       different paths rarely wait on each other
+    3. Size is tracked per shard (entries and bytes), a shard evicts from its tail as soon
+       as either of its limits is exceeded
+    4. Keys are stored inline in the node, a node costs sizeof(Node) + strlen(key) + 1
+    5. Every shard indexes its entries by path (a tree of DirNodes, one per path at or above
+       an entry, keyed like the mount trie) and by value, so the entries under a prefix or
+       of a server are dropped in time proportional to their number, not to the cache size
+*/
+
+#define SHARD_OF(cache, hash) (&(cache)->shards[((hash) >> 24) & (LRU_SHARD_COUNT - 1)])
 
-int cacheSize(LRUCache *cache)
+uint32_t hashFunction(const char *key, size_t *keyLen)
 {
-    int size = 0;
-    Node *current = cache->head;
-    while (current != NULL)
+    // jenkins_hash (one at a time)
+    const char *start = key;
+    uint32_t hash = 0;
+    while (*key)
     {
-        size++;
-        current = current->next;
+        hash += (unsigned char)(*key++);
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
     }
-    return size;
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    hash += (hash << 15);
+    *keyLen = key - start;
+    return hash;
 }
 
-int hashFunction(const char *key)
+static uint32_t hashBytes(const char *key, size_t len)
 {
-    // Simple hash function for illustration purposes
-    // jenkins_hash
-    unsigned long long hash = 0;
-    while (*key)
+    uint32_t hash = 0;
+    for (size_t i = 0; i < len; i++)
     {
-        hash += (unsigned long long)(*key++);
+        hash += (unsigned char)key[i];
         hash += (hash << 10);
         hash ^= (hash >> 6);
     }
     hash += (hash << 3);
     hash ^= (hash >> 11);
     hash += (hash << 15);
-    return hash % CACHE_SIZE;
+    return hash;
+}
+
+static size_t nodeBytes(const Node *node)
+{
+    return sizeof(Node) + node->keyLen + 1;
+}
+
+static size_t dirBytes(const DirNode *dir)
+{
+    return sizeof(DirNode) + dir->keyLen + 1;
+}
+
+/**
+ * @brief Writes the key a path has in the prefix index
+ * @param path: The path
+ * @param out: Buffer for the key
+ * @param cap: Size of the buffer
+ * @return: The length of the key
+ * @note: The first token (mount root) is dropped and empty tokens are skipped, like in the trie
+*/
+size_t canonicalPath(const char *path, char *out, size_t cap)
+{
+    size_t len = 0;
+    int first = 1;
+    while (*path)
+    {
+        while (*path == '/')
+            path++;
+        if (*path == '\0')
+            break;
+        const char *end = path;
+        while (*end && *end != '/')
+            end++;
+        if (!first)
+        {
+            size_t tokenLen = end - path;
+            if (len + (len > 0) + tokenLen + 1 > cap)
+                break;
+            if (len > 0)
+                out[len++] = '/';
+            memcpy(out + len, path, tokenLen);
+            len += tokenLen;
+        }
+        first = 0;
+        path = end;
+    }
+    out[len] = '\0';
+    return len;
 }
 
 /**
  * @brief Initializes the Cache
- * @return: The cache object 
+ * @param maxEntries: The maximum number of entries (0 for no limit)
+ * @param maxBytes: The maximum number of bytes used by the entries (0 for no limit)
+ * @param indexValues: 1 to group the entries by value for removeValue, 0 if the values are all different
+ *                     (e.g. expiry times) and the cache is never cleared by value
+ * @return: The cache object on success, NULL on failure
+ * @note: The limits are split evenly between the shards
 */
-LRUCache *createCache()
+LRUCache *createCache(size_t maxEntries, size_t maxBytes, int indexValues)
 {
-    LRUCache *cache = (LRUCache *)malloc(sizeof(LRUCache));
-    cache->head = NULL;
-    cache->tail = NULL;
-    for (int i = 0; i < CACHE_SIZE; i++)
+    LRUCache *cache = (LRUCache *)calloc(1, sizeof(LRUCache));
+    if (cache == NULL)
+        return NULL;
+
+    size_t shardEntries = maxEntries ? (maxEntries + LRU_SHARD_COUNT - 1) / LRU_SHARD_COUNT : 0;
+    size_t shardBytes = maxBytes ? (maxBytes + LRU_SHARD_COUNT - 1) / LRU_SHARD_COUNT : 0;
+
+    // Enough buckets to keep the chains short at full capacity
+    size_t buckets = 16;
+    while (shardEntries && buckets < shardEntries)
+        buckets <<= 1;
+
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+        pthread_mutex_init(&cache->shards[i].lock, NULL);
+
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
     {
-        cache->hashmap[i] = NULL;
+        LRUShard *shard = &cache->shards[i];
+        shard->buckets = (Node **)calloc(buckets, sizeof(Node *));
+        shard->dirBuckets = (DirNode **)calloc(buckets, sizeof(DirNode *));
+        if (shard->buckets == NULL || shard->dirBuckets == NULL)
+        {
+            freeCache(cache);
+            return NULL;
+        }
+        shard->bucketMask = buckets - 1;
+        shard->maxEntries = shardEntries;
+        shard->maxBytes = shardBytes;
+        shard->indexValues = indexValues;
     }
     return cache;
 }
 
-Node *createNode(const char *key, void *value)
+Node *createNode(const char *key, size_t keyLen, uint32_t hash, void *value)
 {
-    Node *newNode = (Node *)malloc(sizeof(Node));
-    strcpy(newNode->key, key);
+    Node *newNode = (Node *)malloc(sizeof(Node) + keyLen + 1);
+    if (newNode == NULL)
+        return NULL;
+    memcpy(newNode->key, key, keyLen + 1);
+    newNode->keyLen = keyLen;
+    newNode->hash = hash;
     newNode->value = value;
     newNode->next = NULL;
     newNode->prev = NULL;
+    newNode->hashNext = NULL;
+    newNode->dirNext = newNode->dirPrev = NULL;
+    newNode->valueNext = newNode->valuePrev = NULL;
+    newNode->dir = NULL;
+    newNode->group = NULL;
     return newNode;
 }
 
-void removeFromList(LRUCache *cache, Node *node)
+void removeFromList(LRUShard *shard, Node *node)
 {
     if (node->prev != NULL)
     {
@@ -67,7 +170,7 @@ void removeFromList(LRUCache *cache, Node *node)
     }
     else
     {
-        cache->head = node->next;
+        shard->head = node->next;
     }
 
     if (node->next != NULL)
@@ -76,28 +179,214 @@ void removeFromList(LRUCache *cache, Node *node)
     }
     else
     {
-        cache->tail = node->prev;
+        shard->tail = node->prev;
     }
 }
 
-void moveToHead(LRUCache *cache, Node *node)
+void pushHead(LRUShard *shard, Node *node)
 {
-    removeFromList(cache, node);
-
-    node->next = cache->head;
+    node->next = shard->head;
     node->prev = NULL;
 
-    if (cache->head != NULL)
+    if (shard->head != NULL)
+    {
+        shard->head->prev = node;
+    }
+
+    shard->head = node;
+
+    if (shard->tail == NULL)
+    {
+        shard->tail = node;
+    }
+}
+
+/**
+ * @brief Finds a key in a shard (shard lock held)
+ * @return: The node, NULL if the key is not cached
+*/
+static Node *findNode(LRUShard *shard, const char *key, size_t keyLen, uint32_t hash)
+{
+    Node *node = shard->buckets[hash & shard->bucketMask];
+    while (node != NULL)
+    {
+        if (node->hash == hash && node->keyLen == keyLen && memcmp(node->key, key, keyLen) == 0)
+            return node;
+        node = node->hashNext;
+    }
+    return NULL;
+}
+
+static DirNode *findDir(LRUShard *shard, const char *key, size_t keyLen, uint32_t hash)
+{
+    DirNode *dir = shard->dirBuckets[hash & shard->bucketMask];
+    while (dir != NULL)
     {
-        cache->head->prev = node;
+        if (dir->hash == hash && dir->keyLen == keyLen && memcmp(dir->key, key, keyLen) == 0)
+            return dir;
+        dir = dir->hashNext;
     }
+    return NULL;
+}
 
-    cache->head = node;
+/**
+ * @brief Finds the index node of a path, creating it and the missing ones above it (shard lock held)
+ * @param shard: The shard
+ * @param key: The path as given by canonicalPath
+ * @param keyLen: The length of the path
+ * @return: The node, NULL on failure
+ * @note: A new node has no references, the caller takes one
+*/
+DirNode *getDir(LRUShard *shard, const char *key, size_t keyLen)
+{
+    uint32_t hash = hashBytes(key, keyLen);
+    DirNode *dir = findDir(shard, key, keyLen, hash);
+    if (dir != NULL)
+        return dir;
 
-    if (cache->tail == NULL)
+    dir = (DirNode *)calloc(1, sizeof(DirNode) + keyLen + 1);
+    if (dir == NULL)
+        return NULL;
+    memcpy(dir->key, key, keyLen);
+    dir->keyLen = keyLen;
+    dir->hash = hash;
+
+    if (keyLen > 0)
     {
-        cache->tail = node;
+        size_t parentLen = keyLen;
+        while (parentLen > 0 && key[parentLen - 1] != '/')
+            parentLen--;
+        DirNode *parent = getDir(shard, key, parentLen > 0 ? parentLen - 1 : 0);
+        if (parent == NULL)
+        {
+            free(dir);
+            return NULL;
+        }
+        dir->parent = parent;
+        dir->sibling = parent->child;
+        if (parent->child != NULL)
+            parent->child->prevSibling = dir;
+        parent->child = dir;
+        parent->refs++;
     }
+
+    DirNode **bucket = &shard->dirBuckets[hash & shard->bucketMask];
+    dir->hashNext = *bucket;
+    *bucket = dir;
+    shard->bytes += dirBytes(dir);
+    return dir;
+}
+
+/**
+ * @brief Drops a reference to an index node, freeing it and the nodes above it that are no longer used (shard lock held)
+*/
+void releaseDir(LRUShard *shard, DirNode *dir)
+{
+    while (dir != NULL && --dir->refs == 0)
+    {
+        DirNode **link = &shard->dirBuckets[dir->hash & shard->bucketMask];
+        while (*link != dir)
+            link = &(*link)->hashNext;
+        *link = dir->hashNext;
+
+        DirNode *parent = dir->parent;
+        if (parent != NULL)
+        {
+            if (dir->prevSibling != NULL)
+                dir->prevSibling->sibling = dir->sibling;
+            else
+                parent->child = dir->sibling;
+            if (dir->sibling != NULL)
+                dir->sibling->prevSibling = dir->prevSibling;
+        }
+        shard->bytes -= dirBytes(dir);
+        free(dir);
+        dir = parent;
+    }
+}
+
+/**
+ * @brief Adds a node to the group of its value (shard lock held)
+ * @return: 0 on success, -1 on failure
+*/
+static int joinGroup(LRUShard *shard, Node *node)
+{
+    if (!shard->indexValues)
+    {
+        node->group = NULL;
+        return 0;
+    }
+    ValueGroup *group = shard->groups;
+    while (group != NULL && group->value != node->value)
+        group = group->next;
+    if (group == NULL)
+    {
+        group = (ValueGroup *)calloc(1, sizeof(ValueGroup));
+        if (group == NULL)
+            return -1;
+        group->value = node->value;
+        group->next = shard->groups;
+        shard->groups = group;
+    }
+    node->group = group;
+    node->valuePrev = NULL;
+    node->valueNext = group->entries;
+    if (group->entries != NULL)
+        group->entries->valuePrev = node;
+    group->entries = node;
+    return 0;
+}
+
+/**
+ * @brief Removes a node from the group of its value, freeing the group once empty (shard lock held)
+*/
+static void leaveGroup(LRUShard *shard, Node *node)
+{
+    ValueGroup *group = node->group;
+    if (group == NULL)
+        return;
+    if (node->valuePrev != NULL)
+        node->valuePrev->valueNext = node->valueNext;
+    else
+        group->entries = node->valueNext;
+    if (node->valueNext != NULL)
+        node->valueNext->valuePrev = node->valuePrev;
+    node->group = NULL;
+
+    if (group->entries == NULL)
+    {
+        ValueGroup **link = &shard->groups;
+        while (*link != group)
+            link = &(*link)->next;
+        *link = group->next;
+        free(group);
+    }
+}
+
+/**
+ * @brief Removes a node from the hash table, the LRU list and the indexes of its shard and frees it (shard lock held)
+*/
+void unlinkNode(LRUShard *shard, Node *node)
+{
+    Node **link = &shard->buckets[node->hash & shard->bucketMask];
+    while (*link != node)
+        link = &(*link)->hashNext;
+    *link = node->hashNext;
+
+    DirNode *dir = node->dir;
+    if (node->dirPrev != NULL)
+        node->dirPrev->dirNext = node->dirNext;
+    else
+        dir->entries = node->dirNext;
+    if (node->dirNext != NULL)
+        node->dirNext->dirPrev = node->dirPrev;
+    releaseDir(shard, dir);
+    leaveGroup(shard, node);
+
+    removeFromList(shard, node);
+    shard->count--;
+    shard->bytes -= nodeBytes(node);
+    free(node);
 }
 
 /**
@@ -106,48 +395,70 @@ void moveToHead(LRUCache *cache, Node *node)
  * @param key: The key
  * @param value: The value
  * @return: void
- * @note: If the key already exists, the value is updated and the node is moved to the head
+ * @note: If the key already exists, the value is updated and the node is moved to the head.
+ *        The least recently used entries of the shard are evicted while it is over its limits.
 */
 void put(LRUCache *cache, const char *key, void *value)
 {
-    int index = hashFunction(key) % CACHE_SIZE;
+    size_t keyLen;
+    uint32_t hash = hashFunction(key, &keyLen);
+    LRUShard *shard = SHARD_OF(cache, hash);
+    char path[MAX_PATH_LEN];
+    size_t pathLen = canonicalPath(key, path, sizeof(path));
 
-    if (cache->hashmap[index] != NULL)
+    pthread_mutex_lock(&shard->lock);
+    Node *node = findNode(shard, key, keyLen, hash);
+    if (node != NULL)
     {
         // Key already exists, update value and move to the head
-        Node *node = cache->hashmap[index];
-        node->value = value;
-        moveToHead(cache, node);
-    }
-    else
-    {
-        // Key doesn't exist, create a new node and add to the head
-        Node *newNode = createNode(key, value);
-        cache->hashmap[index] = newNode;
-
-        if (cache->head == NULL)
-        {
-            cache->head = newNode;
-            cache->tail = newNode;
-        }
-        else
+        if (node->value != value)
         {
-            newNode->next = cache->head;
-            cache->head->prev = newNode;
-            cache->head = newNode;
+            leaveGroup(shard, node);
+            node->value = value;
+            joinGroup(shard, node);
         }
+        removeFromList(shard, node);
+        pushHead(shard, node);
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
 
-        // If the cache size exceeds the limit, remove the least recently used node
-        if (cacheSize(cache) > CACHE_SIZE)
+    // Key doesn't exist, create a new node, index it and add to the head
+    node = createNode(key, keyLen, hash, value);
+    DirNode *dir = node != NULL ? getDir(shard, path, pathLen) : NULL;
+    if (dir == NULL || joinGroup(shard, node) < 0)
+    {
+        if (dir != NULL && dir->refs == 0)
         {
-            Node *tail = cache->tail;
-            cache->tail = tail->prev;
-            removeFromList(cache, tail);
-            int removeIndex = hashFunction(tail->key) % CACHE_SIZE;
-            cache->hashmap[removeIndex] = NULL;
-            free(tail);
+            dir->refs++;
+            releaseDir(shard, dir);
         }
+        free(node);
+        pthread_mutex_unlock(&shard->lock);
+        return;
     }
+    node->dir = dir;
+    dir->refs++;
+    node->dirNext = dir->entries;
+    if (dir->entries != NULL)
+        dir->entries->dirPrev = node;
+    dir->entries = node;
+
+    Node **bucket = &shard->buckets[hash & shard->bucketMask];
+    node->hashNext = *bucket;
+    *bucket = node;
+    pushHead(shard, node);
+    shard->count++;
+    shard->bytes += nodeBytes(node);
+
+    // Evict the least recently used nodes, the new node itself always stays
+    while (shard->tail != node &&
+           ((shard->maxEntries && shard->count > shard->maxEntries) ||
+            (shard->maxBytes && shard->bytes > shard->maxBytes)))
+    {
+        unlinkNode(shard, shard->tail);
+    }
+    pthread_mutex_unlock(&shard->lock);
 }
 
 /**
@@ -159,19 +470,159 @@ void put(LRUCache *cache, const char *key, void *value)
 */
 void *get(LRUCache *cache, const char *key)
 {
-    int index = hashFunction(key) % CACHE_SIZE;
-    Node *node = cache->hashmap[index];
+    size_t keyLen;
+    uint32_t hash = hashFunction(key, &keyLen);
+    LRUShard *shard = SHARD_OF(cache, hash);
+    void *value = NULL;
 
+    pthread_mutex_lock(&shard->lock);
+    Node *node = findNode(shard, key, keyLen, hash);
     if (node != NULL)
     {
         // Move the accessed node to the head
-        moveToHead(cache, node);
-        return node->value;
+        if (shard->head != node)
+        {
+            removeFromList(shard, node);
+            pushHead(shard, node);
+        }
+        value = node->value;
+        shard->hits++;
     }
     else
     {
-        return NULL; // Key not found
+        shard->misses++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return value;
+}
+
+/**
+ * @brief Gets the number of entries in the cache
+ * @param cache: The cache object
+ * @return: The number of entries
+*/
+size_t cacheSize(LRUCache *cache)
+{
+    size_t size = 0;
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+    {
+        pthread_mutex_lock(&cache->shards[i].lock);
+        size += cache->shards[i].count;
+        pthread_mutex_unlock(&cache->shards[i].lock);
     }
+    return size;
+}
+
+/**
+ * @brief Gets the number of lookups that hit and missed the cache
+ * @param cache: The cache object
+ * @param hits: Set to the number of hits
+ * @param misses: Set to the number of misses
+*/
+void cacheStats(LRUCache *cache, unsigned long *hits, unsigned long *misses)
+{
+    *hits = *misses = 0;
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+    {
+        pthread_mutex_lock(&cache->shards[i].lock);
+        *hits += cache->shards[i].hits;
+        *misses += cache->shards[i].misses;
+        pthread_mutex_unlock(&cache->shards[i].lock);
+    }
+}
+
+/**
+ * @brief Drops an index node, the ones below it and their entries (shard lock held)
+ * @return: The number of entries dropped
+*/
+static size_t dropDir(LRUShard *shard, DirNode *dir)
+{
+    size_t removed = 0;
+    // Keep the node alive until its subtree is gone
+    dir->refs++;
+    while (dir->child != NULL)
+        removed += dropDir(shard, dir->child);
+    while (dir->entries != NULL)
+    {
+        unlinkNode(shard, dir->entries);
+        removed++;
+    }
+    releaseDir(shard, dir);
+    return removed;
+}
+
+/**
+ * @brief Removes every entry at or below a path
+ * @param cache: The cache object
+ * @param prefix: The path (e.g. Mount/dir removes Mount/dir, Mount/dir/a, Mount//dir/a/b, ...)
+ * @return: The number of entries removed
+ * @note: Runs in time proportional to the entries removed (plus one lookup per shard)
+*/
+size_t removePrefix(LRUCache *cache, const char *prefix)
+{
+    char path[MAX_PATH_LEN];
+    size_t pathLen = canonicalPath(prefix, path, sizeof(path));
+    uint32_t hash = hashBytes(path, pathLen);
+    size_t removed = 0;
+
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+    {
+        LRUShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        DirNode *dir = findDir(shard, path, pathLen, hash);
+        if (dir != NULL)
+            removed += dropDir(shard, dir);
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return removed;
+}
+
+/**
+ * @brief Removes every entry with a given value
+ * @param cache: The cache object
+ * @param value: The value (e.g. the handle of a server that went away)
+ * @return: The number of entries removed
+ * @note: Runs in time proportional to the entries removed (plus the distinct values of each shard),
+ *        a cache created without the value index is scanned
+*/
+size_t removeValue(LRUCache *cache, void *value)
+{
+    size_t removed = 0;
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+    {
+        LRUShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        if (!shard->indexValues)
+        {
+            Node *node = shard->head;
+            while (node != NULL)
+            {
+                Node *next = node->next;
+                if (node->value == value)
+                {
+                    unlinkNode(shard, node);
+                    removed++;
+                }
+                node = next;
+            }
+            pthread_mutex_unlock(&shard->lock);
+            continue;
+        }
+        ValueGroup *group = shard->groups;
+        while (group != NULL && group->value != value)
+            group = group->next;
+        // The group is freed with its last entry
+        Node *node = group != NULL ? group->entries : NULL;
+        while (node != NULL)
+        {
+            Node *next = node->valueNext;
+            unlinkNode(shard, node);
+            removed++;
+            node = next;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return removed;
 }
 
 /**
@@ -180,11 +631,16 @@ void *get(LRUCache *cache, const char *key)
 */
 void printCache(LRUCache *cache)
 {
-    Node *current = cache->head;
-    while (current != NULL)
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
     {
-        printf("(%s, %p) ", current->key, current->value);
-        current = current->next;
+        pthread_mutex_lock(&cache->shards[i].lock);
+        Node *current = cache->shards[i].head;
+        while (current != NULL)
+        {
+            printf("(%s, %p) ", current->key, current->value);
+            current = current->next;
+        }
+        pthread_mutex_unlock(&cache->shards[i].lock);
     }
     printf("\n");
 }
@@ -196,12 +652,14 @@ void printCache(LRUCache *cache)
 */
 void freeCache(LRUCache *cache)
 {
-    Node *current = cache->head;
-    while (current != NULL)
+    if (cache == NULL)
+        return;
+    flushCache(cache);
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
     {
-        Node *temp = current;
-        current = current->next;
-        free(temp);
+        free(cache->shards[i].buckets);
+        free(cache->shards[i].dirBuckets);
+        pthread_mutex_destroy(&cache->shards[i].lock);
     }
     free(cache);
 }
@@ -213,5 +671,39 @@ void freeCache(LRUCache *cache)
 */
 void flushCache(LRUCache* cache)
 {
-    memset(cache, 0, sizeof(LRUCache));
-}
\ No newline at end of file
+    for (int i = 0; i < LRU_SHARD_COUNT; i++)
+    {
+        LRUShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        Node *current = shard->head;
+        while (current != NULL)
+        {
+            Node *temp = current;
+            current = current->next;
+            free(temp);
+        }
+        while (shard->groups != NULL)
+        {
+            ValueGroup *group = shard->groups;
+            shard->groups = group->next;
+            free(group);
+        }
+        if (shard->dirBuckets != NULL)
+        {
+            for (size_t b = 0; b <= shard->bucketMask; b++)
+            {
+                while (shard->dirBuckets[b] != NULL)
+                {
+                    DirNode *dir = shard->dirBuckets[b];
+                    shard->dirBuckets[b] = dir->hashNext;
+                    free(dir);
+                }
+            }
+        }
+        shard->head = shard->tail = NULL;
+        shard->count = shard->bytes = 0;
+        if (shard->buckets != NULL)
+            memset(shard->buckets, 0, (shard->bucketMask + 1) * sizeof(Node *));
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
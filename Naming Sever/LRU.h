@@ -1,40 +1,106 @@
 #ifndef LRU_CACHE_H
 #define LRU_CACHE_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "Headers.h"
 
-// Define the maximum size of the cache
-#define CACHE_SIZE 19
+// Number of independently locked shards, a power of two
+#define LRU_SHARD_COUNT 16
+// Default capacity of the mount cache (whichever limit is hit first evicts)
+#define MOUNT_CACHE_ENTRIES 4096
+#define MOUNT_CACHE_BYTES (1 << 20)
+// Capacity and lifetime of the cache of paths missing from the mount trie
+#define NEGATIVE_CACHE_ENTRIES 4096
+#define NEGATIVE_CACHE_BYTES (1 << 20)
+#define NEGATIVE_CACHE_TTL_MS 2000
+
+struct DirNode;
+struct ValueGroup;
 
 typedef struct Node {
-    char key[MAX_PATH_LEN];
+    struct Node* next;      // LRU list (towards the tail)
+    struct Node* prev;      // LRU list (towards the head)
+    struct Node* hashNext;  // Bucket chain
+    struct Node* dirNext;   // Entries with the same path (spelt differently)
+    struct Node* dirPrev;
+    struct Node* valueNext; // Entries with the same value
+    struct Node* valuePrev;
+    struct DirNode* dir;
+    struct ValueGroup* group;
     void* value;
-    struct Node* next;
-    struct Node* prev;
+    uint32_t hash;
+    uint32_t keyLen;
+    char key[];             // keyLen + 1 bytes, stored inline
 } Node;
 
-typedef struct LRUCache {
+// A path of the prefix index, kept while an entry is at or below it
+typedef struct DirNode {
+    struct DirNode* hashNext;    // Bucket chain
+    struct DirNode* parent;
+    struct DirNode* child;       // First child
+    struct DirNode* sibling;
+    struct DirNode* prevSibling;
+    Node* entries;               // Entries whose path is this one
+    size_t refs;                 // Entries and child paths
+    uint32_t hash;
+    uint32_t keyLen;
+    char key[];                  // Tokens below the mount root joined by '/'
+} DirNode;
+
+// Entries sharing a value (e.g. a server), for dropping them together
+typedef struct ValueGroup {
+    struct ValueGroup* next;
+    void* value;
+    Node* entries;
+} ValueGroup;
+
+// One lock stripe: its own LRU list, hash table and indexes
+typedef struct LRUShard {
+    pthread_mutex_t lock;
     Node* head;
     Node* tail;
-    Node* hashmap[CACHE_SIZE];
+    Node** buckets;
+    DirNode** dirBuckets;
+    ValueGroup* groups;     // Expected to be few (one per server)
+    int indexValues;        // 0 if the cache is never cleared by value, entries then join no group
+    size_t bucketMask;
+    size_t count;
+    size_t bytes;
+    size_t maxEntries;
+    size_t maxBytes;
+    unsigned long hits;
+    unsigned long misses;
+} LRUShard;
+
+typedef struct LRUCache {
+    LRUShard shards[LRU_SHARD_COUNT];
 } LRUCache;
 
 //Global
-LRUCache* createCache(); 
-void put(LRUCache* cache, const char* key, void* value); 
-void* get(LRUCache* cache, const char* key); 
+LRUCache* createCache(size_t maxEntries, size_t maxBytes, int indexValues);
+void put(LRUCache* cache, const char* key, void* value);
+void* get(LRUCache* cache, const char* key);
 void freeCache(LRUCache* cache);
-void printCache(LRUCache* cache); 
+void printCache(LRUCache* cache);
 void flushCache(LRUCache* cache);
+size_t cacheSize(LRUCache* cache);
+void cacheStats(LRUCache* cache, unsigned long* hits, unsigned long* misses);
+size_t removePrefix(LRUCache* cache, const char* prefix);
+size_t removeValue(LRUCache* cache, void* value);
 
 
 //Local Helpers
 /*
-Node* createNode(const char* key, void* value);
-void removeFromList(LRUCache* cache, Node* node);
-void moveToHead(LRUCache* cache, Node* node);
-int cacheSize(LRUCache* cache);
-int hashFunction(const char* key);
+Node* createNode(const char* key, size_t keyLen, uint32_t hash, void* value);
+void removeFromList(LRUShard* shard, Node* node);
+void pushHead(LRUShard* shard, Node* node);
+void unlinkNode(LRUShard* shard, Node* node);
+uint32_t hashFunction(const char* key, size_t* keyLen);
+size_t canonicalPath(const char* path, char* out, size_t cap);
+DirNode* getDir(LRUShard* shard, const char* key, size_t keyLen);
+void releaseDir(LRUShard* shard, DirNode* dir);
 */
 
 #endif /* LRU_CACHE_H */
@@ -5,19 +5,25 @@
 #include <sys/socket.h>
 #include <pthread.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <sys/times.h>
 #include <semaphore.h>
+#include <stdint.h>
+#include <time.h>
 
 // Local Header Files
 #include "./Headers.h"
 #include "./Client_Handle.h"
 #include "./Server_Handle.h"
+#include "./Reactor.h"
 #include "./Trie.h"
 #include "./LRU.h"
+#include "./Bloom.h"
 #include "./ErrorCodes.h"
 
 // Global Header Files
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 
 // Global Variables
@@ -28,10 +34,87 @@ CLOCK *Clock;
 TrieNode *MountTrie;
 pthread_mutex_t MountTrieLock;
 LRUCache *MountCache;
+LRUCache *NegativeCache; // Paths not in the trie, the value is the time (ms) the missing lookup started
+uint64_t NegativeFlushMs;  // Misses of lookups that started at or before this are stale (a server registered meanwhile)
+BLOOM_FILTER *PathFilter;
+uint64_t NamespaceEpoch = 1; // Bumped whenever leased resolutions may have changed
 sem_t serverStartSem;
 
+static uint64_t MonotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Drops what is remembered about missing paths
+ * @param rebuild: Rebuild the path filter from the mount trie (a server left)
+ * @note: Called when servers register or leave
+ */
+void InvalidatePathFilters(int rebuild)
+{
+    if (rebuild)
+    {
+        pthread_mutex_lock(&MountTrieLock);
+        BloomRebuild(PathFilter, MountTrie);
+        pthread_mutex_unlock(&MountTrieLock);
+    }
+    // A lookup that started before the paths were inserted may still put its miss after the flush
+    __atomic_store_n(&NegativeFlushMs, MonotonicMs(), __ATOMIC_SEQ_CST);
+    flushCache(NegativeCache);
+}
+
+/**
+ * @brief Starts a new namespace epoch and voids the matching leases held by clients
+ * @param ServerID: The server whose leases are void (0 for any server)
+ * @param prefix: The path at or below which leases are void ("" for every path)
+ */
+void RevokeLeases(unsigned long ServerID, const char *prefix)
+{
+    uint64_t epoch = __atomic_add_fetch(&NamespaceEpoch, 1, __ATOMIC_SEQ_CST);
+    int notified = RevokeClientLeases(clientHandleList, epoch, ServerID, prefix);
+    fprintf(logs, "[+]RevokeLeases: Epoch %lu, revoked leases under '%s' (server %lu) of %d clients [Time Stamp: %f]\n", (unsigned long)epoch, prefix, ServerID, notified, GetCurrTime(Clock));
+}
+
+/**
+ * @brief Drops the cached resolutions of every path at or below a path
+ * @param path: The path (renamed or deleted)
+ */
+void InvalidatePathPrefix(const char *path)
+{
+    size_t removed = removePrefix(MountCache, path);
+    removed += removePrefix(NegativeCache, path);
+    fprintf(logs, "[+]InvalidatePathPrefix: Dropped %zu cached paths under %s [Time Stamp: %f]\n", removed, path, GetCurrTime(Clock));
+    RevokeLeases(0, path);
+}
+
+/**
+ * @brief Drops the cached resolutions to a server
+ * @param server: The server that went inactive or left
+ */
+void InvalidateServerPaths(SERVER_HANDLE_STRUCT *server)
+{
+    size_t removed = removeValue(MountCache, server);
+    fprintf(logs, "[+]InvalidateServerPaths: Dropped %zu cached paths of server %lu [Time Stamp: %f]\n", removed, server->ServerID, GetCurrTime(Clock));
+    RevokeLeases(server->ServerID, "");
+}
+
+/**
+ * @brief Resolves a path to the server that holds it
+ * @param path: The path
+ * @return: The server handle on success, NULL if the path is not mounted
+ * @note: Paths the filter rules out are rejected without touching the trie, paths missed
+ *        by the trie are remembered for NEGATIVE_CACHE_TTL_MS (unless the filters are invalidated)
+ */
 SERVER_HANDLE_STRUCT *ResolvePath(char *path)
 {
+    if (!BloomMayContainPath(PathFilter, path))
+    {
+        fprintf(logs, "[-]ResolvePath: Path %s rejected by path filter [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+        return NULL;
+    }
+
     // Check if the path is in the cache
     SERVER_HANDLE_STRUCT *server = get(MountCache, path);
     if (server != NULL)
@@ -40,12 +123,22 @@ SERVER_HANDLE_STRUCT *ResolvePath(char *path)
         return server;
     }
 
+    // Check if the path recently missed, a miss from before the last invalidation does not count
+    uint64_t started = MonotonicMs();
+    uint64_t missed = (uint64_t)(uintptr_t)get(NegativeCache, path);
+    if (missed > __atomic_load_n(&NegativeFlushMs, __ATOMIC_SEQ_CST) && started < missed + NEGATIVE_CACHE_TTL_MS)
+    {
+        fprintf(logs, "[-]ResolvePath: Path %s found in negative cache [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+        return NULL;
+    }
+
     // Resolve the path
     server = Get_Server(MountTrie, path);
 
     if (server == NULL)
     {
         fprintf(logs, "[-]ResolvePath: Path %s not found in mount trie [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+        put(NegativeCache, path, (void *)(uintptr_t)started);
     }
     else
     {
@@ -58,21 +151,76 @@ SERVER_HANDLE_STRUCT *ResolvePath(char *path)
 }
 
 /**
- * @brief Checks if the given socket is connected( Readable )
- * @param sockfd: The socket to check
- * @return: 1 if the socket is connected, 0 if the socket is disconnected, -1 on error
- * @note: This function is non-blocking
+ * @brief Resolves every path of a batch and answers with a single reply
+ * @param client: The client that sent the batch
+ * @param header: The header of the batch packet
+ * @param payload: The payload of the batch packet (paths are decoded in place)
+ * @return: The number of bytes sent on success, -1 on failure
+ * @note: Every path gets the same treatment as a READ/INFO request (backup on an inactive server)
  */
-int IsSocketConnected(int sockfd)
+int ResolveBatch(CLIENT_HANDLE_STRUCT *client, PACKET_HEADER *header, unsigned char *payload)
 {
-    // Use recv with MSG_PEEK to check if the socket is connected
-    char buff[1];
-    int iRecvStatus = recv(sockfd, buff, sizeof(buff), MSG_PEEK);
-    if (CheckError(iRecvStatus, "[-]IsSocketConnected: Error in receiving data from socket"))
-        return -1;
-    else if (iRecvStatus == 0)
-        return 0;
-    return 1;
+    char *paths[MAX_RESOLVE_BATCH];
+    RESOLVE_RESULT_STRUCT results[MAX_RESOLVE_BATCH];
+
+    // A malformed batch is answered with no results
+    int count = DecodeResolveBatch(payload, header->iLength, paths, MAX_RESOLVE_BATCH);
+    if (count < 0)
+    {
+        fprintf(logs, "[-]ResolveBatch: Malformed batch from client %lu [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
+        return SendClientResolveResults(client, header->iRequestID, results, 0);
+    }
+
+    // Leases carry the epoch from before the resolution, so a revocation racing with it wins
+    // (the client is marked first, so that revocation is pushed to it)
+    __atomic_store_n(&client->bHoldsLeases, 1, __ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_load_n(&NamespaceEpoch, __ATOMIC_SEQ_CST);
+
+    printf(GRN "[+]ResolveBatch: Client %lu requested to resolve %d paths\n" reset, client->ClientID, count);
+    fprintf(logs, "[+]ResolveBatch: Client %lu requested to resolve %d paths [Time Stamp: %f]\n", client->ClientID, count, GetCurrTime(Clock));
+
+    for (int i = 0; i < count; i++)
+    {
+        RESOLVE_RESULT_STRUCT *result = &results[i];
+        memset(result, 0, sizeof(RESOLVE_RESULT_STRUCT));
+        result->iErrorCode = CMD_ERROR_SUCCESS;
+        result->iFlags = RESPONSE_FLAG_SUCCESS;
+
+        SERVER_HANDLE_STRUCT *server = ResolvePath(paths[i]);
+        if (server == NULL)
+        {
+            result->iErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            result->iFlags = RESPONSE_FLAG_FAILURE;
+            continue;
+        }
+
+        // Switch to a backup server if the server is not active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
+            if (server == NULL)
+            {
+                fprintf(logs, "[-]ResolveBatch: No active backup server for path %s [Time Stamp: %f]\n", paths[i], GetCurrTime(Clock));
+                result->iErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
+                result->iFlags = RESPONSE_FLAG_FAILURE;
+                continue;
+            }
+            result->iFlags = BACKUP_RESPONSE;
+        }
+
+        result->iServerID = server->ServerID;
+        strncpy(result->sServerIP, server->sServerIP, IP_LENGTH - 1);
+        result->iServerPort = server->sServerPort_Client;
+        // Only resolutions to the primary server are leased, a backup is a temporary answer
+        if (result->iFlags == RESPONSE_FLAG_SUCCESS)
+        {
+            result->iLeaseTTL = NS_LEASE_TTL_MS;
+            result->iEpoch = epoch;
+        }
+        fprintf(logs, "[+]ResolveBatch: Resolved path %s to server %lu (%s:%d) [Time Stamp: %f]\n", paths[i], server->ServerID, server->sServerIP, server->sServerPort_Client, GetCurrTime(Clock));
+    }
+
+    return SendClientResolveResults(client, header->iRequestID, results, count);
 }
 
 /**
@@ -152,10 +300,14 @@ void *Client_Acceptor_Thread()
         exit(EXIT_FAILURE);
 
     // Listen for connections
-    int iListenStatus = listen(iServerSocket, MAX_QUEUE_SIZE);
+    int iListenStatus = listen(iServerSocket, CLIENT_LISTEN_BACKLOG);
     if (CheckError(iListenStatus, "[-]Client Acceptor Thread: Error in listening for connections"))
         exit(EXIT_FAILURE);
 
+    // Connections are served by a few reactors instead of a thread per client
+    if (CheckError(InitClientReactors(NS_REACTOR_COUNT), "[-]Client Acceptor Thread: Error in starting the reactors"))
+        exit(EXIT_FAILURE);
+
     printf(GRN "[+]Client Acceptor Thread: Listening for connections\n" reset);
     fprintf(logs, "[+]Client Acceptor Thread: Listening for connections [Time Stamp: %f]\n", GetCurrTime(Clock));
 
@@ -171,9 +323,19 @@ void *Client_Acceptor_Thread()
             continue;
         }
 
+        // The reactors never block on the socket
+        int iFlags = fcntl(iClientSocket, F_GETFL, 0);
+        if (CheckError(fcntl(iClientSocket, F_SETFL, iFlags | O_NONBLOCK), "[-]Client Acceptor Thread: Error in making socket non-blocking"))
+        {
+            fprintf(logs, "[-]Client Acceptor Thread: Error in making socket non-blocking [Time Stamp: %f]\n", GetCurrTime(Clock));
+            close(iClientSocket);
+            continue;
+        }
+
         // Store the client IP and Port in Client Handle Struct
         CLIENT_HANDLE_STRUCT clientHandle;
-        strncpy(clientHandle.sClientIP, inet_ntoa(client_address.sin_addr), IP_LENGTH);
+        memset(&clientHandle, 0, sizeof(clientHandle));
+        strncpy(clientHandle.sClientIP, inet_ntoa(client_address.sin_addr), IP_LENGTH - 1);
         clientHandle.sClientPort = ntohs(client_address.sin_port);
         clientHandle.iClientSocket = iClientSocket;
 
@@ -185,325 +347,327 @@ void *Client_Acceptor_Thread()
             continue;
         }
 
-        // Create a thread to handle the client
-        pthread_t tClientHandlerThread;
-        int iThreadStatus = pthread_create(&tClientHandlerThread, NULL, Client_Handler_Thread, (void *)&clientHandle);
-        if (CheckError(iThreadStatus, "[-]Client Acceptor Thread: Error in creating thread"))
+        // Hand the reactor the entry in the client list (clientHandle is reused by the next accept)
+        CLIENT_HANDLE_STRUCT *client = GetClient(clientHandle.ClientID, clientHandleList);
+        if (CheckError(AttachClient(client), "[-]Client Acceptor Thread: Error in attaching client to a reactor"))
         {
-            fprintf(logs, "[-]Client Acceptor Thread: Error in creating thread [Time Stamp: %f]\n", GetCurrTime(Clock));
+            fprintf(logs, "[-]Client Acceptor Thread: Error in attaching client to a reactor [Time Stamp: %f]\n", GetCurrTime(Clock));
+            RemoveClient(clientHandle.ClientID, clientHandleList);
             close(iClientSocket);
             continue;
         }
+        printf(UGRN "[+]Client Acceptor Thread: Client %lu (%s:%d) attached to a reactor\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
+        fprintf(logs, "[+]Client Acceptor Thread: Client %lu (%s:%d) attached to a reactor [Time Stamp: %f]\n", client->ClientID, client->sClientIP, client->sClientPort, GetCurrTime(Clock));
+
+        // Send The Client It alloted ID (if it fails the reactor sees the connection shut down and closes it)
+        if (CheckError(SendClientID(client), "[-]Client Acceptor Thread: Error in sending data to client"))
+            fprintf(logs, "[-]Client Acceptor Thread: Error in sending data to client [Time Stamp: %f]\n", GetCurrTime(Clock));
     }
 
     return NULL;
 }
 
-void *Client_Handler_Thread(void *clientHandle)
+/**
+ * @brief Serves one packet received from a client.
+ * @param client The client that sent the packet.
+ * @param header The header of the packet.
+ * @param payload The payload of the packet (may be modified).
+ * @return 0 if the connection goes on, 1 if the client asked to close it, -1 if the reply could not be sent.
+ */
+int HandleClientPacket(CLIENT_HANDLE_STRUCT *client, PACKET_HEADER *header, unsigned char *payload)
 {
-    CLIENT_HANDLE_STRUCT *client = (CLIENT_HANDLE_STRUCT *)clientHandle;
-    printf(UGRN "[+]Client Handler Thread Initialized for Client %lu (%s:%d)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-    fprintf(logs, "[+]Client Handler Thread Initialized for Client %lu (%s:%d) [Time Stamp: %f]\n", client->ClientID, client->sClientIP, client->sClientPort, GetCurrTime(Clock));
-
-    /*
-    // Send data to the client
-    char sServerResponse[MAX_BUFFER_SIZE];
-    sprintf(sServerResponse, "Hello Client %lu", client->ClientID);
-    int iSendStatus = send(client->iClientSocket, sServerResponse, sizeof(sServerResponse), 0);
-    if(CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending data to client")) return NULL;
-
-    // Receive data from the client
-    char sClientRequest[MAX_BUFFER_SIZE];
-    int iRecvStatus = recv(client->iClientSocket, &sClientRequest, sizeof(sClientRequest), 0);
-    if(CheckError(iRecvStatus, "[-]Client Handler Thread: Error in receiving data from client")) return NULL;
-
-    printf(GRN"[+]Client Handler Thread: Client %lu sent: %s\n"reset, client->ClientID, sClientRequest);
-    fprintf(logs, "[+]Client Handler Thread: Client %lu sent: %s\n", client->ClientID, sClientRequest);
-    */
-
-    // Send The Client It alloted ID
-    unsigned long ClientID = client->ClientID;
-    int iSendStatus = send(client->iClientSocket, &ClientID, sizeof(unsigned long), 0);
-    if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending data to client"))
-    {
-        fprintf(logs, "[-]Client Handler Thread: Error in sending data to client [Time Stamp: %f]\n", GetCurrTime(Clock));
-        RemoveClient(ClientID, clientHandleList);
-        close(client->iClientSocket);
-        return NULL;
+    // Batched resolutions are answered with a single reply
+    if (header->iType == PACKET_TYPE_RESOLVE_BATCH)
+    {
+        if (ResolveBatch(client, header, payload) < 0)
+        {
+            fprintf(logs, "[-]Client Handler Thread: Error in sending resolutions to client %lu [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
+            return -1;
+        }
+        return 0;
     }
 
-    // Set Up request listener for the client
-    int ConnStatus, CloseRequest = 0;
-    while (ConnStatus = IsSocketConnected(client->iClientSocket))
+    REQUEST_STRUCT request;
+    memset(&request, 0, sizeof(request));
+    if (header->iType != PACKET_TYPE_REQUEST || DecodeRequest(payload, header->iLength, &request) < 0)
+    {
+        fprintf(logs, "[-]Client Handler Thread: Malformed packet (Type: %d) from client %lu [Time Stamp: %f]\n", header->iType, client->ClientID, GetCurrTime(Clock));
+        return 0;
+    }
+    request.iRequestOperation = header->iOpcode;
+    request.iRequestID = header->iRequestID;
+    // Check if the client requested to close the connection
+    if (request.iRequestOperation == CLOSE_CONNECTION)
     {
-        // Receive the request from the client
-        REQUEST_STRUCT request;
+        printf(UGRN "[+]Client Handler Thread: Client %lu requested to close connection\n" reset, client->ClientID);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested to close connection\n", client->ClientID);
+        return 1;
+    }
+    // Handle the request (Generate a response)
+    RESPONSE_STRUCT response;
+    memset(&response, 0, sizeof(response));
+    response.iResponseOperation = request.iRequestOperation;
+    response.iResponseRequestID = request.iRequestID;
+    response.iResponseErrorCode = CMD_ERROR_SUCCESS;
+
+    switch (request.iRequestOperation)
+    {
+    case CMD_READ:
+    {
+        printf(GRN "[+]Client Handler Thread: Client %lu requested to read file %s\n" reset, client->ClientID, request.sRequestPath);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested to read file %s [Time Stamp: %f]\n", client->ClientID, request.sRequestPath, GetCurrTime(Clock));
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
 
-        int iRecvStatus = recv(client->iClientSocket, &request, sizeof(request), 0);
-        if (CheckError(iRecvStatus, "[-]Client Handler Thread: Error in receiving data from client"))
+        if (server == NULL)
         {
-            fprintf(logs, "[-]Client Handler Thread: Error in receiving data from client [Time Stamp: %f]\n", GetCurrTime(Clock));
-            RemoveClient(ClientID, clientHandleList);
-            close(client->iClientSocket);
-            return NULL;
-        }
-        else if (iRecvStatus == 0)
-            break;
-        // Check if the client requested to close the connection
-        if (request.iRequestOperation == CLOSE_CONNECTION)
-        {
-            printf(UGRN "[+]Client Handler Thread: Client %lu requested to close connection\n" reset, client->ClientID);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to close connection\n", client->ClientID);
-            CloseRequest = 1;
+            printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
             break;
         }
-        // Handle the request (Generate a response)
-        RESPONSE_STRUCT response;
-        memset(&response, 0, sizeof(response));
-        response.iResponseOperation = request.iRequestOperation;
-        response.iResponseErrorCode = CMD_ERROR_SUCCESS;
 
-        switch (request.iRequestOperation)
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
         {
-        case CMD_READ:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to read file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to read file %s [Time Stamp: %f]\n", client->ClientID, request.sRequestPath, GetCurrTime(Clock));
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
+            // Switch to backup server
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
             if (server == NULL)
             {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu [Time Stamp: %f]\n", client->ClientID, GetCurrTime(Clock));
+                fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
+                response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
                 response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
                 break;
             }
+            response.iResponseFlags = BACKUP_RESPONSE;
+            fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
+        }
 
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                // Switch to backup server
-                server = GetActiveBackUp(serverHandleList, server->backupServers);
-                if (server == NULL)
-                {
-                    fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
-                    response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
-                    response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                    break;
-                }
-                response.iResponseFlags = BACKUP_RESPONSE;
-                fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
-            }
+        printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Populate the response struct with Server IP and Port
+        snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response.iResponseServerID = server->ServerID;
+        break;
+    }
+    case CMD_WRITE:
+    {
+        printf(GRN "[+]Client Handler Thread: Client %lu requested to write file %s\n" reset, client->ClientID, request.sRequestPath);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested to write file %s\n", client->ClientID, request.sRequestPath);
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
 
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
+        if (server == NULL)
+        {
+            printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
             break;
         }
-        case CMD_WRITE:
+
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
         {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to write file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to write file %s\n", client->ClientID, request.sRequestPath);
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
+            break;
+        }
 
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
+        printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Populate the response struct with Server IP and Port
+        snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response.iResponseServerID = server->ServerID;
+        break;
+    }
+    case CMD_INFO:
+    {
+        printf(GRN "[+]Client Handler Thread: Client %lu requested info for file %s\n" reset, client->ClientID, request.sRequestPath);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested info for file %s\n", client->ClientID, request.sRequestPath);
 
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
-                break;
-            }
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
 
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
+        if (server == NULL)
+        {
+            printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
             break;
         }
-        case CMD_INFO:
-        {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested info for file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested info for file %s\n", client->ClientID, request.sRequestPath);
 
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
 
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
+        {
+            // Switch to backup server
+            server = GetActiveBackUp(serverHandleList, server->backupServers);
             if (server == NULL)
             {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
+                fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
+                response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
                 response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
                 break;
             }
+            response.iResponseFlags = BACKUP_RESPONSE;
+            fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
+        }
 
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
-
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                // Switch to backup server
-                server = GetActiveBackUp(serverHandleList, server->backupServers);
-                if (server == NULL)
-                {
-                    fprintf(logs, "[-]Client Handler Thread: Error in getting active backup server for client %lu\n", client->ClientID);
-                    response.iResponseErrorCode = CMD_ERROR_BACKUP_UNAVAILABLE;
-                    response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                    break;
-                }
-                response.iResponseFlags = BACKUP_RESPONSE;
-                fprintf(logs, "[+]Client Handler Thread: Switched to backup server %lu (%s:%d) for client %lu\n", server->ServerID, server->sServerIP, server->sServerPort_Client, client->ClientID);
-            }
+        printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
 
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Populate the response struct with Server IP and Port
+        snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+        response.iResponseServerID = server->ServerID;
 
-            // Populate the response struct with Server IP and Port
-            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
-            response.iResponseServerID = server->ServerID;
+        break;
+    }
+    case CMD_LIST:
+    {
+        printf(GRN "[+]Client Handler Thread: Client %lu requested to list directory %s\n" reset, client->ClientID, request.sRequestPath);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested to list directory %s\n", client->ClientID, request.sRequestPath);
 
-            break;
-        }
-        case CMD_LIST:
+        // Below an export point only the storage server knows the files, send the client there
+        if (Is_Exported(MountTrie, request.sRequestPath))
         {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to list directory %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to list directory %s\n", client->ClientID, request.sRequestPath);
-
-            // Populate the response struct with paths under requested path
-            int err = Get_Directory_Tree(MountTrie, request.sRequestPath, response.sResponseData);
-            if (err == -2)
-            {
-                printf(RED "[-]Client Handler Thread: Error in getting directory tree for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in getting directory tree for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = ERROR_GETTING_MOUNT_PATHS;
-                break;
-            }
-            else if (err == -1)
+            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
+            if (server == NULL || IsActive(server->ServerID, serverHandleList) == 0)
             {
-                printf(RED "[-]Client Handler Thread: Invalid Path %s for client %lu\n" reset, request.sRequestPath, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Invalid Path %s for client %lu\n", request.sRequestPath, client->ClientID);
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+                printf(RED "[-]Client Handler Thread: Server of %s unavailable for client %lu\n" reset, request.sRequestPath, client->ClientID);
+                fprintf(logs, "[-]Client Handler Thread: Server of %s unavailable for client %lu\n", request.sRequestPath, client->ClientID);
                 response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+                response.iResponseErrorCode = server == NULL ? CMD_ERROR_PATH_NOT_FOUND : CMD_ERROR_SERVER_UNAVAILABLE;
                 break;
             }
 
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+            fprintf(logs, "[+]Client Handler Thread: Redirected listing of %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+            snprintf(response.sResponseData, MAX_BUFFER_SIZE, "%s %d", server->sServerIP, server->sServerPort_Client);
+            response.iResponseServerID = server->ServerID;
+            response.iResponseFlags = RESPONSE_FLAG_REDIRECT;
             response.iResponseErrorCode = CMD_ERROR_SUCCESS;
-
             break;
         }
 
-        case CMD_RENAME:
+        // Populate the response struct with paths under requested path (down to the export points)
+        // Child tables are resized by inserts, so the walk holds the trie lock
+        pthread_mutex_lock(&MountTrieLock);
+        int err = Get_Directory_Tree(MountTrie, request.sRequestPath, response.sResponseData);
+        pthread_mutex_unlock(&MountTrieLock);
+        if (err == -2)
         {
-            printf(GRN "[+]Client Handler Thread: Client %lu requested to rename file %s\n" reset, client->ClientID, request.sRequestPath);
-            fprintf(logs, "[+]Client Handler Thread: Client %lu requested to rename file %s\n", client->ClientID, request.sRequestPath);
-
-            char path[MAX_BUFFER_SIZE];
-            strncpy(path, request.sRequestPath, MAX_BUFFER_SIZE);
-            strtok(path, " ");
-
-            // Do a path resolution
-            SERVER_HANDLE_STRUCT *server = ResolvePath(request.sRequestPath);
-
-            if (server == NULL)
-            {
-                printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
-                break;
-            }
+            printf(RED "[-]Client Handler Thread: Error in getting directory tree for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in getting directory tree for client %lu\n", client->ClientID);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = ERROR_GETTING_MOUNT_PATHS;
+            break;
+        }
+        else if (err == -1)
+        {
+            printf(RED "[-]Client Handler Thread: Invalid Path %s for client %lu\n" reset, request.sRequestPath, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Invalid Path %s for client %lu\n", request.sRequestPath, client->ClientID);
+            response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            break;
+        }
 
-            response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        response.iResponseErrorCode = CMD_ERROR_SUCCESS;
 
-            // Check if the server is active
-            if (IsActive(server->ServerID, serverHandleList) == 0)
-            {
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
-                break;
-            }
+        break;
+    }
 
-            // Populate the response struct with Server ID
-            response.iResponseServerID = server->ServerID;
+    case CMD_RENAME:
+    {
+        printf(GRN "[+]Client Handler Thread: Client %lu requested to rename file %s\n" reset, client->ClientID, request.sRequestPath);
+        fprintf(logs, "[+]Client Handler Thread: Client %lu requested to rename file %s\n", client->ClientID, request.sRequestPath);
 
-            printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
-            fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        // Request path is "<Source Path> <New Name>", resolve the source path
+        char path[MAX_BUFFER_SIZE];
+        strncpy(path, request.sRequestPath, MAX_BUFFER_SIZE);
+        strtok(path, " ");
 
-            // Forward the request to the server
-            int iSendStatus = send(server->sSocket_Write, &request, sizeof(request), 0);
-            if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending request to server"))
-            {
-                printf(RED "[-]Client Handler Thread: Error in sending request to server for client %lu\n" reset, client->ClientID);
-                fprintf(logs, "[-]Client Handler Thread: Error in sending request to server for client %lu\n", client->ClientID);
-                response.iResponseFlags = RESPONSE_FLAG_FAILURE;
-                response.iResponseErrorCode = CMD_ERROR_FWD_FAILED;
-                break;
-            }
+        // Do a path resolution
+        SERVER_HANDLE_STRUCT *server = ResolvePath(path);
 
-            strncpy(response.sResponseData, "Request forwarded to server", MAX_BUFFER_SIZE);
+        if (server == NULL)
+        {
+            printf(RED "[-]Client Handler Thread: Error in resolving path for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in resolving path for client %lu\n", client->ClientID);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_PATH_NOT_FOUND;
             break;
         }
 
-        default:
+        response.iResponseFlags = RESPONSE_FLAG_SUCCESS;
+
+        // Check if the server is active
+        if (IsActive(server->ServerID, serverHandleList) == 0)
         {
-            response.iResponseErrorCode = CMD_ERROR_INVALID_OPERATION;
             response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_SERVER_UNAVAILABLE;
             break;
         }
+
+        // Populate the response struct with Server ID
+        response.iResponseServerID = server->ServerID;
+
+        printf(GRN "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n" reset, request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+        fprintf(logs, "[+]Client Handler Thread: Resolved path %s to server %lu (%s:%d)\n", request.sRequestPath, server->ServerID, server->sServerIP, server->sServerPort_Client);
+
+        // Resolutions of the source subtree and misses of the destination go stale with the rename
+        InvalidatePathPrefix(path);
+        char *last_slash = strrchr(path, '/');
+        if (strlen(request.sRequestPath) > strlen(path) && last_slash != NULL)
+        {
+            char *new_name = request.sRequestPath + strlen(path) + 1;
+            char new_path[MAX_BUFFER_SIZE];
+            snprintf(new_path, MAX_BUFFER_SIZE, "%.*s/%s", (int)(last_slash - path), path, new_name);
+            InvalidatePathPrefix(new_path);
         }
 
-        // Send the response to the client
-        int iSendStatus = send(client->iClientSocket, &response, sizeof(response), 0);
-        if (iSendStatus != sizeof(response))
+        // Forward the request to the server (the ack is sent to the client once the server replies)
+        pthread_mutex_lock(&server->sendLock);
+        int iSendStatus = SendRequest(server->sSocket_Read, &request);
+        pthread_mutex_unlock(&server->sendLock);
+        if (CheckError(iSendStatus, "[-]Client Handler Thread: Error in sending request to server"))
         {
-            printf(RED "[-]Client Handler Thread: Error in sending response to client %lu\n" reset, client->ClientID);
-            fprintf(logs, "[-]Client Handler Thread: Error in sending response to client %lu\n", client->ClientID);
+            printf(RED "[-]Client Handler Thread: Error in sending request to server for client %lu\n" reset, client->ClientID);
+            fprintf(logs, "[-]Client Handler Thread: Error in sending request to server for client %lu\n", client->ClientID);
+            response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+            response.iResponseErrorCode = CMD_ERROR_FWD_FAILED;
             break;
         }
 
-        printf(GRN "[+]Client Handler Thread: Sent response to client %lu\n" reset, client->ClientID);
-        fprintf(logs, "[+]Client Handler Thread: Sent response {%s} to client %lu\n", response.sResponseData, client->ClientID);
+        strncpy(response.sResponseData, "Request forwarded to server", MAX_BUFFER_SIZE);
+        break;
     }
-    if (CheckError(ConnStatus, "[-]Client Handler Thread: Error in checking if socket is connected"))
+
+    default:
     {
-        printf(RED "[-]Client Handler Thread: Error in checking if socket is connected for client %lu\n" reset, client->ClientID);
-        fprintf(logs, "[-]Client Handler Thread: Error in checking if socket is connected for client %lu\n", client->ClientID);
+        response.iResponseErrorCode = CMD_ERROR_INVALID_OPERATION;
+        response.iResponseFlags = RESPONSE_FLAG_FAILURE;
+        break;
     }
-    else if (CloseRequest)
-    {
-        printf(BHGRN "[+]Client Handler Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-        fprintf(logs, "[+]Client Handler Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)\n", client->ClientID, client->sClientIP, client->sClientPort);
     }
-    else
+
+    // Send the response to the client
+    int iSendStatus = SendClientResponse(client, &response);
+    if (iSendStatus < 0)
     {
-        printf(BHRED "[-]Client Handler Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
-        fprintf(logs, "[-]Client Handler Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)\n", client->ClientID, client->sClientIP, client->sClientPort);
+        printf(RED "[-]Client Handler Thread: Error in sending response to client %lu\n" reset, client->ClientID);
+        fprintf(logs, "[-]Client Handler Thread: Error in sending response to client %lu\n", client->ClientID);
+        return -1;
     }
 
-    // Close the socket
-    RemoveClient(ClientID, clientHandleList);
-    close(client->iClientSocket);
-
-    return NULL;
+    printf(GRN "[+]Client Handler Thread: Sent response to client %lu\n" reset, client->ClientID);
+    fprintf(logs, "[+]Client Handler Thread: Sent response {%s} to client %lu\n", response.sResponseData, client->ClientID);
+    return 0;
 }
 
 void *Storage_Server_Acceptor_Thread()
@@ -589,8 +753,8 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
 
     // Recieve the Server Init Packet
     STORAGE_SERVER_INIT_STRUCT serverInitPacket;
-    int iRecvStatus = recv(server->sSocket_Write, &serverInitPacket, sizeof(serverInitPacket), 0);
-    if (CheckError(iRecvStatus, "[-]Storage Server Handler Thread: Error in receiving data from server"))
+    int iRecvStatus = RecvInit(server->sSocket_Write, &serverInitPacket);
+    if (CheckError(iRecvStatus, "[-]Storage Server Handler Thread: Error in receiving data from server") || iRecvStatus == 0)
     {
         RemoveServer(GetServerID(server), serverHandleList);
         close(server->sSocket_Write);
@@ -601,28 +765,39 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     server->sServerPort_Client = serverInitPacket.sServerPort_Client;
     server->sServerPort_NServer = serverInitPacket.sServerPort_NServer;
 
-    // Extract indivisual path from the mount paths string (tokenize on \n) and Insert into the mount trie
+    // Extract the export points from the mount paths string (tokenize on \n) and Insert into the mount trie
+    // Files below an export point stay with the server, they are resolved by longest prefix
     char *token = serverInitPacket.MountPaths;
+    pthread_mutex_lock(&MountTrieLock);
     while (strlen(token))
     {
         char *path_tok = __strtok_r(token, "\n", &token);
         // Removing the the first token in the path [e.g. (server name/~) , (./~) , (mount/~) , etc.]
-        // Is handled by the Insert_Path function
+        // Is handled by the Insert_Path function (and BloomAddPath)
+        BloomAddPath(PathFilter, path_tok);
         int err_code = Insert_Path(MountTrie, path_tok, server);
         if (CheckError(err_code, "[-]Storage Server Handler Thread: Error in inserting path into mount trie"))
         {
+            pthread_mutex_unlock(&MountTrieLock);
             fprintf(logs, "[-]Storage Server Handler Thread: Error in inserting path into mount trie\n");
             RemoveServer(GetServerID(server), serverHandleList);
             close(server->sSocket_Write);
+            InvalidateServerPaths(server);
+            InvalidatePathFilters(1);
             return NULL;
         }
     }
+    pthread_mutex_unlock(&MountTrieLock);
+    // Paths that missed before may be mounted now
+    InvalidatePathFilters(0);
 
     printf(GRN "[+]Storage Server Handler Thread: Server %lu (%s:%d) Paths Inserted\n" reset, server->ServerID, server->sServerIP, server->sServerPort);
     fprintf(logs, "[+]Storage Server Handler Thread: Server %lu (%s:%d) Paths Inserted [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort, GetCurrTime(Clock));
 
     printf(BHWHT "{Current Mount Trie}\n" reset);
+    pthread_mutex_lock(&MountTrieLock);
     Print_Trie(MountTrie, 0);
+    pthread_mutex_unlock(&MountTrieLock);
 
     // Set Up the Backup Servers for the server
     int err_code = AssignBackupServer(serverHandleList, server->ServerID);
@@ -637,7 +812,7 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
 
     // Send the server ID to the server
     unsigned long ServerID = server->ServerID;
-    int iSendStatus = send(server->sSocket_Write, &ServerID, sizeof(unsigned long), 0);
+    int iSendStatus = SendID(server->sSocket_Write, ServerID);
     if (CheckError(iSendStatus, "[-]Storage Server Handler Thread: Error in sending ID to server"))
     {
         fprintf(logs, "[-]Storage Server Handler Thread: Error in sending data to server [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -686,14 +861,15 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     printf(GRN "[+]Storage Server Handler Thread: Connected to server %lu (%s:%d) for listening\n" reset, server->ServerID, server->sServerIP, server->sServerPort_NServer);
     fprintf(logs, "[+]Storage Server Handler Thread: Connected to server %lu (%s:%d) for listening [Time Stamp: %f]\n", server->ServerID, server->sServerIP, server->sServerPort_NServer, GetCurrTime(Clock));
 
+    pthread_mutex_init(&server->sendLock, NULL);
     server->sSocket_Read = iServerSocket;
 
     while (1)
     {
-        // Receive the response from the server
+        // Receive the response from the server (replies to forwarded requests)
         RESPONSE_STRUCT response_struct;
         RESPONSE_STRUCT *response = &response_struct;
-        int iRecvStatus = recv(server->sSocket_Write, response, sizeof(response_struct), 0);
+        int iRecvStatus = RecvResponse(server->sSocket_Read, response);
         if (CheckError(iRecvStatus, "[-]Storage Server Handler Thread: Error in receiving data from server"))
         {
             RemoveServer(GetServerID(server), serverHandleList);
@@ -708,6 +884,8 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
             close(server->sSocket_Write);
             close(server->sSocket_Read);
             int err_code = SetInactive(server->ServerID, serverHandleList);
+            InvalidateServerPaths(server);
+            InvalidatePathFilters(1);
             if (CheckError(err_code, "[-]Storage Server Handler Thread: Error in setting server inactive"))
             {
                 RemoveServer(GetServerID(server), serverHandleList);
@@ -730,18 +908,26 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
 
             unsigned long clientID;
 
+            // The response data is the message followed by the client ID (last token)
             char data[MAX_BUFFER_SIZE];
-            char *token;
             strncpy(data, response->sResponseData, MAX_BUFFER_SIZE);
-            __strtok_r(data, " ", &token);
+            char *token = strrchr(data, ' ');
+            if (token == NULL)
+            {
+                printf(RED "[-]Storage Server Handler Thread: Malformed rename response from server\n" reset);
+                fprintf(logs, "[-]Storage Server Handler Thread: Malformed rename response from server [Time Stamp: %f]\n", GetCurrTime(Clock));
+                break;
+            }
+            *token++ = '\0';
 
             clientID = (unsigned long)(atoll(token));
 
             ack->iAckErrorCode = response->iResponseErrorCode;
             strncpy(ack->sAckData, data, MAX_BUFFER_SIZE);
             ack->iAckFlags = response->iResponseFlags;
+            ack->iAckRequestID = response->iResponseRequestID;
 
-            if (response->iResponseErrorCode)
+            if (response->iResponseFlags == RESPONSE_FLAG_FAILURE)
             {
                 printf(RED "[-]Storage Server Handler Thread: Error in renaming file\n" reset);
                 fprintf(logs, "[-]Storage Server Handler Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -752,22 +938,12 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
                 fprintf(logs, "[+]Storage Server Handler Thread: File renamed successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
             }
 
-            // forward to corresponding client
-            // find the client
-            CLIENT_HANDLE_STRUCT *client = GetClient(clientID, clientHandleList);
-            if (client == NULL)
-            {
-                printf(RED "[-]Storage Server Handler Thread: Error in finding client\n" reset);
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in finding client [Time Stamp: %f]\n", GetCurrTime(Clock));
-                break;
-            }
-
-            int iSendStatus = send(client->iClientSocket, ack, sizeof(ack_struct), 0);
+            // forward to corresponding client, it may have disconnected meanwhile
+            // On failure the connection is shut down, the reactor of the client closes it
+            int iSendStatus = SendClientAckByID(clientID, clientHandleList, CMD_RENAME, ack);
             if (CheckError(iSendStatus, "[-]Storage Server Handler Thread: Error in sending data to client"))
             {
-                fprintf(logs, "[-]Storage Server Handler Thread: Error in sending data to client [Time Stamp: %f]\n", GetCurrTime(Clock));
-                RemoveClient(clientID, clientHandleList);
-                close(client->iClientSocket);
+                fprintf(logs, "[-]Storage Server Handler Thread: Error in sending data to client %lu [Time Stamp: %f]\n", clientID, GetCurrTime(Clock));
                 break;
             }
 
@@ -784,6 +960,8 @@ void *Storage_Server_Handler_Thread(void *storageServerHandle)
     close(server->sSocket_Write);
     close(server->sSocket_Read);
     RemoveServer(GetServerID(server), serverHandleList);
+    InvalidateServerPaths(server);
+    InvalidatePathFilters(1);
     return NULL;
 }
 
@@ -799,7 +977,9 @@ void *Log_Flusher_Thread()
         fprintf(logs, "Current Mount Trie:\n");
         char buffer[MAX_BUFFER_SIZE];
         memset(buffer, 0, MAX_BUFFER_SIZE);
+        pthread_mutex_lock(&MountTrieLock);
         int err = Get_Directory_Tree(MountTrie, "/", buffer);
+        pthread_mutex_unlock(&MountTrieLock);
         if (CheckError(err, "[-]Log_Flusher_Thread: Error in getting directory tree"))
         {
             fprintf(logs, "[-]Log_Flusher_Thread: Error in getting directory tree\n");
@@ -819,9 +999,10 @@ void exit_handler()
 {
     printf(BRED "[-]Server Exiting\n" reset);
     fprintf(logs, "[-]Server Exiting [Time Stamp: %f]\n", GetCurrTime(Clock));
-    for (int i = 0; i < clientHandleList->iClientCount; i++)
+    for (int i = 0; i < MAX_CLIENTS; i++)
     {
-        close(clientHandleList->clientList[i].iClientSocket);
+        if (clientHandleList->InUseList[i])
+            close(clientHandleList->clientList[i].iClientSocket);
     }
     for (int i = 0; i < serverHandleList->iServerCount; i++)
     {
@@ -830,7 +1011,12 @@ void exit_handler()
     }
     Delete_Trie(MountTrie);
     pthread_mutex_destroy(&MountTrieLock);
+    unsigned long hits, misses;
+    cacheStats(MountCache, &hits, &misses);
+    fprintf(logs, "[+]Mount Cache: %zu entries, %lu hits, %lu misses [Time Stamp: %f]\n", cacheSize(MountCache), hits, misses, GetCurrTime(Clock));
     freeCache(MountCache);
+    freeCache(NegativeCache);
+    DestroyBloomFilter(PathFilter);
     fclose(logs);
 }
 
@@ -848,13 +1034,28 @@ int main(int argc, char *argv[])
     sem_init(&serverStartSem, 0, -BACKUP_SERVERS);
 
     // Initialize the Mount Paths Trie
-    MountTrie = Init_Trie();
+    MountTrie = Init_Trie("Mount");
+    if (MountTrie == NULL)
+    {
+        printf(RED "[-]Error in initializing the mount trie\n" reset);
+        exit(1);
+    }
     pthread_mutex_init(&MountTrieLock, NULL);
-    strcpy(MountTrie->path_token, "Mount");
-    MountTrie->Server_Handle = NULL;
 
     // Initialize the LRU Cache
-    MountCache = createCache();
+    MountCache = createCache(MOUNT_CACHE_ENTRIES, MOUNT_CACHE_BYTES, 1);
+    if (MountCache == NULL)
+    {
+        printf(RED "[-]Error in initializing the mount cache\n" reset);
+        exit(1);
+    }
+    NegativeCache = createCache(NEGATIVE_CACHE_ENTRIES, NEGATIVE_CACHE_BYTES, 0); // Every entry has its own timestamp, no value index
+    PathFilter = InitBloomFilter(BLOOM_FILTER_BITS, BLOOM_FILTER_HASHES);
+    if (NegativeCache == NULL || PathFilter == NULL)
+    {
+        printf(RED "[-]Error in initializing the path filters\n" reset);
+        exit(1);
+    }
 
     // Initialize the clock object
     Clock = InitClock();
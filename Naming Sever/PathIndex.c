@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include "PathIndex.h"
+
+/*
+FULL PATH INDEX
+    1. A path is keyed by its tokens below the mount root joined by '/', so "Mount/a//b/" and
+       "x/a/b" are the same key, like they are for the trie
+    2. The key is hashed with FNV-1a, the state at every '/' is the hash of that directory,
+       so a path and all of its directories are hashed in one pass when it is inserted
+    3. Servers export directories, a path below an export point is served by the server
+       exporting its longest prefix (its files are only known to the server)
+    4. Deleted slots are left as tombstones (probes continue past them) and are cleared when
+       the table is rehashed, deletes are rare (whole subtrees) and scan the table
+*/
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static char Tombstone; // Marks a deleted slot
+
+/**
+ * @brief Writes the key of a path (its tokens below the mount root joined by '/')
+ * @param path: The path
+ * @param out: The key, atleast strlen(path) + 1 bytes
+ * @return: The length of the key
+ */
+static size_t CanonicalPath(const char *path, char *out)
+{
+    size_t len = 0;
+    int first = 1;
+    while (*path)
+    {
+        while (*path == '/')
+            path++;
+        if (*path == '\0')
+            break;
+        const char *end = path;
+        while (*end && *end != '/')
+            end++;
+        if (!first)
+        {
+            if (len > 0)
+                out[len++] = '/';
+            memcpy(out + len, path, end - path);
+            len += end - path;
+        }
+        first = 0;
+        path = end;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static uint64_t HashBytes(uint64_t hash, const char *key, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Finds the slot of a key
+ * @return: The slot, NULL if the key is not in the table
+ */
+static PATH_INDEX_SLOT *FindSlot(PATH_INDEX *index, const char *key, size_t len, uint64_t hash)
+{
+    size_t mask = index->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        PATH_INDEX_SLOT *slot = &index->slots[i];
+        if (slot->path == NULL)
+            return NULL;
+        if (slot->path != &Tombstone && slot->hash == hash && strncmp(slot->path, key, len) == 0 && slot->path[len] == '\0')
+            return slot;
+    }
+}
+
+/**
+ * @brief Places an entry in the first free slot of its probe sequence (the key must not be in the table)
+ */
+static void PlaceSlot(PATH_INDEX *index, uint64_t hash, char *path, void *Server_Handle, int bExport)
+{
+    size_t mask = index->capacity - 1;
+    size_t i = hash & mask;
+    while (index->slots[i].path != NULL && index->slots[i].path != &Tombstone)
+        i = (i + 1) & mask;
+    if (index->slots[i].path == &Tombstone)
+        index->tombstones--;
+    index->slots[i].hash = hash;
+    index->slots[i].path = path;
+    index->slots[i].Server_Handle = Server_Handle;
+    index->slots[i].bExport = bExport;
+    index->count++;
+}
+
+/**
+ * @brief Rehashes the table if it is 3/4 full (doubling it if more than half of it is live entries)
+ * @return: 0 on success, -1 on failure
+ */
+static int Reserve(PATH_INDEX *index)
+{
+    if ((index->count + index->tombstones + 1) * 4 <= index->capacity * 3)
+        return 0;
+
+    size_t capacity = (index->count + 1) * 2 > index->capacity ? index->capacity * 2 : index->capacity;
+    PATH_INDEX_SLOT *slots = (PATH_INDEX_SLOT *)calloc(capacity, sizeof(PATH_INDEX_SLOT));
+    if (slots == NULL)
+        return -1;
+
+    PATH_INDEX_SLOT *old = index->slots;
+    size_t old_capacity = index->capacity;
+    index->slots = slots;
+    index->capacity = capacity;
+    index->count = 0;
+    index->tombstones = 0;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i].path != NULL && old[i].path != &Tombstone)
+            PlaceSlot(index, old[i].hash, old[i].path, old[i].Server_Handle, old[i].bExport);
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * @brief Creates an empty index
+ * @param capacity: The initial number of slots (a power of two)
+ * @return: The index on success, NULL on failure
+ */
+PATH_INDEX *InitPathIndex(size_t capacity)
+{
+    PATH_INDEX *index = (PATH_INDEX *)calloc(1, sizeof(PATH_INDEX));
+    if (index == NULL)
+        return NULL;
+    index->capacity = 16;
+    while (index->capacity < capacity)
+        index->capacity <<= 1;
+    index->slots = (PATH_INDEX_SLOT *)calloc(index->capacity, sizeof(PATH_INDEX_SLOT));
+    if (index->slots == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+    pthread_rwlock_init(&index->lock, NULL);
+    return index;
+}
+
+/**
+ * @brief Frees the index and its keys
+ * @param index: The index
+ */
+void DestroyPathIndex(PATH_INDEX *index)
+{
+    if (index == NULL)
+        return;
+    for (size_t i = 0; i < index->capacity; i++)
+    {
+        if (index->slots[i].path != NULL && index->slots[i].path != &Tombstone)
+            free(index->slots[i].path);
+    }
+    pthread_rwlock_destroy(&index->lock);
+    free(index->slots);
+    free(index);
+}
+
+/**
+ * @brief Adds an export point and its directories to the index
+ * @param index: The index
+ * @param path: The path (first token is the mount root and is skipped)
+ * @param Server_Handle: The server handle of the path
+ * @return: 0 on success, -1 on failure
+ * @note: Like the trie, directories already present keep their server handle, the path itself takes the new one
+ */
+int PathIndexInsert(PATH_INDEX *index, const char *path, void *Server_Handle)
+{
+    if (index == NULL || path == NULL || Server_Handle == NULL)
+        return -1;
+
+    char *key = (char *)malloc(strlen(path) + 1);
+    if (key == NULL)
+        return -1;
+    size_t len = CanonicalPath(path, key);
+
+    int err = 0;
+    uint64_t hash = FNV_OFFSET;
+    size_t start = 0;
+    pthread_rwlock_wrlock(&index->lock);
+    while (start < len)
+    {
+        size_t end = start;
+        while (end < len && key[end] != '/')
+            end++;
+        hash = HashBytes(hash, key + start, end - start);
+
+        PATH_INDEX_SLOT *slot = FindSlot(index, key, end, hash);
+        if (slot != NULL)
+        {
+            if (end == len)
+            {
+                slot->Server_Handle = Server_Handle;
+                slot->bExport = 1;
+            }
+        }
+        else
+        {
+            char *prefix = (char *)malloc(end + 1);
+            if (prefix == NULL || Reserve(index) < 0)
+            {
+                free(prefix);
+                err = -1;
+                break;
+            }
+            memcpy(prefix, key, end);
+            prefix[end] = '\0';
+            PlaceSlot(index, hash, prefix, Server_Handle, end == len);
+        }
+
+        // The separator is part of the hash of the paths below
+        hash = HashBytes(hash, "/", 1);
+        start = end + 1;
+    }
+    pthread_rwlock_unlock(&index->lock);
+
+    free(key);
+    return err;
+}
+
+/**
+ * @brief Returns the server handle of a path
+ * @param index: The index
+ * @param path: The path (first token is the mount root and is skipped)
+ * @param exported: If not NULL, set to 1 if the path is an export point or below one, 0 otherwise
+ * @return: The server handle of the path if it is in the index, else of its longest exported prefix,
+ *          NULL if there is neither
+ * @note: The mount root itself has no server and is reported as absent
+ */
+void *PathIndexLookup(PATH_INDEX *index, const char *path, int *exported)
+{
+    if (exported != NULL)
+        *exported = 0;
+    if (index == NULL || path == NULL)
+        return NULL;
+
+    char stack_key[256];
+    size_t path_len = strlen(path);
+    char *key = path_len < sizeof(stack_key) ? stack_key : (char *)malloc(path_len + 1);
+    if (key == NULL)
+        return NULL;
+    size_t len = CanonicalPath(path, key);
+
+    void *Server_Handle = NULL;
+    pthread_rwlock_rdlock(&index->lock);
+    // Try the path, then its directories from the deepest up, the first export found owns the path
+    for (size_t end = len; end > 0;)
+    {
+        PATH_INDEX_SLOT *slot = FindSlot(index, key, end, HashBytes(FNV_OFFSET, key, end));
+        if (slot != NULL && (end == len || slot->bExport))
+        {
+            Server_Handle = slot->Server_Handle;
+            if (exported != NULL)
+                *exported = slot->bExport || end < len;
+            break;
+        }
+        while (end > 0 && key[end - 1] != '/')
+            end--;
+        if (end > 0)
+            end--;
+    }
+    pthread_rwlock_unlock(&index->lock);
+
+    if (key != stack_key)
+        free(key);
+    return Server_Handle;
+}
+
+/**
+ * @brief Removes a path and every path below it
+ * @param index: The index
+ * @param path: The path (first token is the mount root and is skipped, the mount root removes everything)
+ * @return: The number of paths removed
+ */
+size_t PathIndexRemove(PATH_INDEX *index, const char *path)
+{
+    if (index == NULL || path == NULL)
+        return 0;
+
+    char *key = (char *)malloc(strlen(path) + 1);
+    if (key == NULL)
+        return 0;
+    size_t len = CanonicalPath(path, key);
+
+    size_t removed = 0;
+    pthread_rwlock_wrlock(&index->lock);
+    for (size_t i = 0; i < index->capacity; i++)
+    {
+        PATH_INDEX_SLOT *slot = &index->slots[i];
+        if (slot->path == NULL || slot->path == &Tombstone)
+            continue;
+        if (len > 0 && (strncmp(slot->path, key, len) != 0 || (slot->path[len] != '\0' && slot->path[len] != '/')))
+            continue;
+        free(slot->path);
+        slot->path = &Tombstone;
+        slot->Server_Handle = NULL;
+        index->count--;
+        index->tombstones++;
+        removed++;
+    }
+    pthread_rwlock_unlock(&index->lock);
+
+    free(key);
+    return removed;
+}
@@ -0,0 +1,38 @@
+#ifndef __PATH_INDEX_H__
+#define __PATH_INDEX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define PATH_INDEX_INITIAL_SLOTS 1024 // A power of two, doubled when 3/4 full
+
+typedef struct PATH_INDEX_SLOT
+{
+    uint64_t hash;       // Hash of the path, compared before the path itself
+    char *path;          // Tokens below the mount root joined by '/', NULL if free
+    void *Server_Handle;
+    int bExport;         // 1 if a server exports the path, 0 for a directory above the exports
+} PATH_INDEX_SLOT;
+
+// Open addressing (linear probing) table of every path in the mount trie, keyed by its full path
+// The paths are the export points of the servers and the directories above them
+typedef struct PATH_INDEX
+{
+    PATH_INDEX_SLOT *slots;
+    size_t capacity;
+    size_t count;
+    size_t tombstones;
+    pthread_rwlock_t lock; // Shared by lookups, exclusive while inserting or deleting
+} PATH_INDEX;
+
+PATH_INDEX *InitPathIndex(size_t capacity);
+void DestroyPathIndex(PATH_INDEX *index);
+// Adds an export point and its directories (the first token, the mount root, is skipped like in the trie)
+int PathIndexInsert(PATH_INDEX *index, const char *path, void *Server_Handle);
+// Returns the server handle of a path or of its longest exported prefix, NULL if there is none
+void *PathIndexLookup(PATH_INDEX *index, const char *path, int *exported);
+// Removes a path and every path below it, returns the number removed
+size_t PathIndexRemove(PATH_INDEX *index, const char *path);
+
+#endif
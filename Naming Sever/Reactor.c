@@ -0,0 +1,250 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "Headers.h"
+#include "Reactor.h"
+#include "../Protocol.h"
+#include "../colour.h"
+
+/*
+CLIENT REACTORS
+    1. Every client socket is non-blocking and attached to one of NS_REACTOR_COUNT reactors
+    2. A reactor waits on its epoll instance and advances the state of the ready connections:
+       the packet being received is assembled across reads (header, then payload), complete
+       packets are served by HandleClientPacket
+    3. Replies are queued on the connection and sent as the socket takes them, EPOLLOUT is
+       only asked for while output is left (see QueueClientPacket)
+    4. Idle connections cost a slot in the client list and no thread
+*/
+
+typedef struct REACTOR
+{
+    int iEpollFd;
+    pthread_t tReactorThread;
+} REACTOR;
+
+static REACTOR *Reactors;
+static int iReactorCount;
+static unsigned int iNextReactor;
+
+/**
+ * @brief Closes the connection of a client and removes it from the client list.
+ * @param client The client handle of the client.
+ */
+static void CloseClientConnection(CLIENT_HANDLE_STRUCT *client)
+{
+    epoll_ctl(client->iEpollFd, EPOLL_CTL_DEL, client->iClientSocket, NULL);
+
+    // Senders on other threads see the socket gone once the lock is released
+    pthread_mutex_lock(&client->sendLock);
+    close(client->iClientSocket);
+    client->iClientSocket = -1;
+    free(client->outBuf);
+    client->outBuf = NULL;
+    client->outLen = client->outSent = client->outCap = 0;
+    pthread_mutex_unlock(&client->sendLock);
+
+    free(client->inPayload);
+    client->inPayload = NULL;
+    client->inCap = 0;
+    RemoveClient(client->ClientID, clientHandleList);
+}
+
+/**
+ * @brief Receives what the socket holds of the client's packets and serves the complete ones.
+ * @param client The client handle of the client.
+ * @param CloseRequest Set to 1 if the client asked to close the connection.
+ * @return 0 if the socket has no more data for now, 1 if the packet budget ran out,
+ *         2 if the connection is to be closed, -1 on failure.
+ */
+static int ReadClientPackets(CLIENT_HANDLE_STRUCT *client, int *CloseRequest)
+{
+    int served = 0;
+    while(served < REACTOR_PACKET_BUDGET)
+    {
+        unsigned char *dest;
+        size_t want;
+        if(client->inHave < PACKET_HEADER_SIZE)
+        {
+            dest = client->inHeader + client->inHave;
+            want = PACKET_HEADER_SIZE - client->inHave;
+        }
+        else
+        {
+            uint32_t got = client->inHave - PACKET_HEADER_SIZE;
+            dest = client->inPayload + got;
+            want = client->inPacket.iLength - got;
+        }
+
+        if(want > 0)
+        {
+            ssize_t n = recv(client->iClientSocket, dest, want, MSG_DONTWAIT);
+            if(n < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 0;
+                return -1;
+            }
+            if(n == 0)
+            {
+                if(client->inHave == 0)
+                    return 2;
+                errno = ECONNRESET;
+                return -1;
+            }
+
+            int header_done = client->inHave < PACKET_HEADER_SIZE && client->inHave + n == PACKET_HEADER_SIZE;
+            client->inHave += n;
+            if(header_done)
+            {
+                if(DecodeHeader(client->inHeader, &client->inPacket) < 0)
+                    return -1;
+                if(client->inPacket.iLength > RESOLVE_BATCH_MAX_PAYLOAD)
+                {
+                    errno = EMSGSIZE;
+                    return -1;
+                }
+
+                uint32_t cap = client->inPacket.iLength > MAX_PACKET_PAYLOAD ? client->inPacket.iLength : MAX_PACKET_PAYLOAD;
+                if(client->inCap < cap)
+                {
+                    free(client->inPayload);
+                    client->inPayload = (unsigned char *)malloc(cap);
+                    client->inCap = client->inPayload ? cap : 0;
+                    if(client->inPayload == NULL)
+                        return -1;
+                }
+            }
+            continue;
+        }
+
+        // The packet is complete
+        client->inHave = 0;
+        served++;
+        int status = HandleClientPacket(client, &client->inPacket, client->inPayload);
+
+        // Only small buffers are kept around for idle connections
+        if(client->inCap > MAX_PACKET_PAYLOAD)
+        {
+            free(client->inPayload);
+            client->inPayload = NULL;
+            client->inCap = 0;
+        }
+
+        if(status < 0)
+            return -1;
+        if(status == 1)
+        {
+            *CloseRequest = 1;
+            return 2;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Thread of a reactor, serves the connections attached to it.
+ * @param arg The reactor.
+ * @return NULL
+ */
+static void *ClientReactorThread(void *arg)
+{
+    REACTOR *reactor = (REACTOR *)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    while(1)
+    {
+        int n = epoll_wait(reactor->iEpollFd, events, REACTOR_MAX_EVENTS, -1);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            perror("[-]Client Reactor Thread: Error in waiting for events");
+            fprintf(logs, "[-]Client Reactor Thread: Error in waiting for events [Time Stamp: %f]\n", GetCurrTime(Clock));
+            return NULL;
+        }
+
+        for(int i = 0; i < n; i++)
+        {
+            CLIENT_HANDLE_STRUCT *client = (CLIENT_HANDLE_STRUCT *)events[i].data.ptr;
+            uint32_t ready = events[i].events;
+            int status = 0, CloseRequest = 0;
+
+            if(ready & EPOLLERR)
+                status = -1;
+            if(status == 0 && (ready & EPOLLOUT) && FlushClient(client) < 0)
+                status = -1;
+            if(status == 0 && (ready & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)))
+                status = ReadClientPackets(client, &CloseRequest);
+            if(status != -1 && status != 2)
+                continue;
+
+            if(CloseRequest)
+            {
+                printf(BHGRN "[+]Client Reactor Thread: Client %lu (%s:%d) disconnected(GRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
+                fprintf(logs, "[+]Client Reactor Thread: Client %lu (%s:%d) disconnected(GRACEFULLY) [Time Stamp: %f]\n", client->ClientID, client->sClientIP, client->sClientPort, GetCurrTime(Clock));
+            }
+            else
+            {
+                if(status == -1)
+                    fprintf(logs, "[-]Client Reactor Thread: Error on the connection of client %lu: %s [Time Stamp: %f]\n", client->ClientID, strerror(errno), GetCurrTime(Clock));
+                printf(BHRED "[-]Client Reactor Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY)\n" reset, client->ClientID, client->sClientIP, client->sClientPort);
+                fprintf(logs, "[-]Client Reactor Thread: Client %lu (%s:%d) disconnected(UNGRACEFULLY) [Time Stamp: %f]\n", client->ClientID, client->sClientIP, client->sClientPort, GetCurrTime(Clock));
+            }
+            CloseClientConnection(client);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Starts the reactor threads.
+ * @param count The number of reactors.
+ * @return 0 on success, -1 on failure.
+ */
+int InitClientReactors(int count)
+{
+    Reactors = (REACTOR *)calloc(count, sizeof(REACTOR));
+    if(CheckNull(Reactors, "[-]InitClientReactors: Error in allocating memory"))
+        return -1;
+
+    for(int i = 0; i < count; i++)
+    {
+        Reactors[i].iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if(CheckError(Reactors[i].iEpollFd, "[-]InitClientReactors: Error in creating epoll instance"))
+            return -1;
+        int iThreadStatus = pthread_create(&Reactors[i].tReactorThread, NULL, ClientReactorThread, (void *)&Reactors[i]);
+        if(CheckError(iThreadStatus, "[-]InitClientReactors: Error in creating thread"))
+            return -1;
+        pthread_detach(Reactors[i].tReactorThread);
+        iReactorCount++;
+    }
+
+    printf(UGRN "[+]%d Client Reactor Threads Initialized\n" reset, count);
+    fprintf(logs, "[+]%d Client Reactor Threads Initialized [Time Stamp: %f]\n", count, GetCurrTime(Clock));
+    return 0;
+}
+
+/**
+ * @brief Hands an accepted client to a reactor (round robin).
+ * @param client The client handle of the client (in the client list, socket non-blocking).
+ * @return 0 on success, -1 on failure.
+ */
+int AttachClient(CLIENT_HANDLE_STRUCT *client)
+{
+    REACTOR *reactor = &Reactors[iNextReactor++ % iReactorCount];
+    client->iEpollFd = reactor->iEpollFd;
+    client->outArmed = 0;
+    client->inHave = 0;
+    client->bHoldsLeases = 0;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = client;
+    return epoll_ctl(reactor->iEpollFd, EPOLL_CTL_ADD, client->iClientSocket, &event);
+}
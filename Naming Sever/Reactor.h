@@ -0,0 +1,17 @@
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#include "./Client_Handle.h"
+
+#ifndef NS_REACTOR_COUNT
+#define NS_REACTOR_COUNT 2 // Threads multiplexing the client connections (build with -DNS_REACTOR_COUNT=N to change)
+#endif
+#define REACTOR_MAX_EVENTS 64     // Events taken from epoll per wake up
+#define REACTOR_PACKET_BUDGET 16  // Packets served per connection per wake up, so a busy client can not starve the rest
+
+// Starts the reactor threads
+int InitClientReactors(int count);
+// Hands an accepted client (already in the client list) to a reactor
+int AttachClient(CLIENT_HANDLE_STRUCT *client);
+
+#endif
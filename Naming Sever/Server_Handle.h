@@ -17,6 +17,7 @@ typedef struct SERVER_HANDLE_STRUCT
     int sServerPort_Client;                               // Port on which the storage server will listen for client
     int sSocket_Write;                                    // Socket to write to the server
     int sSocket_Read;                                     // Socket to read from the server
+    pthread_mutex_t sendLock;                             // Serialises requests forwarded on sSocket_Read
     struct SERVER_HANDLE_STRUCT* backupServers[BACKUP_SERVERS];  // Array of backup servers
     // char MountPaths[MAX_BUFFER_SIZE];                  // \n separated list of mount paths
 
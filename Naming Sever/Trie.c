@@ -3,148 +3,640 @@
 #include <stdlib.h>
 #include <string.h>
 
+/*
+TRIE LAYOUT
+    1. The trie is path compressed, a node is an edge labelled with one or more tokens, a run of
+       single child directories served by the same server is one node ("2024/10/17")
+       Inserts split a label where the new path leaves it (or where the server changes), deletes
+       merge a node with its only remaining child when they are served by the same server
+    2. Labels are interned, a node keeps a pointer to the shared copy and the hash of its first
+       token, so a name costs its bytes once however many directories hold it
+    3. Children live in a table sized to the directory (linear probing on the hash of the first
+       token of their label, grown when 3/4 full), a leaf has none
+    4. Nodes, child tables and labels come from the trie's arena, deleted nodes and tables are
+       reused and Delete_Trie releases everything at once (labels are kept until then)
+*/
+
 // local helper functions
-TrieNode *getNode() // returns a new node
+uint32_t Hash(const char *path_token, size_t len) // returns the hash of the first len bytes of the token
 {
-    TrieNode *node = (TrieNode *)calloc(1, sizeof(TrieNode));
+    // djb2 algorithm
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < len; i++)
+        hash = ((hash << 5) + hash) + (unsigned char)path_token[i]; /* hash * 33 + c */
+    return hash;
+}
+
+TrieNode *getNode(TRIE_CONTEXT *trie) // returns a new node
+{
+    TrieNode *node = (TrieNode *)ArenaCalloc(trie->Arena, sizeof(TrieNode));
+    if (node != NULL)
+        node->Trie = trie;
     return node;
 }
 
-int Hash(char *path_token) // returns the index of the child in the children array with given token
+/**
+ * @brief Returns the length of the first token of a label
+ */
+static size_t First_Token_Len(const char *label)
 {
-    if (path_token == NULL)
-        return -1;
+    const char *slash = strchr(label, '/');
+    return slash == NULL ? strlen(label) : (size_t)(slash - label);
+}
 
-    // djb2 algorithm
-    unsigned long hash = 5381;
-    int c;
-    while (c = *path_token++)
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-    return hash % MAX_CHILDREN;
+/**
+ * @brief Splits a path into its tokens below the mount root
+ * @param path: The path (split in place)
+ * @param tokens: Filled with the tokens, MAX_PATH_TOKENS entries
+ * @return: The number of tokens
+ */
+static int Tokenize(char *path, char **tokens)
+{
+    char *saveptr;
+    int count = 0;
+    char *path_token = strtok_r(path, "/", &saveptr);
+    // Ignore the first token as it is CWD for Storage Server (the mount root)
+    path_token = strtok_r(NULL, "/", &saveptr);
+    while (path_token != NULL && count < MAX_PATH_TOKENS)
+    {
+        tokens[count++] = path_token;
+        path_token = strtok_r(NULL, "/", &saveptr);
+    }
+    return count;
 }
-int Recursive_Delete(TrieNode *root) // deletes the subtree for the given node
+
+/**
+ * @brief Returns the interned copy of a label
+ * @param trie: The trie
+ * @param label: The label
+ * @return: The interned label, NULL on failure
+ */
+static const char *Intern(TRIE_CONTEXT *trie, const char *label)
 {
-    if (root == NULL)
-        return -1;
-    for (int i = 0; i < MAX_CHILDREN; i++)
+    size_t len = strlen(label);
+    uint32_t hash = Hash(label, len);
+    size_t mask = trie->token_capacity - 1;
+    size_t i = hash & mask;
+    for (; trie->tokens[i] != NULL; i = (i + 1) & mask)
     {
-        if (root->children[i] != NULL)
+        if (trie->token_hashes[i] == hash && strcmp(trie->tokens[i], label) == 0)
+            return trie->tokens[i];
+    }
+
+    if ((trie->token_count + 1) * 4 > trie->token_capacity * 3)
+    {
+        // Grow the table, labels are never removed so there is nothing else to clean up
+        size_t capacity = trie->token_capacity * 2;
+        const char **tokens = (const char **)calloc(capacity, sizeof(char *));
+        uint32_t *hashes = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+        if (tokens == NULL || hashes == NULL)
         {
-            Recursive_Delete(root->children[i]);
-            root->children[i] = NULL;
+            free(tokens);
+            free(hashes);
+            return NULL;
+        }
+        for (size_t j = 0; j < trie->token_capacity; j++)
+        {
+            if (trie->tokens[j] == NULL)
+                continue;
+            size_t k = trie->token_hashes[j] & (capacity - 1);
+            while (tokens[k] != NULL)
+                k = (k + 1) & (capacity - 1);
+            tokens[k] = trie->tokens[j];
+            hashes[k] = trie->token_hashes[j];
         }
+        free(trie->tokens);
+        free(trie->token_hashes);
+        trie->tokens = tokens;
+        trie->token_hashes = hashes;
+        trie->token_capacity = capacity;
+
+        mask = capacity - 1;
+        i = hash & mask;
+        while (trie->tokens[i] != NULL)
+            i = (i + 1) & mask;
+    }
+
+    char *copy = (char *)ArenaAlloc(trie->Arena, len + 1);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, label, len + 1);
+    trie->tokens[i] = copy;
+    trie->token_hashes[i] = hash;
+    trie->token_count++;
+    return copy;
+}
+
+/**
+ * @brief Interns the tokens of a path joined by '/'
+ * @param trie: The trie
+ * @param tokens: The tokens
+ * @param count: The number of tokens
+ * @return: The interned label, NULL on failure
+ */
+static const char *Intern_Tokens(TRIE_CONTEXT *trie, char **tokens, int count)
+{
+    char label[MAX_PATH_LEN];
+    size_t len = 0;
+    for (int i = 0; i < count; i++)
+    {
+        size_t token_len = strlen(tokens[i]);
+        if (len + token_len + 2 > sizeof(label))
+            return NULL;
+        if (i > 0)
+            label[len++] = '/';
+        memcpy(label + len, tokens[i], token_len);
+        len += token_len;
+    }
+    label[len] = '\0';
+    return Intern(trie, label);
+}
+
+/**
+ * @brief Counts how many tokens of a path match the label of a node
+ * @param node: The node
+ * @param tokens: The tokens of the path left to match
+ * @param count: The number of tokens
+ * @return: The number of leading tokens of the label matched
+ */
+static uint32_t Match_Label(TrieNode *node, char **tokens, int count)
+{
+    const char *label = node->path_token;
+    uint32_t matched = 0;
+    while (matched < node->label_tokens && (int)matched < count)
+    {
+        size_t len = strlen(tokens[matched]);
+        if (strncmp(label, tokens[matched], len) != 0 || (label[len] != '\0' && label[len] != '/'))
+            break;
+        matched++;
+        label += len + (label[len] == '/');
+    }
+    return matched;
+}
+
+/**
+ * @brief Finds the child of a node whose label starts with a token
+ * @param node: The node
+ * @param path_token: The token
+ * @return: The child, NULL if there is none
+ */
+static TrieNode *Find_Child(TrieNode *node, const char *path_token)
+{
+    if (node->child_capacity == 0)
+        return NULL;
+    size_t len = strlen(path_token);
+    uint32_t hash = Hash(path_token, len);
+    size_t mask = node->child_capacity - 1;
+    for (size_t i = hash & mask; node->children[i] != NULL; i = (i + 1) & mask)
+    {
+        TrieNode *child = node->children[i];
+        if (child->token_hash == hash && strncmp(child->path_token, path_token, len) == 0 &&
+            (child->path_token[len] == '\0' || child->path_token[len] == '/'))
+            return child;
     }
-    free(root);
+    return NULL;
+}
+
+/**
+ * @brief Returns the slot of a child in the table of its parent
+ */
+static TrieNode **Child_Slot(TrieNode *node, TrieNode *child)
+{
+    if (node->child_capacity == 0)
+        return NULL;
+    size_t mask = node->child_capacity - 1;
+    for (size_t i = child->token_hash & mask; node->children[i] != NULL; i = (i + 1) & mask)
+    {
+        if (node->children[i] == child)
+            return &node->children[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds a child to a node, growing its table if it is 3/4 full
+ * @param node: The node
+ * @param child: The child (the first token of its label must not start another child's label)
+ * @return: 0 on success, -1 on failure
+ */
+static int Add_Child(TrieNode *node, TrieNode *child)
+{
+    if ((node->child_count + 1) * 4 > node->child_capacity * 3)
+    {
+        uint32_t capacity = node->child_capacity == 0 ? 2 : node->child_capacity * 2;
+        TrieNode **children = (TrieNode **)ArenaCalloc(node->Trie->Arena, capacity * sizeof(TrieNode *));
+        if (children == NULL)
+            return -1;
+        for (uint32_t i = 0; i < node->child_capacity; i++)
+        {
+            TrieNode *moved = node->children[i];
+            if (moved == NULL)
+                continue;
+            size_t k = moved->token_hash & (capacity - 1);
+            while (children[k] != NULL)
+                k = (k + 1) & (capacity - 1);
+            children[k] = moved;
+        }
+        ArenaFree(node->Trie->Arena, node->children, node->child_capacity * sizeof(TrieNode *));
+        node->children = children;
+        node->child_capacity = capacity;
+    }
+
+    size_t mask = node->child_capacity - 1;
+    size_t i = child->token_hash & mask;
+    while (node->children[i] != NULL)
+        i = (i + 1) & mask;
+    node->children[i] = child;
+    node->child_count++;
     return 0;
 }
-int Get_Directory_Tree_Full(TrieNode *root, char *buffer, int lvl) // returns a string with the full tree path
+
+/**
+ * @brief Removes a child from a node (backward shift deletion, so probes stay unbroken)
+ * @param node: The node
+ * @param child: The child
+ */
+static void Remove_Child(TrieNode *node, TrieNode *child)
+{
+    TrieNode **slot = Child_Slot(node, child);
+    if (slot == NULL)
+        return;
+    size_t mask = node->child_capacity - 1;
+    size_t i = slot - node->children;
+
+    size_t j = i;
+    while (1)
+    {
+        j = (j + 1) & mask;
+        if (node->children[j] == NULL)
+            break;
+        // Move the entry back if its home slot is not between the hole and it
+        size_t home = node->children[j]->token_hash & mask;
+        if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j))
+        {
+            node->children[i] = node->children[j];
+            i = j;
+        }
+    }
+    node->children[i] = NULL;
+    node->child_count--;
+
+    if (node->child_count == 0)
+    {
+        ArenaFree(node->Trie->Arena, node->children, node->child_capacity * sizeof(TrieNode *));
+        node->children = NULL;
+        node->child_capacity = 0;
+    }
+}
+
+/**
+ * @brief Splits the label of a node, the leading tokens move to a new node that takes its place
+ * @param parent: The parent of the node
+ * @param node: The node (keeps the trailing tokens, its children and its server)
+ * @param keep: The number of leading tokens to move (0 < keep < label_tokens)
+ * @return: The new node holding the leading tokens, NULL on failure (the trie is left unchanged)
+ */
+static TrieNode *Split_Node(TrieNode *parent, TrieNode *node, uint32_t keep)
+{
+    char label[MAX_PATH_LEN];
+    strncpy(label, node->path_token, sizeof(label) - 1);
+    label[sizeof(label) - 1] = '\0';
+    char *tokens[MAX_PATH_TOKENS];
+    int count = 0;
+    char *saveptr;
+    for (char *tok = strtok_r(label, "/", &saveptr); tok != NULL && count < MAX_PATH_TOKENS; tok = strtok_r(NULL, "/", &saveptr))
+        tokens[count++] = tok;
+
+    const char *upper_label = Intern_Tokens(node->Trie, tokens, keep);
+    const char *lower_label = Intern_Tokens(node->Trie, tokens + keep, count - keep);
+    TrieNode **slot = Child_Slot(parent, node);
+    TrieNode *upper = upper_label == NULL || lower_label == NULL || slot == NULL ? NULL : getNode(node->Trie);
+    if (upper == NULL)
+        return NULL;
+    upper->path_token = upper_label;
+    upper->token_hash = node->token_hash;
+    upper->label_tokens = keep;
+    upper->Server_Handle = node->Server_Handle;
+
+    const char *old_label = node->path_token;
+    uint32_t old_hash = node->token_hash;
+    node->path_token = lower_label;
+    node->token_hash = Hash(lower_label, First_Token_Len(lower_label));
+    node->label_tokens -= keep;
+    if (Add_Child(upper, node) < 0)
+    {
+        node->path_token = old_label;
+        node->token_hash = old_hash;
+        node->label_tokens += keep;
+        ArenaFree(node->Trie->Arena, upper, sizeof(TrieNode));
+        return NULL;
+    }
+
+    // The first token is unchanged, so the new node takes the same slot
+    *slot = upper;
+    return upper;
+}
+
+/**
+ * @brief Merges a node with its only child if both are served by the same server
+ * @param node: The node (never the root)
+ * @note: Merging is an optimisation, the trie stays valid if it fails
+ */
+static void Try_Merge(TrieNode *node)
+{
+    if (node == NULL || node == node->Trie->Root || node->child_count != 1)
+        return;
+    TrieNode *child = NULL;
+    for (uint32_t i = 0; child == NULL; i++)
+        child = node->children[i];
+    if (child->Server_Handle != node->Server_Handle)
+        return;
+
+    char label[MAX_PATH_LEN];
+    if (snprintf(label, sizeof(label), "%s/%s", node->path_token, child->path_token) >= (int)sizeof(label))
+        return;
+    const char *merged = Intern(node->Trie, label);
+    if (merged == NULL)
+        return;
+
+    ArenaFree(node->Trie->Arena, node->children, node->child_capacity * sizeof(TrieNode *));
+    node->path_token = merged;
+    node->label_tokens += child->label_tokens;
+    node->children = child->children;
+    node->child_count = child->child_count;
+    node->child_capacity = child->child_capacity;
+    ArenaFree(node->Trie->Arena, child, sizeof(TrieNode));
+}
+
+/**
+ * @brief Walks the trie along the tokens of a path
+ * @param root: The node to start from
+ * @param tokens: The tokens of the path below the node
+ * @param count: The number of tokens
+ * @param parent: Set to the parent of the node found (NULL if it is the root)
+ * @param matched: Set to the number of tokens of the found node's label the path ends on
+ * @return: The node the path ends in, NULL if the path is not in the trie
+ */
+static TrieNode *Walk(TrieNode *root, char **tokens, int count, TrieNode **parent, uint32_t *matched)
+{
+    TrieNode *curr = root;
+    *parent = NULL;
+    *matched = curr->label_tokens;
+    int i = 0;
+    while (i < count)
+    {
+        TrieNode *child = Find_Child(curr, tokens[i]);
+        if (child == NULL)
+            return NULL;
+        uint32_t m = Match_Label(child, tokens + i, count - i);
+        // The path leaves the label before it ends
+        if (m < child->label_tokens && i + (int)m < count)
+            return NULL;
+        *parent = curr;
+        *matched = m;
+        curr = child;
+        i += m;
+    }
+    return curr;
+}
+
+/**
+ * @brief Appends the lines of a subtree to the buffer
+ * @param root: The node
+ * @param skip: The number of leading tokens of its label not to list
+ * @param buffer: The buffer
+ * @param lvl: The level of the first listed token
+ */
+int Get_Directory_Tree_Full(TrieNode *root, uint32_t skip, char *buffer, int lvl) // returns a string with the full tree path
 {
     if (root == NULL)
         return -1;
-    for (int i = 0; i < lvl; i++)
+
+    // Every token of the label is a level of its own
+    const char *label = root->path_token;
+    for (uint32_t t = 0; t < root->label_tokens; t++)
     {
-        if (i%2 == 0 || i == 0)
-            strncat(buffer,"|",MAX_BUFFER_SIZE - strlen(buffer) - 1);
-        else
-            strncat(buffer," ",MAX_BUFFER_SIZE - strlen(buffer) - 1);    }
+        size_t len = First_Token_Len(label);
+        if (t >= skip)
+        {
+            for (int i = 0; i < lvl; i++)
+            {
+                if (i%2 == 0 || i == 0)
+                    strncat(buffer,"|",MAX_BUFFER_SIZE - strlen(buffer) - 1);
+                else
+                    strncat(buffer," ",MAX_BUFFER_SIZE - strlen(buffer) - 1);    }
 
-    strncat(buffer, "|-", MAX_BUFFER_SIZE - strlen(buffer) - 1);
-    strncat(buffer, root->path_token, MAX_BUFFER_SIZE - strlen(buffer) - 1);
-    strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+            strncat(buffer, "|-", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+            size_t room = MAX_BUFFER_SIZE - strlen(buffer) - 1;
+            strncat(buffer, label, len < room ? len : room);
+            strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+            lvl++;
+        }
+        label += len + (label[len] == '/');
+    }
 
-    for (int i = 0; i < MAX_CHILDREN; i++)
+    for (uint32_t i = 0; i < root->child_capacity; i++)
     {
         if (root->children[i] != NULL)
         {
-            int err = Get_Directory_Tree_Full(root->children[i], buffer, lvl + 1);
+            int err = Get_Directory_Tree_Full(root->children[i], 0, buffer, lvl);
             if (err < 0)
                 return -1;
         }
     }
     return 0;
 }
+int Recursive_Delete(TrieNode *root) // deletes the subtree for the given node
+{
+    if (root == NULL)
+        return -1;
+    for (uint32_t i = 0; i < root->child_capacity; i++)
+    {
+        if (root->children[i] != NULL)
+            Recursive_Delete(root->children[i]);
+    }
+    ArenaFree(root->Trie->Arena, root->children, root->child_capacity * sizeof(TrieNode *));
+    ArenaFree(root->Trie->Arena, root, sizeof(TrieNode));
+    return 0;
+}
 
 // global functions
 /**
  * @brief Initializes the trie
- * @return: The root node of the empty trie
+ * @param root_token: The token of the root node
+ * @return: The root node of the empty trie, NULL on failure
  */
-TrieNode *Init_Trie() // returns the root node of the empty trie
+TrieNode *Init_Trie(const char *root_token) // returns the root node of the empty trie
 {
-    TrieNode *root = getNode();
-    return root;
+    TRIE_CONTEXT *trie = (TRIE_CONTEXT *)calloc(1, sizeof(TRIE_CONTEXT));
+    if (trie == NULL)
+        return NULL;
+    trie->Arena = InitArena();
+    trie->token_capacity = TRIE_INTERN_INITIAL_SLOTS;
+    trie->tokens = (const char **)calloc(trie->token_capacity, sizeof(char *));
+    trie->token_hashes = (uint32_t *)calloc(trie->token_capacity, sizeof(uint32_t));
+    trie->Path_Index = InitPathIndex(PATH_INDEX_INITIAL_SLOTS);
+    if (trie->Arena != NULL && trie->tokens != NULL && trie->token_hashes != NULL && trie->Path_Index != NULL)
+    {
+        trie->Root = getNode(trie);
+        if (trie->Root != NULL)
+        {
+            trie->Root->path_token = Intern(trie, root_token);
+            trie->Root->token_hash = Hash(root_token, strlen(root_token));
+            trie->Root->label_tokens = 1;
+        }
+    }
+    if (trie->Root == NULL || trie->Root->path_token == NULL)
+    {
+        DestroyPathIndex(trie->Path_Index);
+        free(trie->tokens);
+        free(trie->token_hashes);
+        DestroyArena(trie->Arena);
+        free(trie);
+        return NULL;
+    }
+    return trie->Root;
 }
 /**
- * @brief Inserts the path in the trie
+ * @brief Inserts the path in the trie nodes (Insert_Path indexes it)
  * @param root: The root node of the trie
- * @param path: The path to be inserted
+ * @param path: The path to be inserted (tokenized)
  * @param Server_Handle: The server handle of the path
  * @return: 0 on success, -1 on failure
  */
-int Insert_Path(TrieNode *root, char *path, void *Server_Handle)
+static int Insert_Nodes(TrieNode *root, char *path, void *Server_Handle)
 {
-    if (root == NULL || path == NULL || Server_Handle == NULL)
-        return -1;
+    char *tokens[MAX_PATH_TOKENS];
+    int count = Tokenize(path, tokens);
 
     TrieNode *curr = root;
-    char *path_token = strtok(path, "/");
-    // Ignore the first token as it is CWD for Storage Server
-    path_token = strtok(NULL, "/");
-
-    while (path_token != NULL)
+    TrieNode *parent = NULL;
+    int i = 0;
+    while (i < count)
     {
-        int index = Hash(path_token);
-
-        // Check if the current node has a valid path_token
-        // if (curr->Server_Handle == NULL) {
-        //     strcpy(curr->path_token, path_token);
-        //     curr->Server_Handle = Server_Handle;
-        // }
+        TrieNode *child = Find_Child(curr, tokens[i]);
+        if (child == NULL)
+        {
+            // The rest of the path is new, it becomes a single node
+            child = getNode(root->Trie);
+            if (child == NULL)
+                return -1;
+            child->path_token = Intern_Tokens(root->Trie, tokens + i, count - i);
+            child->token_hash = Hash(tokens[i], strlen(tokens[i]));
+            child->label_tokens = count - i;
+            child->Server_Handle = Server_Handle;
+            if (child->path_token == NULL || Add_Child(curr, child) < 0)
+            {
+                ArenaFree(root->Trie->Arena, child, sizeof(TrieNode));
+                return -1;
+            }
+            // A leaf that gains its only child from the same server absorbs it
+            Try_Merge(curr);
+            return 0;
+        }
 
-        if (curr->children[index] == NULL)
+        // The path leaves (or ends inside) the label, the shared tokens become a node of their own
+        uint32_t m = Match_Label(child, tokens + i, count - i);
+        if (m < child->label_tokens && i + (int)m == count && child->Server_Handle == Server_Handle)
+            return 0;
+        if (m < child->label_tokens)
         {
-            curr->children[index] = getNode();
-            if (curr->children[index] == NULL)
+            child = Split_Node(curr, child, m);
+            if (child == NULL)
                 return -1;
-            strcpy(curr->children[index]->path_token, path_token);
-            curr->children[index]->Server_Handle = Server_Handle;
         }
 
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        parent = curr;
+        curr = child;
+        i += m;
     }
 
-    // Set the final node's Server_Handle
+    // Set the final node's Server_Handle, the tokens before it keep theirs
+    if (curr != root && curr->Server_Handle != Server_Handle && curr->label_tokens > 1)
+    {
+        TrieNode *upper = Split_Node(parent, curr, curr->label_tokens - 1);
+        if (upper == NULL)
+            return -1;
+        parent = upper;
+    }
     curr->Server_Handle = Server_Handle;
 
+    // The node may now be served like its only child or its parent
+    Try_Merge(curr);
+    Try_Merge(parent);
+
     return 0;
 }
+/**
+ * @brief Inserts the path in the trie
+ * @param root: The root node of the trie
+ * @param path: The path to be inserted
+ * @param Server_Handle: The server handle of the path
+ * @return: 0 on success, -1 on failure
+ * @note: Directories already in the trie keep their server handle, the path itself takes the new one
+ * @note: The path is indexed only once it is in the trie, a failed insert leaves no handle in the index
+ */
+int Insert_Path(TrieNode *root, char *path, void *Server_Handle)
+{
+    if (root == NULL || path == NULL || Server_Handle == NULL)
+        return -1;
+
+    // The trie splits the path, the index gets the whole of it
+    char *path_cpy = (char *)calloc(strlen(path) + 1, sizeof(char));
+    if (path_cpy == NULL)
+        return -1;
+    strcpy(path_cpy, path);
+
+    int err = Insert_Nodes(root, path, Server_Handle);
+    if (err == 0)
+        err = PathIndexInsert(root->Trie->Path_Index, path_cpy, Server_Handle);
+    free(path_cpy);
+    return err < 0 ? -1 : 0;
+}
 /**
  * @brief Returns the server handle of the path
  * @param root: The root node of the trie
  * @param path: The path for which the server handle is to be returned
  * @return: The server handle of the path
  * @note: Returns NULL if the path is not present in the trie
+ * @note: The root resolves the full path through its index, falling back to the server exporting
+ *        its longest prefix (files below an export point are only known to that server),
+ *        other nodes walk the trie and match exactly
  */
 void *Get_Server(TrieNode *root, char *path) // returns the server handle of the path
 {
     if (root == NULL || path == NULL)
         return NULL;
-    TrieNode *curr = root;
+    if (root == root->Trie->Root)
+        return PathIndexLookup(root->Trie->Path_Index, path, NULL);
+
     char *path_cpy = (char *)calloc(strlen(path) + 1, sizeof(char));
+    if (path_cpy == NULL)
+        return NULL;
     strcpy(path_cpy, path);
-    char *path_token = strtok(path_cpy, "/");
-    path_token = strtok(NULL, "/");
-    while (path_token != NULL)
-    {
-        int index = Hash(path_token);
-        if (curr->children[index] == NULL)
-            return NULL;
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
-    }
+    char *tokens[MAX_PATH_TOKENS];
+    int count = Tokenize(path_cpy, tokens);
+
+    TrieNode *parent;
+    uint32_t matched;
+    TrieNode *curr = Walk(root, tokens, count, &parent, &matched);
     free(path_cpy);
-    return curr->Server_Handle;
+    // Every token of a label is served by the node's server
+    return curr == NULL ? NULL : curr->Server_Handle;
+}
+/**
+ * @brief Checks if a path is served by a single server
+ * @param root: The root node of the trie
+ * @param path: The path
+ * @return: 1 if the path is an export point or below one, 0 if it is above the export points or not mounted
+ */
+int Is_Exported(TrieNode *root, char *path)
+{
+    if (root == NULL || path == NULL)
+        return 0;
+    int exported;
+    PathIndexLookup(root->Trie->Path_Index, path, &exported);
+    return exported;
 }
 /**
  * @brief Deletes the path from the trie
@@ -157,42 +649,53 @@ int Delete_Path(TrieNode *root, char *path) // deletes the path from the trie
 {
     if (root == NULL || path == NULL)
         return -1;
-    TrieNode *curr = root;
-    TrieNode *prev = NULL;
-    char *path_token = strtok(path, "/");
-    int index;
-    while (path_token != NULL)
+
+    // Drop the subtree from the index before the path is split
+    PathIndexRemove(root->Trie->Path_Index, path);
+
+    char *tokens[MAX_PATH_TOKENS];
+    int count = Tokenize(path, tokens);
+
+    TrieNode *parent;
+    uint32_t matched;
+    TrieNode *curr = Walk(root, tokens, count, &parent, &matched);
+    // The root itself is not deleted
+    if (curr == NULL || parent == NULL)
+        return -1;
+
+    // Keep the tokens of the label above the deleted one
+    if (matched > 1)
     {
-        index = Hash(path_token);
-        if (curr->children[index] == NULL)
+        parent = Split_Node(parent, curr, matched - 1);
+        if (parent == NULL)
             return -1;
-        prev = curr;
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
     }
 
     // Delete the subtree for the given path
-    prev->children[index] = NULL;
+    Remove_Child(parent, curr);
+    Try_Merge(parent);
     return Recursive_Delete(curr);
 }
 /**
  * @brief Deletes the trie
  * @param root: The root node of the trie
  * @return: 0 on success, -1 on failure
- * @note: Deletes the trie recursively
+ * @note: Releases the arena of the trie at once (a subtree is deleted recursively)
  */
 int Delete_Trie(TrieNode *root) // deletes the trie
 {
     if (root == NULL)
         return -1;
-    for (int i = 0; i < MAX_CHILDREN; i++)
-    {
-        if (root->children[i] != NULL)
-        {
-            Delete_Trie(root->children[i]);
-        }
-    }
-    free(root);
+    TRIE_CONTEXT *trie = root->Trie;
+    if (root != trie->Root)
+        return Recursive_Delete(root);
+
+    // Every node, child table and label is in the arena
+    DestroyPathIndex(trie->Path_Index);
+    free(trie->tokens);
+    free(trie->token_hashes);
+    DestroyArena(trie->Arena);
+    free(trie);
     return 0;
 }
 
@@ -201,26 +704,32 @@ int Delete_Trie(TrieNode *root) // deletes the trie
  * @brief Prints the trie
  * @param root: The root node of the trie
  * @param lvl: The level of the node in the trie
- * @note: Prints the trie recursively
+ * @note: Prints the trie recursively, a token per line
  */
 void Print_Trie(TrieNode *root, int lvl) // prints the trie
 {
     if (root == NULL)
         return;
-    for (int i = 0; i < lvl; i++)
+    unsigned long server_id = root->Server_Handle == NULL ? -1 : ((SERVER_HANDLE_STRUCT*)root->Server_Handle)->ServerID;
+    const char *label = root->path_token;
+    for (uint32_t t = 0; t < root->label_tokens; t++, lvl++)
     {
-        if (i%2 == 0)
-            printf("|");
-        else
-            printf(" ");
+        for (int i = 0; i < lvl; i++)
+        {
+            if (i%2 == 0)
+                printf("|");
+            else
+                printf(" ");
+        }
+        size_t len = First_Token_Len(label);
+        printf("|-%.*s (Server ID: %lu)\n", (int)len, label, server_id);
+        label += len + (label[len] == '/');
     }
-    unsigned long server_id = root->Server_Handle == NULL ? -1 : ((SERVER_HANDLE_STRUCT*)root->Server_Handle)->ServerID;
-    printf("|-%s (Server ID: %lu)\n", root->path_token, server_id);
-    for (int i = 0; i < MAX_CHILDREN; i++)
+    for (uint32_t i = 0; i < root->child_capacity; i++)
     {
         if (root->children[i] != NULL)
         {
-            Print_Trie(root->children[i], lvl + 1);
+            Print_Trie(root->children[i], lvl);
         }
     }
     return;
@@ -239,35 +748,28 @@ int Get_Directory_Tree(TrieNode *root, char *path, char* buffer) // fills the bu
     if (root == NULL || path == NULL)
         return -2;
     // itterate to the node for the given path
-    TrieNode *curr = root;
-
     char *path_cpy = (char *) malloc(strlen(path) + 1);
-    memset(path_cpy, 0, strlen(path) + 1);
-
+    if (path_cpy == NULL)
+        return -2;
     strcpy(path_cpy, path);
-    char *path_token = strtok(path_cpy, "/");
-    path_token = strtok(NULL, "/");
-    while (path_token != NULL)
+    char *tokens[MAX_PATH_TOKENS];
+    int count = Tokenize(path_cpy, tokens);
+
+    TrieNode *parent;
+    uint32_t matched;
+    TrieNode *curr = Walk(root, tokens, count, &parent, &matched);
+    free(path_cpy);
+    if (curr == NULL)
     {
-        int index = Hash(path_token);
-        if (curr->children[index] == NULL)
-        {
-            free(path_cpy);
-            strcpy(buffer, "Invalid Path");
-            return -1;
-        }
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        strcpy(buffer, "Invalid Path");
+        return -1;
     }
-    free(path_cpy);
-
-    // Recursively get the subtree path
-    // char *subtree_path = (char *)calloc(MAX_BUFFER_SIZE, sizeof(char));
 
-    if(Get_Directory_Tree_Full(curr,buffer , 0) < 0)
+    // Recursively get the subtree path (starting at the token the path ends on)
+    if(Get_Directory_Tree_Full(curr, matched - 1, buffer, 0) < 0)
     {
         strcpy(buffer, "Error in getting subtree directory");
         return -2;
     }
-    return 0; 
+    return 0;
 }
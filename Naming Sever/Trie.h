@@ -1,22 +1,45 @@
 #ifndef __TRIE_H__
 #define __TRIE_H__
 
+#include <stdint.h>
 #include "Headers.h"
+#include "Arena.h"
+#include "PathIndex.h"
 
-#define MAX_CHILDREN 512 // specifies the maximum nummber of contents in a directory (Keep High for good hash performance)
+#define TRIE_INTERN_INITIAL_SLOTS 1024 // A power of two, doubled when 3/4 full
+#define MAX_PATH_TOKENS (MAX_PATH_LEN / 2 + 1) // Most tokens a path can have
 
+struct TRIE_CONTEXT;
 
+// A node is an edge of one or more tokens, runs of single child directories served by the same server share a node
 typedef struct TrieNode {
-    char path_token[MAX_PATH_LEN];
-    void* Server_Handle;
-    struct TrieNode* children[MAX_CHILDREN];
+    const char* path_token;         // Interned label, its tokens joined by '/'
+    void* Server_Handle;            // Server of every token of the label
+    struct TrieNode** children;     // Open addressing table (linear probing on token_hash), NULL if there are no children
+    uint32_t child_count;
+    uint32_t child_capacity;        // A power of two, 0 if there are no children
+    uint32_t token_hash;            // Hash of the first token of the label
+    uint32_t label_tokens;          // Number of tokens in the label
+    struct TRIE_CONTEXT* Trie;      // State shared by the nodes of the trie
 }TrieNode;
 
+// Owned by the root, released with the whole trie by Delete_Trie
+typedef struct TRIE_CONTEXT {
+    TrieNode* Root;
+    ARENA* Arena;                   // Nodes, child tables and interned tokens
+    const char** tokens;            // Interned labels (open addressing on their hash)
+    uint32_t* token_hashes;
+    size_t token_capacity;
+    size_t token_count;
+    PATH_INDEX* Path_Index;         // Full path index of the whole trie, used by Get_Server
+}TRIE_CONTEXT;
+
 // TrieNode* getNode(); // returns a new node
-// int Hash(char* path_token); // returns the index of the child in the children array else -1
-TrieNode* Init_Trie(); // returns the root node of the empty trie
+// int Hash(char* path_token); // returns the hash of the token
+TrieNode* Init_Trie(const char* root_token); // returns the root node of the empty trie
 int Insert_Path(TrieNode* root,char* path, void* Server_Handle); // inserts the path in the trie
-void* Get_Server(TrieNode* root, char* path); // returns the server handle of the path
+void* Get_Server(TrieNode* root, char* path); // returns the server handle of the path (or of its longest exported prefix)
+int Is_Exported(TrieNode* root, char* path); // returns 1 if the path is an export point or below one
 int Delete_Path(TrieNode* root, char* path); // deletes the path from the trie
 int Delete_Trie(TrieNode* root); // deletes the trie
 // int Recursive_Delete(TrieNode* root); // deletes the trie recursively
@@ -25,4 +48,4 @@ void Print_Trie(TrieNode* root, int lvl); // prints the trie
 int Get_Directory_Tree(TrieNode* root, char* path, char* buffer); // Populates the buffer with the directory tree
 // char* Get_Directory_Tree_Full(TrieNode* root, char* cur_dir, int lvl); // returns a string with the full tree path
 
-#endif
\ No newline at end of file
+#endif
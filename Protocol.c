@@ -0,0 +1,1248 @@
+#define _GNU_SOURCE // splice, pipe2, F_SETPIPE_SZ
+#include "./Protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Local (de)serialisation helpers, integers are written in big endian (network byte order)
+static unsigned char *PutU32(unsigned char *buffer, uint32_t value)
+{
+    buffer[0] = (value >> 24) & 0xFF;
+    buffer[1] = (value >> 16) & 0xFF;
+    buffer[2] = (value >> 8) & 0xFF;
+    buffer[3] = value & 0xFF;
+    return buffer + 4;
+}
+
+static unsigned char *PutU64(unsigned char *buffer, uint64_t value)
+{
+    buffer = PutU32(buffer, (uint32_t)(value >> 32));
+    return PutU32(buffer, (uint32_t)value);
+}
+
+static const unsigned char *GetU32(const unsigned char *buffer, uint32_t *value)
+{
+    *value = ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+    return buffer + 4;
+}
+
+static const unsigned char *GetU64(const unsigned char *buffer, uint64_t *value)
+{
+    uint32_t high, low;
+    buffer = GetU32(buffer, &high);
+    buffer = GetU32(buffer, &low);
+    *value = ((uint64_t)high << 32) | low;
+    return buffer;
+}
+
+/**
+ * @brief Copies a string payload into a fixed size buffer and terminates it
+ * @param dest: The destination buffer
+ * @param size: The size of the destination buffer
+ * @param src: The start of the string in the payload
+ * @param len: The length of the string in the payload
+ */
+static void GetString(char *dest, size_t size, const unsigned char *src, size_t len)
+{
+    if (len >= size)
+        len = size - 1;
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
+/**
+ * @brief Sends the entire buffer over the socket
+ * @param sockfd: The socket to send on
+ * @param buffer: The data to be sent
+ * @param len: The number of bytes to send
+ * @param flags: Flags passed to send (MSG_NOSIGNAL is always added)
+ * @return: The number of bytes sent on success, -1 on failure
+ * @note: Loops over partial writes and interrupted calls
+ */
+int SendAll(int sockfd, const void *buffer, size_t len, int flags)
+{
+    size_t sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = send(sockfd, (const char *)buffer + sent, len - sent, flags | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        sent += n;
+    }
+    return (int)sent;
+}
+
+/**
+ * @brief Receives exactly len bytes from the socket
+ * @param sockfd: The socket to receive from
+ * @param buffer: The buffer to be filled
+ * @param len: The number of bytes to receive
+ * @return: len on success, 0 if the peer closed the connection before any byte was read, -1 on failure
+ * @note: A connection closed in the middle of the buffer is reported as a failure (errno = ECONNRESET)
+ */
+int RecvAll(int sockfd, void *buffer, size_t len)
+{
+    size_t recvd = 0;
+    while (recvd < len)
+    {
+        ssize_t n = recv(sockfd, (char *)buffer + recvd, len - recvd, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        else if (n == 0)
+        {
+            if (recvd == 0)
+                return 0;
+            errno = ECONNRESET;
+            return -1;
+        }
+        recvd += n;
+    }
+    return (int)recvd;
+}
+
+/**
+ * @brief Serialises a packet header
+ * @param header: The header to be encoded
+ * @param buffer: The output buffer (atleast PACKET_HEADER_SIZE bytes)
+ * @return: PACKET_HEADER_SIZE
+ */
+int EncodeHeader(const PACKET_HEADER *header, unsigned char *buffer)
+{
+    buffer[0] = (header->iMagic >> 8) & 0xFF;
+    buffer[1] = header->iMagic & 0xFF;
+    buffer[2] = header->iVersion;
+    buffer[3] = header->iType;
+    buffer = PutU32(buffer + 4, (uint32_t)header->iOpcode);
+    buffer = PutU32(buffer, header->iRequestID);
+    PutU32(buffer, header->iLength);
+    return PACKET_HEADER_SIZE;
+}
+
+/**
+ * @brief Deserialises and validates a packet header
+ * @param buffer: The encoded header (PACKET_HEADER_SIZE bytes)
+ * @param header: The decoded header
+ * @return: 0 on success, -1 if the magic or version do not match (errno = EPROTO)
+ */
+int DecodeHeader(const unsigned char *buffer, PACKET_HEADER *header)
+{
+    uint32_t opcode;
+    header->iMagic = ((uint16_t)buffer[0] << 8) | buffer[1];
+    header->iVersion = buffer[2];
+    header->iType = buffer[3];
+    buffer = GetU32(buffer + 4, &opcode);
+    buffer = GetU32(buffer, &header->iRequestID);
+    GetU32(buffer, &header->iLength);
+    header->iOpcode = (int32_t)opcode;
+
+    if (header->iMagic != PROTOCOL_MAGIC || header->iVersion != PROTOCOL_VERSION)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sends the header of a packet, the payload is sent by the caller
+ * @param sockfd: The socket to send on
+ * @param iType: The type of the packet (PACKET_TYPE_*)
+ * @param iOpcode: The operation the packet belongs to
+ * @param iRequestID: The request the packet belongs to (0 if not applicable)
+ * @param len: The length of the payload that follows
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+static int SendHeader(int sockfd, int iType, int iOpcode, uint32_t iRequestID, uint32_t len)
+{
+    PACKET_HEADER header;
+    header.iMagic = PROTOCOL_MAGIC;
+    header.iVersion = PROTOCOL_VERSION;
+    header.iType = (uint8_t)iType;
+    header.iOpcode = iOpcode;
+    header.iRequestID = iRequestID;
+    header.iLength = len;
+
+    unsigned char buffer[PACKET_HEADER_SIZE];
+    EncodeHeader(&header, buffer);
+
+    // Hint the kernel to coalesce the header with the payload
+    return SendAll(sockfd, buffer, PACKET_HEADER_SIZE, len ? MSG_MORE : 0);
+}
+
+/**
+ * @brief Sends a packet (header followed by the payload)
+ * @param sockfd: The socket to send on
+ * @param iType: The type of the packet (PACKET_TYPE_*)
+ * @param iOpcode: The operation the packet belongs to
+ * @param iRequestID: The request the packet belongs to (0 if not applicable)
+ * @param payload: The payload (may be NULL if len is 0)
+ * @param len: The length of the payload
+ * @return: The total number of bytes sent on success, -1 on failure
+ */
+int SendPacket(int sockfd, int iType, int iOpcode, uint32_t iRequestID, const void *payload, uint32_t len)
+{
+    if (SendHeader(sockfd, iType, iOpcode, iRequestID, len) < 0)
+        return -1;
+    if (len && SendAll(sockfd, payload, len, 0) < 0)
+        return -1;
+    return PACKET_HEADER_SIZE + len;
+}
+
+/**
+ * @brief Receives a packet
+ * @param sockfd: The socket to receive from
+ * @param header: The decoded header of the packet
+ * @param payload: The buffer for the payload
+ * @param cap: The capacity of the payload buffer
+ * @return: The total number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ * @note: A payload larger than cap is drained from the socket and reported as a failure (errno = EMSGSIZE)
+ */
+int RecvPacket(int sockfd, PACKET_HEADER *header, void *payload, uint32_t cap)
+{
+    unsigned char buffer[PACKET_HEADER_SIZE];
+    int err = RecvAll(sockfd, buffer, PACKET_HEADER_SIZE);
+    if (err <= 0)
+        return err;
+
+    if (DecodeHeader(buffer, header) < 0)
+        return -1;
+
+    if (header->iLength > cap)
+    {
+        // Drain the payload to keep the stream in sync
+        char drain[MAX_BUFFER_SIZE];
+        uint32_t left = header->iLength;
+        while (left > 0)
+        {
+            uint32_t chunk = left < sizeof(drain) ? left : sizeof(drain);
+            if (RecvAll(sockfd, drain, chunk) <= 0)
+                return -1;
+            left -= chunk;
+        }
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (header->iLength && RecvAll(sockfd, payload, header->iLength) <= 0)
+        return -1;
+
+    return PACKET_HEADER_SIZE + header->iLength;
+}
+
+/**
+ * @brief Receives a packet of the expected type
+ * @return: Same as RecvPacket, -1 (errno = EPROTO) if the type does not match
+ */
+static int RecvTypedPacket(int sockfd, int iType, PACKET_HEADER *header, unsigned char *payload, uint32_t cap)
+{
+    int err = RecvPacket(sockfd, header, payload, cap);
+    if (err > 0 && header->iType != iType)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    return err;
+}
+
+// Request Payload: ClientID(8) | Flags(4) | ChunkSize(4) | Offset(8) | Length(8) | Path
+#define REQUEST_FIXED_SIZE 32
+
+int EncodeRequest(const REQUEST_STRUCT *request, unsigned char *buffer, size_t cap)
+{
+    size_t path_len = strnlen(request->sRequestPath, MAX_BUFFER_SIZE - 1);
+    if (cap < REQUEST_FIXED_SIZE + path_len)
+        return -1;
+
+    unsigned char *cur = PutU64(buffer, request->iRequestClientID);
+    cur = PutU32(cur, (uint32_t)request->iRequestFlags);
+    cur = PutU32(cur, request->iRequestChunkSize);
+    cur = PutU64(cur, request->iRequestOffset);
+    cur = PutU64(cur, request->iRequestLength);
+    memcpy(cur, request->sRequestPath, path_len);
+    return REQUEST_FIXED_SIZE + path_len;
+}
+
+int DecodeRequest(const unsigned char *buffer, size_t len, REQUEST_STRUCT *request)
+{
+    if (len < REQUEST_FIXED_SIZE)
+        return -1;
+
+    uint64_t client_id;
+    uint64_t offset, length;
+    uint32_t flags, chunk_size;
+    const unsigned char *cur = GetU64(buffer, &client_id);
+    cur = GetU32(cur, &flags);
+    cur = GetU32(cur, &chunk_size);
+    cur = GetU64(cur, &offset);
+    cur = GetU64(cur, &length);
+
+    request->iRequestClientID = (unsigned long)client_id;
+    request->iRequestFlags = (int)flags;
+    request->iRequestChunkSize = chunk_size;
+    request->iRequestOffset = offset;
+    request->iRequestLength = length;
+    GetString(request->sRequestPath, MAX_BUFFER_SIZE, cur, len - REQUEST_FIXED_SIZE);
+    return (int)len;
+}
+
+// Response Payload: ErrorCode(4) | Flags(4) | ServerID(8) | Data
+#define RESPONSE_FIXED_SIZE 16
+
+int EncodeResponse(const RESPONSE_STRUCT *response, unsigned char *buffer, size_t cap)
+{
+    size_t data_len = strnlen(response->sResponseData, MAX_BUFFER_SIZE - 1);
+    if (cap < RESPONSE_FIXED_SIZE + data_len)
+        return -1;
+
+    unsigned char *cur = PutU32(buffer, (uint32_t)response->iResponseErrorCode);
+    cur = PutU32(cur, (uint32_t)response->iResponseFlags);
+    cur = PutU64(cur, response->iResponseServerID);
+    memcpy(cur, response->sResponseData, data_len);
+    return RESPONSE_FIXED_SIZE + data_len;
+}
+
+int DecodeResponse(const unsigned char *buffer, size_t len, RESPONSE_STRUCT *response)
+{
+    if (len < RESPONSE_FIXED_SIZE)
+        return -1;
+
+    uint32_t error_code, flags;
+    uint64_t server_id;
+    const unsigned char *cur = GetU32(buffer, &error_code);
+    cur = GetU32(cur, &flags);
+    cur = GetU64(cur, &server_id);
+
+    response->iResponseErrorCode = (int)error_code;
+    response->iResponseFlags = (int)flags;
+    response->iResponseServerID = (unsigned long)server_id;
+    GetString(response->sResponseData, MAX_BUFFER_SIZE, cur, len - RESPONSE_FIXED_SIZE);
+    return (int)len;
+}
+
+/**
+ * @brief Sends a request packet
+ * @param sockfd: The socket to send on
+ * @param request: The request to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendRequest(int sockfd, const REQUEST_STRUCT *request)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeRequest(request, payload, sizeof(payload));
+    if (len < 0)
+        return -1;
+    return SendPacket(sockfd, PACKET_TYPE_REQUEST, request->iRequestOperation, request->iRequestID, payload, len);
+}
+
+/**
+ * @brief Receives a request packet
+ * @param sockfd: The socket to receive from
+ * @param request: The request to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvRequest(int sockfd, REQUEST_STRUCT *request)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_REQUEST, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+
+    request->iRequestOperation = header.iOpcode;
+    request->iRequestID = header.iRequestID;
+    if (DecodeRequest(payload, header.iLength, request) < 0)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    return err;
+}
+
+/**
+ * @brief Sends a response packet
+ * @param sockfd: The socket to send on
+ * @param response: The response to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendResponse(int sockfd, const RESPONSE_STRUCT *response)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeResponse(response, payload, sizeof(payload));
+    if (len < 0)
+        return -1;
+    return SendPacket(sockfd, PACKET_TYPE_RESPONSE, response->iResponseOperation, response->iResponseRequestID, payload, len);
+}
+
+/**
+ * @brief Receives a response packet
+ * @param sockfd: The socket to receive from
+ * @param response: The response to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvResponse(int sockfd, RESPONSE_STRUCT *response)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_RESPONSE, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+
+    response->iResponseOperation = header.iOpcode;
+    response->iResponseRequestID = header.iRequestID;
+    if (DecodeResponse(payload, header.iLength, response) < 0)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    return err;
+}
+
+// Ack Payload: ErrorCode(4) | Flags(4) | Data
+#define ACK_FIXED_SIZE 8
+
+int DecodeAck(const unsigned char *buffer, size_t len, ACK_STRUCT *ack)
+{
+    if (len < ACK_FIXED_SIZE)
+        return -1;
+
+    uint32_t error_code, flags;
+    const unsigned char *cur = GetU32(buffer, &error_code);
+    cur = GetU32(cur, &flags);
+    ack->iAckErrorCode = (int)error_code;
+    ack->iAckFlags = (int)flags;
+    GetString(ack->sAckData, MAX_BUFFER_SIZE, cur, len - ACK_FIXED_SIZE);
+    return (int)len;
+}
+
+int EncodeAck(const ACK_STRUCT *ack, unsigned char *buffer, size_t cap)
+{
+    size_t data_len = strnlen(ack->sAckData, MAX_BUFFER_SIZE - 1);
+    if (cap < ACK_FIXED_SIZE + data_len)
+        return -1;
+
+    unsigned char *cur = PutU32(buffer, (uint32_t)ack->iAckErrorCode);
+    cur = PutU32(cur, (uint32_t)ack->iAckFlags);
+    memcpy(cur, ack->sAckData, data_len);
+    return (int)(ACK_FIXED_SIZE + data_len);
+}
+
+/**
+ * @brief Sends an ack packet
+ * @param sockfd: The socket to send on
+ * @param iOpcode: The operation being acknowledged
+ * @param ack: The ack to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendAck(int sockfd, int iOpcode, const ACK_STRUCT *ack)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int len = EncodeAck(ack, payload, sizeof(payload));
+    if (len < 0)
+        return -1;
+    return SendPacket(sockfd, PACKET_TYPE_ACK, iOpcode, ack->iAckRequestID, payload, len);
+}
+
+/**
+ * @brief Receives an ack packet
+ * @param sockfd: The socket to receive from
+ * @param ack: The ack to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvAck(int sockfd, ACK_STRUCT *ack)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_ACK, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+
+    ack->iAckRequestID = header.iRequestID;
+    if (DecodeAck(payload, header.iLength, ack) < 0)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    return err;
+}
+
+// Init Payload: ClientPort(4) | NServerPort(4) | MountPaths
+#define INIT_FIXED_SIZE 8
+
+/**
+ * @brief Sends the storage server init packet
+ * @param sockfd: The socket to send on
+ * @param init: The init struct to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendInit(int sockfd, const STORAGE_SERVER_INIT_STRUCT *init)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    size_t paths_len = strnlen(init->MountPaths, MAX_BUFFER_SIZE - 1);
+
+    unsigned char *cur = PutU32(payload, (uint32_t)init->sServerPort_Client);
+    cur = PutU32(cur, (uint32_t)init->sServerPort_NServer);
+    memcpy(cur, init->MountPaths, paths_len);
+    return SendPacket(sockfd, PACKET_TYPE_INIT, 0, 0, payload, INIT_FIXED_SIZE + paths_len);
+}
+
+/**
+ * @brief Receives the storage server init packet
+ * @param sockfd: The socket to receive from
+ * @param init: The init struct to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvInit(int sockfd, STORAGE_SERVER_INIT_STRUCT *init)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_INIT, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+    if (header.iLength < INIT_FIXED_SIZE)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+
+    uint32_t client_port, ns_port;
+    const unsigned char *cur = GetU32(payload, &client_port);
+    cur = GetU32(cur, &ns_port);
+    init->sServerPort_Client = (int)client_port;
+    init->sServerPort_NServer = (int)ns_port;
+    GetString(init->MountPaths, MAX_BUFFER_SIZE, cur, header.iLength - INIT_FIXED_SIZE);
+    return err;
+}
+
+// Path Info Payload: Type(4) | Size(4) | Permission(4) | CTime(4) | MTime(4) | ATime(4) | Links(4) | Path
+#define PATH_INFO_FIXED_SIZE 28
+
+/**
+ * @brief Sends a path info packet
+ * @param sockfd: The socket to send on
+ * @param info: The path info to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendPathInfo(int sockfd, const PATH_INFO_STRUCT *info)
+{
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    size_t path_len = strnlen(info->sPath, MAX_BUFFER_SIZE - 1);
+
+    unsigned char *cur = PutU32(payload, (uint32_t)info->iPathType);
+    cur = PutU32(cur, (uint32_t)info->iPathSize);
+    cur = PutU32(cur, (uint32_t)info->iPathPermission);
+    cur = PutU32(cur, (uint32_t)info->iPathCreationTime);
+    cur = PutU32(cur, (uint32_t)info->iPathModificationTime);
+    cur = PutU32(cur, (uint32_t)info->iPathAccessTime);
+    cur = PutU32(cur, (uint32_t)info->iPathLinks);
+    memcpy(cur, info->sPath, path_len);
+    return SendPacket(sockfd, PACKET_TYPE_PATH_INFO, CMD_INFO, 0, payload, PATH_INFO_FIXED_SIZE + path_len);
+}
+
+/**
+ * @brief Receives a path info packet
+ * @param sockfd: The socket to receive from
+ * @param info: The path info to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvPathInfo(int sockfd, PATH_INFO_STRUCT *info)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_PATH_INFO, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+    if (header.iLength < PATH_INFO_FIXED_SIZE)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+
+    uint32_t fields[7];
+    const unsigned char *cur = payload;
+    for (int i = 0; i < 7; i++)
+        cur = GetU32(cur, &fields[i]);
+
+    info->iPathType = (int)fields[0];
+    info->iPathSize = (int)fields[1];
+    info->iPathPermission = (int)fields[2];
+    info->iPathCreationTime = (int)fields[3];
+    info->iPathModificationTime = (int)fields[4];
+    info->iPathAccessTime = (int)fields[5];
+    info->iPathLinks = (int)fields[6];
+    GetString(info->sPath, MAX_BUFFER_SIZE, cur, header.iLength - PATH_INFO_FIXED_SIZE);
+    return err;
+}
+
+/**
+ * @brief Encodes an ID alloted by the naming server
+ * @param ID: The ID to be encoded
+ * @param buffer: The output buffer (atleast 8 bytes)
+ * @return: The payload length
+ */
+int EncodeID(unsigned long ID, unsigned char *buffer)
+{
+    PutU64(buffer, ID);
+    return 8;
+}
+
+/**
+ * @brief Sends an ID alloted by the naming server
+ * @param sockfd: The socket to send on
+ * @param ID: The ID to be sent
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendID(int sockfd, unsigned long ID)
+{
+    unsigned char payload[8];
+    EncodeID(ID, payload);
+    return SendPacket(sockfd, PACKET_TYPE_ID, 0, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief Receives an ID alloted by the naming server
+ * @param sockfd: The socket to receive from
+ * @param ID: The ID to be filled
+ * @return: The number of bytes read on success, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvID(int sockfd, unsigned long *ID)
+{
+    PACKET_HEADER header;
+    unsigned char payload[8];
+    int err = RecvTypedPacket(sockfd, PACKET_TYPE_ID, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+    if (header.iLength != sizeof(payload))
+    {
+        errno = EPROTO;
+        return -1;
+    }
+
+    uint64_t id;
+    GetU64(payload, &id);
+    *ID = (unsigned long)id;
+    return err;
+}
+
+/**
+ * @brief Clamps a requested chunk size to the range supported by data streams
+ * @param iHint: The chunk size asked for by the peer (0 for default)
+ * @return: The chunk size to be used for the stream
+ */
+uint32_t NegotiateChunkSize(uint32_t iHint)
+{
+    if (iHint == 0)
+        return STREAM_CHUNK_DEFAULT;
+    if (iHint < STREAM_CHUNK_MIN)
+        return STREAM_CHUNK_MIN;
+    if (iHint > STREAM_CHUNK_MAX)
+        return STREAM_CHUNK_MAX;
+    return iHint;
+}
+
+/**
+ * @brief Announces the start of a data stream
+ * @param sockfd: The socket to send on
+ * @param iOpcode: The operation the stream belongs to
+ * @param iChunkSize: The negotiated chunk size (largest DATA payload of the stream)
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendStreamStart(int sockfd, int iOpcode, uint32_t iChunkSize, uint64_t iTotalLength)
+{
+    unsigned char payload[12];
+    PutU64(PutU32(payload, iChunkSize), iTotalLength);
+    return SendPacket(sockfd, PACKET_TYPE_STREAM_START, iOpcode, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief Waits for the start of a data stream
+ * @param sockfd: The socket to receive from
+ * @param iChunkSize: The negotiated chunk size (set if the stream started)
+ * @param iTotalLength: The number of data bytes in the stream or STREAM_LENGTH_UNKNOWN (may be NULL)
+ * @param response: Filled if the peer answered with a response instead (request refused)
+ * @return: PACKET_TYPE_STREAM_START or PACKET_TYPE_RESPONSE, 0 if the peer closed the connection, -1 on failure
+ */
+int RecvStreamStart(int sockfd, uint32_t *iChunkSize, uint64_t *iTotalLength, RESPONSE_STRUCT *response)
+{
+    PACKET_HEADER header;
+    unsigned char payload[MAX_PACKET_PAYLOAD];
+    int err = RecvPacket(sockfd, &header, payload, sizeof(payload));
+    if (err <= 0)
+        return err;
+
+    if (header.iType == PACKET_TYPE_RESPONSE)
+    {
+        response->iResponseOperation = header.iOpcode;
+        response->iResponseRequestID = header.iRequestID;
+        if (DecodeResponse(payload, header.iLength, response) < 0)
+        {
+            errno = EPROTO;
+            return -1;
+        }
+        return PACKET_TYPE_RESPONSE;
+    }
+
+    uint32_t chunk_size;
+    uint64_t total_length;
+    if (header.iType != PACKET_TYPE_STREAM_START || header.iLength != 12)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    GetU64(GetU32(payload, &chunk_size), &total_length);
+    if (chunk_size < STREAM_CHUNK_MIN || chunk_size > STREAM_CHUNK_MAX)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    *iChunkSize = chunk_size;
+    if (iTotalLength != NULL)
+        *iTotalLength = total_length;
+    return PACKET_TYPE_STREAM_START;
+}
+
+/**
+ * @brief Sends one chunk of a data stream
+ * @param sockfd: The socket to send on
+ * @param iOpcode: The operation the stream belongs to
+ * @param buffer: The data to be sent
+ * @param len: The number of bytes in the chunk (atmost the negotiated chunk size)
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendChunk(int sockfd, int iOpcode, const void *buffer, uint32_t len)
+{
+    return SendPacket(sockfd, PACKET_TYPE_DATA, iOpcode, 0, buffer, len);
+}
+
+/**
+ * @brief Copies a range of a file into DATA frames without staging it in userspace
+ * @param sockfd: The socket to send on
+ * @param fd: The file to be sent
+ * @param offset: The offset of the range in the file
+ * @param len: The number of payload bytes of the frame
+ * @return: The number of bytes of the file sent, -1 on failure
+ * @note: Falls back to pread/send where sendfile is not supported for the file
+ */
+static int64_t SendFileFrame(int sockfd, int fd, off_t offset, uint32_t len)
+{
+    uint32_t sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = sendfile(sockfd, fd, &offset, len - sent);
+        if (n > 0)
+        {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno != EINVAL && errno != ENOSYS)
+            return -1;
+        if (n == 0)
+            break; // The file shrank under us
+
+        // sendfile is not supported for this file, copy through a buffer
+        unsigned char buffer[64 * 1024];
+        while (sent < len)
+        {
+            size_t want = (len - sent) < sizeof(buffer) ? (len - sent) : sizeof(buffer);
+            ssize_t r = pread(fd, buffer, want, offset);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r < 0)
+                return -1;
+            if (r == 0)
+                break;
+            if (SendAll(sockfd, buffer, r, 0) < 0)
+                return -1;
+            offset += r;
+            sent += r;
+        }
+        break;
+    }
+    return sent;
+}
+
+/**
+ * @brief Sends a range of a file as DATA frames of a stream
+ * @param sockfd: The socket to send on
+ * @param iOpcode: The operation the stream belongs to
+ * @param fd: The file to be sent
+ * @param offset: The offset of the range in the file
+ * @param len: The length of the range (as announced in STREAM_START)
+ * @param iChunkSize: The negotiated chunk size
+ * @return: The number of bytes of the file sent, -1 on failure (the stream is unusable)
+ * @note: The file data goes from the page cache to the socket with sendfile. If the file
+ *        shrinks while it is sent the frame in flight is padded with zeros to keep the
+ *        stream framed and fewer than len bytes are reported
+ */
+int64_t SendFileChunks(int sockfd, int iOpcode, int fd, off_t offset, uint64_t len, uint32_t iChunkSize)
+{
+    uint64_t sent = 0;
+    while (sent < len)
+    {
+        uint32_t frame = (len - sent) < iChunkSize ? (uint32_t)(len - sent) : iChunkSize;
+        if (SendHeader(sockfd, PACKET_TYPE_DATA, iOpcode, 0, frame) < 0)
+            return -1;
+
+        int64_t n = SendFileFrame(sockfd, fd, offset + sent, frame);
+        if (n < 0)
+            return -1;
+        sent += n;
+
+        if ((uint32_t)n < frame)
+        {
+            unsigned char zeros[4096];
+            memset(zeros, 0, sizeof(zeros));
+            for (uint32_t pad = frame - n; pad > 0;)
+            {
+                uint32_t step = pad < sizeof(zeros) ? pad : sizeof(zeros);
+                if (SendAll(sockfd, zeros, step, 0) < 0)
+                    return -1;
+                pad -= step;
+            }
+            break;
+        }
+    }
+    return sent;
+}
+
+/**
+ * @brief Terminates a data stream
+ * @param sockfd: The socket to send on
+ * @param iOpcode: The operation the stream belongs to
+ * @param iErrorCode: 0 if the whole stream was sent, otherwise the error that cut it short
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendStreamEnd(int sockfd, int iOpcode, int iErrorCode)
+{
+    unsigned char payload[4];
+    PutU32(payload, (uint32_t)iErrorCode);
+    return SendPacket(sockfd, PACKET_TYPE_END, iOpcode, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief Receives the next frame of a data stream
+ * @param sockfd: The socket to receive from
+ * @param buffer: The buffer for the chunk (atleast the negotiated chunk size)
+ * @param cap: The capacity of the buffer
+ * @param len: The number of data bytes in the chunk
+ * @param iErrorCode: The error code carried by the end of stream frame
+ * @return: 1 for a DATA frame, 0 for the END frame, -1 on failure (including a closed connection)
+ */
+int RecvChunk(int sockfd, void *buffer, uint32_t cap, uint32_t *len, int *iErrorCode)
+{
+    PACKET_HEADER header;
+    int err = RecvPacket(sockfd, &header, buffer, cap);
+    if (err == 0)
+        errno = ECONNRESET;
+    if (err <= 0)
+        return -1;
+
+    if (header.iType == PACKET_TYPE_DATA)
+    {
+        *len = header.iLength;
+        return 1;
+    }
+    else if (header.iType == PACKET_TYPE_END && header.iLength == 4)
+    {
+        uint32_t error_code;
+        GetU32(buffer, &error_code);
+        *len = 0;
+        *iErrorCode = (int)error_code;
+        return 0;
+    }
+
+    errno = EPROTO;
+    return -1;
+}
+
+/**
+ * @brief Writes a buffer to a file at the given offset
+ * @param fd: The file to write to
+ * @param buffer: The data to be written
+ * @param len: The number of bytes to be written
+ * @param offset: The offset to write at (advanced past the data)
+ * @return: 0 on success, -1 on failure
+ */
+static int PWriteAll(int fd, const unsigned char *buffer, size_t len, off_t *offset)
+{
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, buffer, len, *offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        buffer += n;
+        len -= n;
+        *offset += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Moves the bytes held in a pipe into a file
+ * @param pipe_rd: The read end of the pipe
+ * @param fd: The file to write to
+ * @param len: The number of bytes in the pipe
+ * @param offset: The offset to write at (advanced past the data)
+ * @param buffer: Scratch buffer used when splice cannot write to the file
+ * @param cap: The capacity of the scratch buffer
+ * @param splice_ok: Cleared once splice turns out to be unsupported for the file
+ * @param write_err: Set to errno if the file could not be written (the bytes are then discarded)
+ * @return: 0 on success (even if the write failed), -1 if the pipe could not be read
+ */
+static int FlushPipe(int pipe_rd, int fd, size_t len, off_t *offset, unsigned char *buffer, size_t cap, int *splice_ok, int *write_err)
+{
+    while (len > 0)
+    {
+        if (*splice_ok && *write_err == 0)
+        {
+            ssize_t n = splice(pipe_rd, NULL, fd, offset, len, SPLICE_F_MOVE);
+            if (n > 0)
+            {
+                len -= n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+                *splice_ok = 0;
+            else
+                *write_err = n < 0 ? errno : EIO;
+            continue;
+        }
+
+        // Copy out of the pipe through the buffer (or just drain it after a write error)
+        ssize_t n = read(pipe_rd, buffer, len < cap ? len : cap);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        if (*write_err == 0 && PWriteAll(fd, buffer, n, offset) < 0)
+            *write_err = errno;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Receives the DATA frames of a stream straight into a file
+ * @param sockfd: The socket to receive from
+ * @param fd: The file to write to
+ * @param offset: The offset in the file to write the stream at
+ * @param iChunkSize: The negotiated chunk size
+ * @param iLimit: The most bytes to be written (STREAM_LENGTH_UNKNOWN for no limit)
+ * @param iErrorCode: The error code of the END frame (0 if the peer sent the whole stream)
+ * @param iWriteError: Set to errno if the file could not be written (EFBIG past iLimit), 0 otherwise
+ * @param scratch: A buffer of atleast iChunkSize bytes to copy through (NULL to allocate one)
+ * @return: The number of bytes written to the file, -1 if the stream failed (the connection is unusable)
+ * @note: The payload is moved socket -> pipe -> file with splice so it never enters userspace,
+ *        recv + pwrite is used where splice is not supported. After a write error the rest of
+ *        the stream is drained so that the connection stays framed
+ */
+int64_t RecvStreamToFile(int sockfd, int fd, off_t offset, uint32_t iChunkSize, uint64_t iLimit, int *iErrorCode, int *iWriteError, unsigned char *scratch)
+{
+    *iErrorCode = 0;
+    *iWriteError = 0;
+
+    unsigned char *buffer = scratch ? scratch : (unsigned char *)malloc(iChunkSize);
+    if (buffer == NULL)
+        return -1;
+
+    int pipefd[2];
+    int have_pipe = (pipe2(pipefd, O_CLOEXEC) == 0);
+    int splice_ok = have_pipe;
+    if (have_pipe)
+        fcntl(pipefd[1], F_SETPIPE_SZ, iChunkSize); // A frame fits the pipe in one go, best effort
+
+    off_t start = offset;
+    int64_t ret = -1;
+    while (1)
+    {
+        unsigned char raw[PACKET_HEADER_SIZE];
+        PACKET_HEADER header;
+        int err = RecvAll(sockfd, raw, PACKET_HEADER_SIZE);
+        if (err == 0)
+            errno = ECONNRESET;
+        if (err <= 0 || DecodeHeader(raw, &header) < 0)
+            break;
+
+        if (header.iType == PACKET_TYPE_END && header.iLength == 4)
+        {
+            uint32_t error_code;
+            if (RecvAll(sockfd, raw, 4) <= 0)
+                break;
+            GetU32(raw, &error_code);
+            *iErrorCode = (int)error_code;
+            ret = offset - start;
+            break;
+        }
+        if (header.iType != PACKET_TYPE_DATA || header.iLength > iChunkSize)
+        {
+            errno = EPROTO;
+            break;
+        }
+        if (*iWriteError == 0 && (uint64_t)(offset - start) + header.iLength > iLimit)
+            *iWriteError = EFBIG; // Drain the rest of the stream without writing it
+
+        uint32_t remaining = header.iLength;
+        while (remaining > 0)
+        {
+            ssize_t n;
+            if (splice_ok)
+            {
+                n = splice(sockfd, NULL, pipefd[1], NULL, remaining, SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+                {
+                    splice_ok = 0;
+                    continue;
+                }
+                if (n > 0 && FlushPipe(pipefd[0], fd, n, &offset, buffer, iChunkSize, &splice_ok, iWriteError) < 0)
+                    break;
+            }
+            else
+            {
+                n = recv(sockfd, buffer, remaining, 0);
+                if (n > 0 && *iWriteError == 0 && PWriteAll(fd, buffer, n, &offset) < 0)
+                    *iWriteError = errno;
+            }
+
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                if (n == 0)
+                    errno = ECONNRESET;
+                break;
+            }
+            remaining -= n;
+        }
+        if (remaining > 0)
+            break;
+    }
+
+    if (have_pipe)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    if (buffer != scratch)
+        free(buffer);
+    return ret;
+}
+
+/**
+ * @brief Sends a batch of paths to be resolved by the naming server
+ * @param sockfd: The socket to send on
+ * @param iRequestID: The request the batch belongs to
+ * @param paths: The paths to be resolved
+ * @param count: The number of paths (atmost MAX_RESOLVE_BATCH)
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendResolveBatch(int sockfd, uint32_t iRequestID, char *const paths[], int count)
+{
+    if (count < 0 || count > MAX_RESOLVE_BATCH)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned char *payload = (unsigned char *)malloc(RESOLVE_BATCH_MAX_PAYLOAD);
+    if (payload == NULL)
+        return -1;
+
+    unsigned char *cur = PutU32(payload, (uint32_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        size_t path_len = strnlen(paths[i], MAX_BUFFER_SIZE - 1);
+        memcpy(cur, paths[i], path_len);
+        cur += path_len;
+        *cur++ = '\0';
+    }
+
+    int err = SendPacket(sockfd, PACKET_TYPE_RESOLVE_BATCH, CMD_RESOLVE_BATCH, iRequestID, payload, cur - payload);
+    free(payload);
+    return err;
+}
+
+/**
+ * @brief Decodes a batch of paths in place
+ * @param buffer: The payload of the batch (modified)
+ * @param len: The length of the payload
+ * @param paths: Filled with pointers to the '\0' terminated paths inside the buffer
+ * @param cap: The capacity of paths
+ * @return: The number of paths on success, -1 if the payload is malformed
+ */
+int DecodeResolveBatch(unsigned char *buffer, size_t len, char *paths[], int cap)
+{
+    if (len < 4)
+        return -1;
+
+    uint32_t count;
+    unsigned char *cur = (unsigned char *)GetU32(buffer, &count);
+    unsigned char *end = buffer + len;
+    if (count > (uint32_t)cap)
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        unsigned char *nul = memchr(cur, '\0', end - cur);
+        if (nul == NULL)
+            return -1;
+        paths[i] = (char *)cur;
+        cur = nul + 1;
+    }
+    return (int)count;
+}
+
+/**
+ * @brief Encodes the results of a batched resolution
+ * @param results: The result of every path, in the order of the batch
+ * @param count: The number of results (atmost MAX_RESOLVE_BATCH)
+ * @param buffer: The output buffer
+ * @param cap: The capacity of the buffer
+ * @return: The payload length on success, -1 on failure
+ */
+int EncodeResolveResults(const RESOLVE_RESULT_STRUCT *results, int count, unsigned char *buffer, size_t cap)
+{
+    if (count < 0 || count > MAX_RESOLVE_BATCH || cap < 4 + (size_t)count * RESOLVE_RESULT_SIZE)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned char *cur = PutU32(buffer, (uint32_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        cur = PutU32(cur, (uint32_t)results[i].iErrorCode);
+        cur = PutU32(cur, (uint32_t)results[i].iFlags);
+        cur = PutU64(cur, results[i].iServerID);
+        cur = PutU32(cur, (uint32_t)results[i].iServerPort);
+        cur = PutU32(cur, results[i].iLeaseTTL);
+        cur = PutU64(cur, results[i].iEpoch);
+        memset(cur, 0, IP_LENGTH);
+        memcpy(cur, results[i].sServerIP, strnlen(results[i].sServerIP, IP_LENGTH - 1));
+        cur += IP_LENGTH;
+    }
+    return (int)(cur - buffer);
+}
+
+/**
+ * @brief Sends the results of a batched resolution
+ * @param sockfd: The socket to send on
+ * @param iRequestID: The request the results belong to
+ * @param results: The result of every path, in the order of the batch
+ * @param count: The number of results (atmost MAX_RESOLVE_BATCH)
+ * @return: The number of bytes sent on success, -1 on failure
+ */
+int SendResolveResults(int sockfd, uint32_t iRequestID, const RESOLVE_RESULT_STRUCT *results, int count)
+{
+    unsigned char payload[RESOLVE_RESULT_MAX_PAYLOAD];
+    int len = EncodeResolveResults(results, count, payload, sizeof(payload));
+    if (len < 0)
+        return -1;
+    return SendPacket(sockfd, PACKET_TYPE_RESOLVE_RESULT, CMD_RESOLVE_BATCH, iRequestID, payload, len);
+}
+
+/**
+ * @brief Decodes the results of a batched resolution
+ * @param buffer: The payload of the results
+ * @param len: The length of the payload
+ * @param results: The results to be filled
+ * @param cap: The capacity of results
+ * @return: The number of results on success, -1 if the payload is malformed
+ */
+int DecodeResolveResults(const unsigned char *buffer, size_t len, RESOLVE_RESULT_STRUCT *results, int cap)
+{
+    if (len < 4)
+        return -1;
+
+    uint32_t count;
+    const unsigned char *cur = GetU32(buffer, &count);
+    if (count > (uint32_t)cap || len != 4 + (size_t)count * RESOLVE_RESULT_SIZE)
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t error_code, flags, port, lease_ttl;
+        uint64_t server_id, epoch;
+        cur = GetU32(cur, &error_code);
+        cur = GetU32(cur, &flags);
+        cur = GetU64(cur, &server_id);
+        cur = GetU32(cur, &port);
+        cur = GetU32(cur, &lease_ttl);
+        cur = GetU64(cur, &epoch);
+
+        results[i].iErrorCode = (int)error_code;
+        results[i].iFlags = (int)flags;
+        results[i].iServerID = (unsigned long)server_id;
+        results[i].iServerPort = (int)port;
+        results[i].iLeaseTTL = lease_ttl;
+        results[i].iEpoch = epoch;
+        GetString(results[i].sServerIP, IP_LENGTH, cur, strnlen((const char *)cur, IP_LENGTH));
+        cur += IP_LENGTH;
+    }
+    return (int)count;
+}
+
+// Revoke Payload: Epoch(8) | ServerID(8) | Prefix
+#define REVOKE_FIXED_SIZE 16
+
+/**
+ * @brief Encodes the payload of a lease revocation
+ * @param iEpoch: The namespace epoch after the change
+ * @param iServerID: The server whose leases are void (0 for any server)
+ * @param prefix: The path at or below which leases are void ("" for every path)
+ * @param buffer: The buffer to encode into
+ * @param cap: The capacity of the buffer
+ * @return: The length of the payload on success, -1 if it does not fit
+ */
+int EncodeRevoke(uint64_t iEpoch, unsigned long iServerID, const char *prefix, unsigned char *buffer, size_t cap)
+{
+    size_t prefix_len = strnlen(prefix, MAX_BUFFER_SIZE - 1);
+    if (cap < REVOKE_FIXED_SIZE + prefix_len)
+        return -1;
+
+    unsigned char *cur = PutU64(buffer, iEpoch);
+    cur = PutU64(cur, iServerID);
+    memcpy(cur, prefix, prefix_len);
+    return REVOKE_FIXED_SIZE + prefix_len;
+}
+
+/**
+ * @brief Decodes the payload of a lease revocation
+ * @param buffer: The payload
+ * @param len: The length of the payload
+ * @param iEpoch: Filled with the namespace epoch
+ * @param iServerID: Filled with the server (0 for any server)
+ * @param prefix: Filled with the path prefix
+ * @param size: The size of prefix
+ * @return: The length of the payload on success, -1 if it is malformed
+ */
+int DecodeRevoke(const unsigned char *buffer, size_t len, uint64_t *iEpoch, unsigned long *iServerID, char *prefix, size_t size)
+{
+    if (len < REVOKE_FIXED_SIZE)
+        return -1;
+
+    uint64_t server_id;
+    const unsigned char *cur = GetU64(buffer, iEpoch);
+    cur = GetU64(cur, &server_id);
+    *iServerID = (unsigned long)server_id;
+    GetString(prefix, size, cur, len - REVOKE_FIXED_SIZE);
+    return (int)len;
+}
@@ -0,0 +1,152 @@
+// Wire Protocol common to all code (Client, Naming Server, Storage Server)
+
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "./Externals.h"
+
+/*
+PACKET LAYOUT (all integers are sent in network byte order)
+    +---------+---------+--------+----------+-----------+----------+------------------+
+    |  Magic  | Version |  Type  |  Opcode  | RequestID |  Length  |  Payload         |
+    |  2 B    |  1 B    |  1 B   |  4 B     |  4 B      |  4 B     |  <Length> bytes  |
+    +---------+---------+--------+----------+-----------+----------+------------------+
+
+    Magic   : PROTOCOL_MAGIC, used to detect a desynchronised stream
+    Version : PROTOCOL_VERSION, packets with any other version are rejected
+    Type    : PACKET_TYPE_* (what the payload encodes)
+    Opcode  : CMD_* the packet belongs to (0 if not applicable)
+    RequestID : ID chosen by the client for a request, echoed in every response/ack
+                to it so that replies on a pipelined connection can arrive out of order
+    Length  : number of payload bytes that follow the header
+
+Only the bytes that are actually used are sent, strings are sent without the
+trailing '\0' (their length is implied by the payload length)
+
+DATA STREAMS (READ/WRITE file contents)
+    1. The receiver of the request answers with STREAM_START carrying the chunk
+       size negotiated from the request hint (or with a RESPONSE if it refuses)
+       STREAM_START : ChunkSize(4) | TotalLength(8)
+       TotalLength is the number of data bytes that will follow, or
+       STREAM_LENGTH_UNKNOWN when the sender does not know it upfront
+    2. The sender of the data sends DATA frames of atmost that many bytes
+    3. An END frame (carrying an error code, 0 on success) closes the stream
+    4. The storage server then sends the usual RESPONSE
+
+BATCHED RESOLUTION (CMD_RESOLVE_BATCH)
+    RESOLVE_BATCH  : Count(4) | Path '\0' Path '\0' ...
+    RESOLVE_RESULT : Count(4) | { ErrorCode(4) | Flags(4) | ServerID(8) | Port(4) | LeaseTTL(4) | Epoch(8) | IP(IP_LENGTH) } * Count
+    Results are in the order of the paths, a malformed batch is answered with Count 0
+
+LEASES
+    1. A result with a LeaseTTL (ms) may be cached by the client for that long, Epoch is the
+       namespace epoch of the naming server when the lease was issued (0 TTL: do not cache)
+    2. When a mapping changes the naming server bumps the epoch and pushes a REVOKE to the
+       clients holding leases, on the same connection as the replies (RequestID 0)
+       REVOKE : Epoch(8) | ServerID(8) | Prefix
+       Leases at or below Prefix (every lease if empty) on ServerID (any server if 0) are void
+    3. A client ignores leases of an epoch older than the newest REVOKE it applied
+*/
+
+#define PROTOCOL_MAGIC 0x4E46 // "NF"
+#define PROTOCOL_VERSION 6
+#define PACKET_HEADER_SIZE 16
+#define MAX_PACKET_PAYLOAD (MAX_BUFFER_SIZE + 64) // Largest payload of a struct packet
+
+// Packet Types
+#define PACKET_TYPE_REQUEST 1   // REQUEST_STRUCT
+#define PACKET_TYPE_RESPONSE 2  // RESPONSE_STRUCT
+#define PACKET_TYPE_ACK 3       // ACK_STRUCT
+#define PACKET_TYPE_INIT 4      // STORAGE_SERVER_INIT_STRUCT
+#define PACKET_TYPE_PATH_INFO 5 // PATH_INFO_STRUCT
+#define PACKET_TYPE_ID 6        // Client/Server ID alloted by the naming server
+#define PACKET_TYPE_STREAM_START 7 // Start of a data stream (negotiated chunk size)
+#define PACKET_TYPE_DATA 8      // One chunk of a data stream
+#define PACKET_TYPE_END 9       // End of a data stream (error code)
+#define PACKET_TYPE_RESOLVE_BATCH 10  // Paths to be resolved (CMD_RESOLVE_BATCH)
+#define PACKET_TYPE_RESOLVE_RESULT 11 // RESOLVE_RESULT_STRUCT for every path of a batch
+#define PACKET_TYPE_REVOKE 12   // Leases voided by the naming server
+
+// Batched Resolution
+#define MAX_RESOLVE_BATCH 256
+#define RESOLVE_RESULT_SIZE (32 + IP_LENGTH) // Encoded size of one RESOLVE_RESULT_STRUCT
+#define RESOLVE_BATCH_MAX_PAYLOAD (4 + MAX_RESOLVE_BATCH * MAX_BUFFER_SIZE)
+#define RESOLVE_RESULT_MAX_PAYLOAD (4 + MAX_RESOLVE_BATCH * RESOLVE_RESULT_SIZE)
+
+// Data Stream Chunk Sizes
+#define STREAM_CHUNK_MIN (64 * 1024)
+#define STREAM_CHUNK_MAX (1024 * 1024)
+#define STREAM_CHUNK_DEFAULT (256 * 1024)
+#define STREAM_LENGTH_UNKNOWN UINT64_MAX
+
+// Packet Header (host byte order once decoded)
+typedef struct PACKET_HEADER
+{
+    uint16_t iMagic;   // Magic number
+    uint8_t iVersion;  // Protocol version
+    uint8_t iType;     // Type of the payload
+    int32_t iOpcode;   // Operation the packet belongs to
+    uint32_t iRequestID; // Request the packet belongs to
+    uint32_t iLength;  // Length of the payload
+} PACKET_HEADER;
+
+// Socket Helpers (loop over partial send/recv)
+int SendAll(int sockfd, const void *buffer, size_t len, int flags);
+int RecvAll(int sockfd, void *buffer, size_t len);
+
+// Generic Packets
+int EncodeHeader(const PACKET_HEADER *header, unsigned char *buffer);
+int DecodeHeader(const unsigned char *buffer, PACKET_HEADER *header);
+int SendPacket(int sockfd, int iType, int iOpcode, uint32_t iRequestID, const void *payload, uint32_t len);
+int RecvPacket(int sockfd, PACKET_HEADER *header, void *payload, uint32_t cap);
+
+// Struct (de)serialisation, returns the payload length on success, -1 on failure
+int EncodeRequest(const REQUEST_STRUCT *request, unsigned char *buffer, size_t cap);
+int DecodeRequest(const unsigned char *buffer, size_t len, REQUEST_STRUCT *request);
+int EncodeResponse(const RESPONSE_STRUCT *response, unsigned char *buffer, size_t cap);
+int DecodeResponse(const unsigned char *buffer, size_t len, RESPONSE_STRUCT *response);
+int EncodeAck(const ACK_STRUCT *ack, unsigned char *buffer, size_t cap);
+int DecodeAck(const unsigned char *buffer, size_t len, ACK_STRUCT *ack);
+int EncodeID(unsigned long ID, unsigned char *buffer);
+
+// Typed Packets
+// Send* return the bytes written or -1, Recv* return the bytes read, 0 if the peer closed the connection or -1
+int SendRequest(int sockfd, const REQUEST_STRUCT *request);
+int RecvRequest(int sockfd, REQUEST_STRUCT *request);
+int SendResponse(int sockfd, const RESPONSE_STRUCT *response);
+int RecvResponse(int sockfd, RESPONSE_STRUCT *response);
+int SendAck(int sockfd, int iOpcode, const ACK_STRUCT *ack);
+int RecvAck(int sockfd, ACK_STRUCT *ack);
+int SendInit(int sockfd, const STORAGE_SERVER_INIT_STRUCT *init);
+int RecvInit(int sockfd, STORAGE_SERVER_INIT_STRUCT *init);
+int SendPathInfo(int sockfd, const PATH_INFO_STRUCT *info);
+int RecvPathInfo(int sockfd, PATH_INFO_STRUCT *info);
+int SendID(int sockfd, unsigned long ID);
+int RecvID(int sockfd, unsigned long *ID);
+
+// Data Streams
+uint32_t NegotiateChunkSize(uint32_t iHint);
+int SendStreamStart(int sockfd, int iOpcode, uint32_t iChunkSize, uint64_t iTotalLength);
+int RecvStreamStart(int sockfd, uint32_t *iChunkSize, uint64_t *iTotalLength, RESPONSE_STRUCT *response);
+int SendChunk(int sockfd, int iOpcode, const void *buffer, uint32_t len);
+int64_t SendFileChunks(int sockfd, int iOpcode, int fd, off_t offset, uint64_t len, uint32_t iChunkSize);
+int SendStreamEnd(int sockfd, int iOpcode, int iErrorCode);
+int RecvChunk(int sockfd, void *buffer, uint32_t cap, uint32_t *len, int *iErrorCode);
+int64_t RecvStreamToFile(int sockfd, int fd, off_t offset, uint32_t iChunkSize, uint64_t iLimit, int *iErrorCode, int *iWriteError, unsigned char *scratch);
+
+// Batched Resolution
+int SendResolveBatch(int sockfd, uint32_t iRequestID, char *const paths[], int count);
+int DecodeResolveBatch(unsigned char *buffer, size_t len, char *paths[], int cap);
+int EncodeResolveResults(const RESOLVE_RESULT_STRUCT *results, int count, unsigned char *buffer, size_t cap);
+int SendResolveResults(int sockfd, uint32_t iRequestID, const RESOLVE_RESULT_STRUCT *results, int count);
+int DecodeResolveResults(const unsigned char *buffer, size_t len, RESOLVE_RESULT_STRUCT *results, int cap);
+
+// Leases
+int EncodeRevoke(uint64_t iEpoch, unsigned long iServerID, const char *prefix, unsigned char *buffer, size_t cap);
+int DecodeRevoke(const unsigned char *buffer, size_t len, uint64_t *iEpoch, unsigned long *iServerID, char *prefix, size_t size);
+
+#endif // _PROTOCOL_H_
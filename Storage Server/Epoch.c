@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "./Epoch.h"
+
+/*
+EPOCH BASED RECLAMATION
+    1. A reader stores the global epoch in its own slot when it starts a read section and
+       clears it when it ends, so reading writes no cache line shared with other threads
+    2. A writer unlinks memory and retires it, which advances the global epoch, readers that
+       start later can not reach the memory
+    3. Retired memory is freed (by later retires) once every slot is clear or newer than the
+       epoch it was retired in
+*/
+
+static uint64_t Global_Epoch = 1;
+static Epoch_Slot Slots[EPOCH_MAX_THREADS] __attribute__((aligned(EPOCH_LINE_SIZE)));
+
+static pthread_mutex_t Retired_Lock = PTHREAD_MUTEX_INITIALIZER;
+static Epoch_Retired *Retired = NULL;
+
+static pthread_once_t Slot_Key_Once = PTHREAD_ONCE_INIT;
+static pthread_key_t Slot_Key;
+static __thread Epoch_Slot *My_Slot = NULL;
+static __thread int Depth = 0; // Read sections may nest
+
+/**
+ * @brief Gives the slot of an exiting thread back
+ */
+static void Release_Slot(void *Slot)
+{
+    __atomic_store_n(&((Epoch_Slot *)Slot)->In_Use, 0, __ATOMIC_RELEASE);
+}
+
+static void Create_Slot_Key()
+{
+    pthread_key_create(&Slot_Key, Release_Slot);
+}
+
+/**
+ * @brief Claims a slot for the calling thread
+ * @return the slot of the thread
+ * @note waits for a thread to exit if all EPOCH_MAX_THREADS slots are taken
+ */
+static Epoch_Slot *Claim_Slot()
+{
+    pthread_once(&Slot_Key_Once, Create_Slot_Key);
+    while (1)
+    {
+        for (int i = 0; i < EPOCH_MAX_THREADS; i++)
+        {
+            int Free = 0;
+            if (__atomic_compare_exchange_n(&Slots[i].In_Use, &Free, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            {
+                pthread_setspecific(Slot_Key, &Slots[i]);
+                return &Slots[i];
+            }
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Starts a read section
+ * @note memory reachable when the section starts is not freed before Epoch_Exit
+ */
+void Epoch_Enter()
+{
+    if (Depth++ > 0)
+    {
+        return;
+    }
+    if (My_Slot == NULL)
+    {
+        My_Slot = Claim_Slot();
+    }
+    // The store must be visible before anything is read in the section
+    __atomic_store_n(&My_Slot->Epoch, __atomic_load_n(&Global_Epoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Ends a read section
+ */
+void Epoch_Exit()
+{
+    if (--Depth > 0)
+    {
+        return;
+    }
+    __atomic_store_n(&My_Slot->Epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Frees the retired memory no reader can still see (Retired_Lock held)
+ */
+static void Epoch_Reclaim()
+{
+    uint64_t Oldest = __atomic_load_n(&Global_Epoch, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < EPOCH_MAX_THREADS; i++)
+    {
+        uint64_t Epoch = __atomic_load_n(&Slots[i].Epoch, __ATOMIC_SEQ_CST);
+        if (Epoch != 0 && Epoch < Oldest)
+        {
+            Oldest = Epoch;
+        }
+    }
+
+    Epoch_Retired **Link = &Retired;
+    while (*Link != NULL)
+    {
+        Epoch_Retired *Entry = *Link;
+        if (Entry->Epoch < Oldest)
+        {
+            *Link = Entry->Next;
+            Entry->Free(Entry->Ptr);
+            free(Entry);
+        }
+        else
+        {
+            Link = &Entry->Next;
+        }
+    }
+}
+
+/**
+ * @brief Frees memory once every read section that may have seen it has ended
+ * @param Ptr the memory, already unlinked from anything a new reader can reach
+ * @param Free the function that frees it
+ * @note if the bookkeeping can not be allocated the memory is leaked rather than freed early
+ */
+void Epoch_Retire(void *Ptr, void (*Free)(void *))
+{
+    if (Ptr == NULL)
+    {
+        return;
+    }
+    Epoch_Retired *Entry = (Epoch_Retired *)malloc(sizeof(Epoch_Retired));
+
+    pthread_mutex_lock(&Retired_Lock);
+    if (Entry != NULL)
+    {
+        Entry->Ptr = Ptr;
+        Entry->Free = Free;
+        // Readers that start after this can not reach Ptr
+        Entry->Epoch = __atomic_fetch_add(&Global_Epoch, 1, __ATOMIC_SEQ_CST);
+        Entry->Next = Retired;
+        Retired = Entry;
+    }
+    Epoch_Reclaim();
+    pthread_mutex_unlock(&Retired_Lock);
+}
@@ -0,0 +1,31 @@
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define EPOCH_MAX_THREADS 64 // Threads that may be reading at once (workers, listeners and the log flusher)
+#define EPOCH_LINE_SIZE 64   // Each reader announces its epoch on a cache line of its own
+
+// Epoch a thread entered its read section in, 0 while it is not reading
+typedef struct Epoch_Slot
+{
+    uint64_t Epoch;
+    int In_Use;
+    char Pad[EPOCH_LINE_SIZE - sizeof(uint64_t) - sizeof(int)];
+}Epoch_Slot;
+
+// Memory unlinked by a writer, freed once no reader can still see it
+typedef struct Epoch_Retired
+{
+    void *Ptr;
+    void (*Free)(void *);
+    uint64_t Epoch; // Epoch it was unlinked in
+    struct Epoch_Retired *Next;
+}Epoch_Retired;
+
+void Epoch_Enter(); // Starts a read section, memory seen inside it is not freed until Epoch_Exit
+void Epoch_Exit();
+void Epoch_Retire(void *Ptr, void (*Free)(void *)); // Frees Ptr once every current read section has ended
+
+#endif // __EPOCH_H__
@@ -7,5 +7,6 @@
 #define ERROR_INVALID_PATH 303
 #define ERROR_INVALID_ACCESS 304
 #define ERROR_INVALID_FLAG 305
+#define ERROR_INVALID_RANGE 306
 
 #endif // __STORAGE_SERVER_ERROR_CODES_H__
\ No newline at end of file
@@ -3,17 +3,21 @@
 
 #include <stdio.h>
 #include "./Trie.h"
+#include "../Externals.h"
 
 # define MAX_CONN_Q 5
 #define LOG_FLUSH_INTERVAL 10
+#define CLIENT_IDLE_TIMEOUT 30 // Seconds a client session may stay idle before it is closed
 
 
 // structure for client object
 typedef struct Client
 {
     int socket;
-    char* IP;
+    char IP[IP_LENGTH];
     int port;
+    double Last_Active; // Time the session last carried a request
+    int Served;         // Requests served in the session
 }Client;
 
 
@@ -35,7 +39,6 @@ extern CLOCK* Clock;
 
 void* NS_Listner_Thread(void* arg);
 void* Client_Listner_Thread(void* arg);
-void* Client_Handler_Thread(void* arg);
 
 
 
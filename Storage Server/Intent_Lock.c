@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "./Intent_Lock.h"
+
+/*
+MULTI GRANULARITY LOCKING
+    1. A file operation takes IS (reads) or IX (writes) on every directory above its file and
+       then the lock of the file itself, a subtree operation takes IX above its directory and X
+       (or S) on it, so it excludes exactly the operations below it
+    2. Locks are taken from the root down, so waits never form a cycle
+    3. Intent modes are compatible with each other, file operations on unrelated paths only
+       share the intent locks of their common directories and never wait on them
+    4. A waiting S or X request stops new IS and IX requests from joining the holders, so a
+       subtree operation is not starved by a busy directory
+*/
+
+static const uint64_t Mode_One[] = {INTENT_IS_ONE, INTENT_IX_ONE, INTENT_S_ONE, INTENT_X_HELD};
+
+/**
+ * @brief Initializes an Intent_Lock Object
+ * @param None
+ * @return a pointer to Intent_Lock Object
+ */
+Intent_Lock *Intent_Lock_Init()
+{
+    Intent_Lock *Lock = (Intent_Lock *)malloc(sizeof(Intent_Lock));
+    if (Lock == NULL)
+        return NULL;
+    Lock->State = 0;
+    pthread_mutex_init(&Lock->Mutex, NULL);
+    pthread_cond_init(&Lock->Released, NULL);
+    Lock->Waiters = 0;
+    Lock->Subtree_Waiters = 0;
+
+    return Lock;
+}
+
+/**
+ * @brief Destroys an Intent_Lock Object
+ * @param Lock: The intent lock (not held and nobody waiting)
+ */
+void Intent_Lock_Destroy(Intent_Lock *Lock)
+{
+    if (Lock == NULL)
+        return;
+    pthread_mutex_destroy(&Lock->Mutex);
+    pthread_cond_destroy(&Lock->Released);
+    free(Lock);
+}
+
+/**
+ * @brief Checks if a mode can be granted next to the holders
+ * @param State: The state of the lock
+ * @param Mode: The mode asked for
+ * @return: 1 if it is compatible with every holder (and, for IS and IX, no S or X request waits), 0 otherwise
+ */
+static int Intent_Compatible(uint64_t State, int Mode)
+{
+    uint64_t IX = (State >> 20) & INTENT_COUNT_MASK;
+    uint64_t S = (State >> 40) & INTENT_COUNT_MASK;
+    switch (Mode)
+    {
+    case INTENT_IS:
+        return !(State & (INTENT_X_HELD | INTENT_PENDING));
+    case INTENT_IX:
+        return !(State & (INTENT_X_HELD | INTENT_PENDING)) && S == 0;
+    case INTENT_S:
+        return !(State & INTENT_X_HELD) && IX == 0;
+    default:
+        return (State & ~(INTENT_PENDING | INTENT_WAITING)) == 0;
+    }
+}
+
+/**
+ * @brief Grants a mode if it is compatible with the holders
+ * @return: 1 if it was granted, 0 otherwise
+ */
+static int Intent_Try(Intent_Lock *Lock, int Mode)
+{
+    uint64_t State = __atomic_load_n(&Lock->State, __ATOMIC_RELAXED);
+    while (Intent_Compatible(State, Mode))
+    {
+        if (__atomic_compare_exchange_n(&Lock->State, &State, State + Mode_One[Mode], 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Waits until a mode is compatible with the holders and takes it
+ * @param Lock: The intent lock
+ * @param Mode: INTENT_IS, INTENT_IX, INTENT_S or INTENT_X
+ */
+void Intent_Lock_Acquire(Intent_Lock *Lock, int Mode)
+{
+    if (Intent_Try(Lock, Mode))
+        return;
+
+    pthread_mutex_lock(&Lock->Mutex);
+    // Set before the retry, a release after it sees the flag and wakes us
+    if (Lock->Waiters++ == 0)
+        __atomic_fetch_or(&Lock->State, INTENT_WAITING, __ATOMIC_SEQ_CST);
+    int Subtree = (Mode == INTENT_S || Mode == INTENT_X);
+    if (Subtree && Lock->Subtree_Waiters++ == 0)
+        __atomic_fetch_or(&Lock->State, INTENT_PENDING, __ATOMIC_SEQ_CST);
+
+    while (!Intent_Try(Lock, Mode))
+        pthread_cond_wait(&Lock->Released, &Lock->Mutex);
+
+    if (Subtree && --Lock->Subtree_Waiters == 0)
+    {
+        // Let the IS and IX requests that queued behind us retry
+        __atomic_fetch_and(&Lock->State, ~INTENT_PENDING, __ATOMIC_SEQ_CST);
+        pthread_cond_broadcast(&Lock->Released);
+    }
+    if (--Lock->Waiters == 0)
+        __atomic_fetch_and(&Lock->State, ~INTENT_WAITING, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&Lock->Mutex);
+}
+
+/**
+ * @brief Releases a mode
+ * @param Lock: The intent lock
+ * @param Mode: The mode it was taken in
+ */
+void Intent_Lock_Release(Intent_Lock *Lock, int Mode)
+{
+    uint64_t State = __atomic_sub_fetch(&Lock->State, Mode_One[Mode], __ATOMIC_SEQ_CST);
+    if (State & INTENT_WAITING)
+    {
+        pthread_mutex_lock(&Lock->Mutex);
+        pthread_cond_broadcast(&Lock->Released);
+        pthread_mutex_unlock(&Lock->Mutex);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef __INTENT_LOCK_H__
+#define __INTENT_LOCK_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+// Modes of a multi granularity lock, a path takes intent modes on the directories above its target
+#define INTENT_IS 0 // Something below is read
+#define INTENT_IX 1 // Something below is written
+#define INTENT_S 2  // The whole subtree is read
+#define INTENT_X 3  // The whole subtree is changed (renamed, moved or deleted)
+
+// Holders of each mode packed in one word, so compatible modes are taken with a single CAS
+#define INTENT_IS_ONE (1ULL << 0)
+#define INTENT_IX_ONE (1ULL << 20)
+#define INTENT_S_ONE (1ULL << 40)
+#define INTENT_COUNT_MASK ((1ULL << 20) - 1)
+#define INTENT_X_HELD (1ULL << 60)
+#define INTENT_PENDING (1ULL << 61) // An S or X request waits, new IS and IX requests queue behind it
+#define INTENT_WAITING (1ULL << 62) // Someone sleeps, releases have to wake it
+
+// Intent lock of a directory of the trie
+//       IS  IX  S   X
+//   IS  y   y   y   n
+//   IX  y   y   n   n
+//   S   y   n   y   n
+//   X   n   n   n   n
+typedef struct Intent_Lock
+{
+    uint64_t State;
+    pthread_mutex_t Mutex; // Only taken by requests that have to wait and by releases that wake them
+    pthread_cond_t Released;
+    int Waiters;
+    int Subtree_Waiters;   // Waiters for S or X, INTENT_PENDING is set while there are any
+}Intent_Lock;
+
+Intent_Lock *Intent_Lock_Init();
+void Intent_Lock_Destroy(Intent_Lock *Lock);
+void Intent_Lock_Acquire(Intent_Lock *Lock, int Mode);
+void Intent_Lock_Release(Intent_Lock *Lock, int Mode);
+
+#endif // __INTENT_LOCK_H__
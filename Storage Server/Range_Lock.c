@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "./Range_Lock.h"
+
+/*
+INTERVAL TREE OF HELD RANGES
+    1. The held ranges are a treap ordered by (Start, address), random priorities keep it
+       balanced whatever order the ranges are taken in
+    2. Every node keeps the largest End in its subtree and the largest End of a writer in it,
+       a subtree that ends before the range asked for can not overlap it and is skipped
+    3. A reader only conflicts with writers so it prunes with the writer End, the many
+       readers of a hot file do not slow down each other's search
+*/
+
+/**
+ * @brief Initializes a Range_Lock Object
+ * @param None
+ * @return a pointer to Range_Lock Object
+ */
+Range_Lock *Range_Lock_Init()
+{
+    Range_Lock *Lock = (Range_Lock *)malloc(sizeof(Range_Lock));
+    if (Lock == NULL)
+        return NULL;
+    pthread_mutex_init(&Lock->Mutex, NULL);
+    pthread_cond_init(&Lock->Released, NULL);
+    Lock->Held = NULL;
+    Lock->Seed = (uint32_t)(uintptr_t)Lock | 1;
+    Lock->Waiters = 0;
+
+    return Lock;
+}
+
+/**
+ * @brief Destroys a Range_Lock Object
+ * @param Lock: The range lock (no range held and nobody waiting)
+ */
+void Range_Lock_Destroy(Range_Lock *Lock)
+{
+    if (Lock == NULL)
+        return;
+    pthread_mutex_destroy(&Lock->Mutex);
+    pthread_cond_destroy(&Lock->Released);
+    free(Lock);
+}
+
+/**
+ * @brief Generates the priority of a new node (xorshift, Mutex held)
+ */
+static uint32_t Range_Priority(Range_Lock *Lock)
+{
+    uint32_t x = Lock->Seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    Lock->Seed = x;
+    return x;
+}
+
+/**
+ * @brief Recomputes the largest ends of a node from its children
+ */
+static void Range_Update(Range_Lock_Entry *Node)
+{
+    Node->Max_End = Node->End;
+    Node->Max_Writer_End = Node->Writer ? Node->End : 0;
+    for (int i = 0; i < 2; i++)
+    {
+        Range_Lock_Entry *Child = i ? Node->Right : Node->Left;
+        if (Child == NULL)
+            continue;
+        if (Child->Max_End > Node->Max_End)
+            Node->Max_End = Child->Max_End;
+        if (Child->Max_Writer_End > Node->Max_Writer_End)
+            Node->Max_Writer_End = Child->Max_Writer_End;
+    }
+}
+
+/**
+ * @brief Orders two ranges by start, ties broken by address
+ * @return: Nonzero if A goes left of B
+ */
+static int Range_Before(Range_Lock_Entry *A, Range_Lock_Entry *B)
+{
+    return A->Start < B->Start || (A->Start == B->Start && (uintptr_t)A < (uintptr_t)B);
+}
+
+/**
+ * @brief Checks if a range can be taken next to the ranges held in a subtree
+ * @param Node: The root of the subtree (Mutex held)
+ * @param Start: First byte of the range
+ * @param End: Byte after the last byte of the range
+ * @param Writer: 1 if the range is to be written
+ * @return: 1 if some held range overlaps and either of the two is a writer, 0 otherwise
+ */
+static int Range_Conflicts(Range_Lock_Entry *Node, uint64_t Start, uint64_t End, int Writer)
+{
+    while (Node != NULL)
+    {
+        // Nothing in the subtree reaches the range
+        if ((Writer ? Node->Max_End : Node->Max_Writer_End) <= Start)
+            return 0;
+        if (Range_Conflicts(Node->Left, Start, End, Writer))
+            return 1;
+        // The node and everything to its right start after the range
+        if (Node->Start >= End)
+            return 0;
+        if (Start < Node->End && (Writer || Node->Writer))
+            return 1;
+        Node = Node->Right;
+    }
+    return 0;
+}
+
+/**
+ * @brief Inserts a node into a subtree
+ * @return: The new root of the subtree
+ */
+static Range_Lock_Entry *Range_Insert(Range_Lock_Entry *Root, Range_Lock_Entry *Node)
+{
+    if (Root == NULL)
+    {
+        Range_Update(Node);
+        return Node;
+    }
+    if (Range_Before(Node, Root))
+    {
+        Root->Left = Range_Insert(Root->Left, Node);
+        if (Root->Left->Priority > Root->Priority)
+        {
+            // Rotate right
+            Range_Lock_Entry *Left = Root->Left;
+            Root->Left = Left->Right;
+            Left->Right = Root;
+            Range_Update(Root);
+            Root = Left;
+        }
+    }
+    else
+    {
+        Root->Right = Range_Insert(Root->Right, Node);
+        if (Root->Right->Priority > Root->Priority)
+        {
+            // Rotate left
+            Range_Lock_Entry *Right = Root->Right;
+            Root->Right = Right->Left;
+            Right->Left = Root;
+            Range_Update(Root);
+            Root = Right;
+        }
+    }
+    Range_Update(Root);
+    return Root;
+}
+
+/**
+ * @brief Joins two subtrees, every range of Left is before every range of Right
+ * @return: The root of the joined subtree
+ */
+static Range_Lock_Entry *Range_Merge(Range_Lock_Entry *Left, Range_Lock_Entry *Right)
+{
+    if (Left == NULL)
+        return Right;
+    if (Right == NULL)
+        return Left;
+    if (Left->Priority > Right->Priority)
+    {
+        Left->Right = Range_Merge(Left->Right, Right);
+        Range_Update(Left);
+        return Left;
+    }
+    Right->Left = Range_Merge(Left, Right->Left);
+    Range_Update(Right);
+    return Right;
+}
+
+/**
+ * @brief Removes a node from a subtree
+ * @return: The new root of the subtree
+ */
+static Range_Lock_Entry *Range_Remove(Range_Lock_Entry *Root, Range_Lock_Entry *Node)
+{
+    if (Root == NULL)
+        return NULL;
+    if (Root == Node)
+        return Range_Merge(Root->Left, Root->Right);
+    if (Range_Before(Node, Root))
+        Root->Left = Range_Remove(Root->Left, Node);
+    else
+        Root->Right = Range_Remove(Root->Right, Node);
+    Range_Update(Root);
+    return Root;
+}
+
+/**
+ * @brief Waits until the range is free and takes it
+ * @param Lock: The range lock
+ * @param Offset: First byte of the range
+ * @param Length: Number of bytes in the range (RANGE_LOCK_EOF for till the end of the file)
+ * @param Writer: 1 if the range is to be written
+ * @return: The held range (to be passed to Range_Unlock), NULL on failure
+ */
+static Range_Lock_Entry *Range_Lock_Acquire(Range_Lock *Lock, uint64_t Offset, uint64_t Length, int Writer)
+{
+    Range_Lock_Entry *Entry = (Range_Lock_Entry *)malloc(sizeof(Range_Lock_Entry));
+    if (Entry == NULL)
+        return NULL;
+    Entry->Start = Offset;
+    Entry->End = (Length > UINT64_MAX - Offset) ? UINT64_MAX : Offset + Length;
+    Entry->Writer = Writer;
+    Entry->Left = NULL;
+    Entry->Right = NULL;
+
+    pthread_mutex_lock(&Lock->Mutex);
+    while (Range_Conflicts(Lock->Held, Entry->Start, Entry->End, Writer))
+    {
+        Lock->Waiters++;
+        pthread_cond_wait(&Lock->Released, &Lock->Mutex);
+        Lock->Waiters--;
+    }
+    Entry->Priority = Range_Priority(Lock);
+    Lock->Held = Range_Insert(Lock->Held, Entry);
+    pthread_mutex_unlock(&Lock->Mutex);
+
+    return Entry;
+}
+
+// Reader Accquire Range
+Range_Lock_Entry *Range_Read_Lock(Range_Lock *Lock, uint64_t Offset, uint64_t Length)
+{
+    return Range_Lock_Acquire(Lock, Offset, Length, 0);
+}
+// Writer Accquire Range
+Range_Lock_Entry *Range_Write_Lock(Range_Lock *Lock, uint64_t Offset, uint64_t Length)
+{
+    return Range_Lock_Acquire(Lock, Offset, Length, 1);
+}
+// Release Range
+void Range_Unlock(Range_Lock *Lock, Range_Lock_Entry *Entry)
+{
+    if (Entry == NULL)
+        return;
+
+    pthread_mutex_lock(&Lock->Mutex);
+    Lock->Held = Range_Remove(Lock->Held, Entry);
+    if (Lock->Waiters > 0)
+        pthread_cond_broadcast(&Lock->Released);
+    pthread_mutex_unlock(&Lock->Mutex);
+
+    free(Entry);
+}
@@ -0,0 +1,39 @@
+#ifndef __RANGE_LOCK_H__
+#define __RANGE_LOCK_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define RANGE_LOCK_EOF UINT64_MAX // Length of a range that extends to the end of the file
+
+// A byte range held by a reader or a writer, a node of the interval tree of its file
+typedef struct Range_Lock_Entry
+{
+    uint64_t Start;
+    uint64_t End; // Exclusive
+    int Writer;
+    uint32_t Priority;       // Heap order of the treap
+    uint64_t Max_End;        // Largest End in the subtree
+    uint64_t Max_Writer_End; // Largest End of a writer in the subtree, 0 if it has none
+    struct Range_Lock_Entry *Left;
+    struct Range_Lock_Entry *Right;
+}Range_Lock_Entry;
+
+// Byte range lock of a file, readers of a range share it while writers of a range are exclusive
+// The held ranges are kept in an interval tree (a treap ordered by Start)
+typedef struct Range_Lock
+{
+    pthread_mutex_t Mutex;
+    pthread_cond_t Released;
+    Range_Lock_Entry *Held;
+    uint32_t Seed;    // State of the priority generator
+    int Waiters;      // Threads waiting for a range, releases only broadcast if there are any
+}Range_Lock;
+
+Range_Lock *Range_Lock_Init();
+void Range_Lock_Destroy(Range_Lock *Lock);
+Range_Lock_Entry *Range_Read_Lock(Range_Lock *Lock, uint64_t Offset, uint64_t Length);
+Range_Lock_Entry *Range_Write_Lock(Range_Lock *Lock, uint64_t Offset, uint64_t Length);
+void Range_Unlock(Range_Lock *Lock, Range_Lock_Entry *Entry);
+
+#endif // __RANGE_LOCK_H__
@@ -1,8 +1,12 @@
+#define _GNU_SOURCE // renameat2
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <dirent.h>
@@ -11,8 +15,10 @@
 
 #include "./Headers.h"
 #include "./Trie.h"
+#include "./Worker_Pool.h"
 #include "./ErrorCodes.h"
 #include "../Externals.h"
+#include "../Protocol.h"
 #include "../colour.h"
 
 int NS_Write_Socket;
@@ -164,13 +170,12 @@ int Populate_Trie(Trie *root, char *dir)
 Trie *Initialize_File_Trie()
 {
     // Initialize the trie
-    Trie *root = trie_init();
+    Trie *root = trie_init("Mount");
     if (CheckNull(root, "[-]Initialize_File_Trie: Error in initializing trie"))
     {
         fprintf(Log_File, "[-]Initialize_File_Trie: Error in initializing trie\n");
         return NULL;
     }
-    strcpy(root->path_token, "Mount");
     // Get the cwd
     char cwd[MAX_BUFFER_SIZE];
     if (getcwd(cwd, sizeof(cwd)) == NULL)
@@ -272,7 +277,7 @@ void *NS_Listner_Thread(void *arg)
         REQUEST_STRUCT *NS_Response = &NS_Response_Struct;
 
         // Receive the request from the Name Server
-        int err = recv(NS_Client_Socket, NS_Response, sizeof(RESPONSE_STRUCT), 0);
+        int err = RecvRequest(NS_Client_Socket, NS_Response);
         if (CheckError(err, "[-]NS_Listner_Thread: Error in receiving data from Name Server"))
         {
             fprintf(Log_File, "[-]NS_Listner_Thread: Error in receiving data from Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -297,6 +302,7 @@ void *NS_Listner_Thread(void *arg)
         RESPONSE_STRUCT *NS_Request = &NS_Request_Struct;
         memset(NS_Request, 0, sizeof(RESPONSE_STRUCT));
         NS_Request->iResponseOperation = NS_Response->iRequestOperation;
+        NS_Request->iResponseRequestID = NS_Response->iRequestID;
         NS_Request->iResponseFlags = NS_Response->iRequestFlags;
         NS_Request->iResponseServerID = Server_ID;
 
@@ -332,49 +338,87 @@ void *NS_Listner_Thread(void *arg)
         {
             // resolve the path and rename requested path to new path
             // send an ack to server after completion
+            // (the response data always ends with the client ID, the naming server routes the ack with it)
 
-            char *file_path = NS_Response->sRequestPath;
-            char *new_name = __strtok_r(file_path, " ", &file_path);
+            // Request path is "<Source Path> <New Name>"
+            char *new_name = NULL;
+            char *src_path = __strtok_r(NS_Response->sRequestPath, " ", &new_name);
 
-            int present = trie_search(File_Trie, file_path);
+            // The new name is a single token, anything else would move the file out of its directory
+            if (src_path == NULL || new_name == NULL || new_name[0] == '\0' || strchr(new_name, '/') != NULL ||
+                strcmp(new_name, ".") == 0 || strcmp(new_name, "..") == 0)
+            {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                NS_Request->iResponseErrorCode = ERROR_INVALID_PATH;
+                snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "Invalid New Name %lu", NS_Response->iRequestClientID);
+                printf(RED "[-]NS_Listner_Thread: Invalid New Name\n" CRESET);
+                fprintf(Log_File, "[-]NS_Listner_Thread: Invalid New Name [Time Stamp: %f]\n", GetCurrTime(Clock));
+                break;
+            }
+
+            char file_path[MAX_BUFFER_SIZE];
+            strncpy(file_path, src_path, MAX_BUFFER_SIZE);
+
+            int present = trie_search(File_Trie, file_path); // tokenises file_path
             if (!present)
             {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
                 NS_Request->iResponseErrorCode = ERROR_INVALID_PATH;
-                strncpy(NS_Request->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
+                snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "File Not Found %lu", NS_Response->iRequestClientID);
                 printf(RED "[-]NS_Listner_Thread: File Not Found\n" CRESET);
                 fprintf(Log_File, "[-]NS_Listner_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
                 break;
             }
 
             char path_cpy[MAX_BUFFER_SIZE];
-            strncpy(path_cpy, file_path, MAX_BUFFER_SIZE);
+            strncpy(path_cpy, src_path, MAX_BUFFER_SIZE);
 
-            // Get the corresponding Lock for the file
-            Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, path_cpy);
+            // Take X on the path and IX on the directories above it, the clients working on or below the path
+            // finish first and new ones wait, clients elsewhere are not affected
+            Trie_Path_Lock path_lock;
+            if (trie_lock_path(File_Trie, path_cpy, INTENT_X, &path_lock) == NULL)
+            {
+                trie_unlock_path(&path_lock);
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
+                NS_Request->iResponseErrorCode = ERROR_INVALID_PATH;
+                snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "File Not Found %lu", NS_Response->iRequestClientID);
+                printf(RED "[-]NS_Listner_Thread: File Not Found\n" CRESET);
+                fprintf(Log_File, "[-]NS_Listner_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+                break;
+            }
 
             // Remove first token from the path (Mount)
+            strncpy(path_cpy, src_path, MAX_BUFFER_SIZE);
             char *path = NULL;
             __strtok_r(path_cpy, "/", &path);
 
-            // Update the trie with the new path
-            int err = trie_rename(File_Trie, file_path, new_name);
-            if (err < 0)
+            // The file keeps its directory, only the last token changes
+            char new_path[MAX_BUFFER_SIZE];
+            char *last_slash = strrchr(path, '/');
+            if (last_slash != NULL)
+                snprintf(new_path, MAX_BUFFER_SIZE, "%.*s/%s", (int)(last_slash - path), path, new_name);
+            else
+                snprintf(new_path, MAX_BUFFER_SIZE, "%s", new_name);
+
+            // Rename on disk first (never over an existing file), the trie only follows a rename that happened
+            int err = renameat2(AT_FDCWD, path, AT_FDCWD, new_path, RENAME_NOREPLACE);
+            if (err == 0)
             {
-                NS_Request->iResponseErrorCode = ERROR_INVALID_OPERATION;
-                strncpy(NS_Request->sResponseData, "Error in renaming file", MAX_BUFFER_SIZE);
-                printf(RED "[-]NS_Listner_Thread: Error in renaming file\n" CRESET);
-                fprintf(Log_File, "[-]NS_Listner_Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
-                break;
+                strncpy(file_path, src_path, MAX_BUFFER_SIZE);
+                err = trie_rename(File_Trie, file_path, new_name);
+                if (err < 0 && rename(new_path, path) < 0)
+                {
+                    printf(RED "[-]NS_Listner_Thread: Error in undoing the rename of %s\n" CRESET, path);
+                    fprintf(Log_File, "[-]NS_Listner_Thread: Error in undoing the rename of %s [Time Stamp: %f]\n", path, GetCurrTime(Clock));
+                }
             }
-
-            Write_Lock(lock);
-            err = rename(path, new_name);
-            Write_Unlock(lock);
+            trie_unlock_path(&path_lock);
 
             if (err < 0)
             {
+                NS_Request->iResponseFlags = RESPONSE_FLAG_FAILURE;
                 NS_Request->iResponseErrorCode = ERROR_INVALID_OPERATION;
-                strncpy(NS_Request->sResponseData, "Error in renaming file", MAX_BUFFER_SIZE);
+                snprintf(NS_Request->sResponseData, MAX_BUFFER_SIZE, "Error in renaming file %lu", NS_Response->iRequestClientID);
                 printf(RED "[-]NS_Listner_Thread: Error in renaming file\n" CRESET);
                 fprintf(Log_File, "[-]NS_Listner_Thread: Error in renaming file [Time Stamp: %f]\n", GetCurrTime(Clock));
                 break;
@@ -406,7 +450,7 @@ void *NS_Listner_Thread(void *arg)
         }
 
         // Send the response to the Name Server
-        err = send(NS_Client_Socket, NS_Request, sizeof(RESPONSE_STRUCT), 0);
+        err = SendResponse(NS_Client_Socket, NS_Request);
         if (CheckError(err, "[-]NS_Listner_Thread: Error in sending data to Name Server"))
         {
             fprintf(Log_File, "[-]NS_Listner_Thread: Error in sending data to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -459,75 +503,135 @@ void *Client_Listner_Thread(void *arg)
         exit(EXIT_FAILURE);
     }
 
-    printf("[+]Client_Listner_Thread: Listening for connections on Port: %d\n", ClientPort);
-    fprintf(Log_File, "[+]Client_Listner_Thread: Listening for connections on Port: %d [Time Stamp: %f]\n", ClientPort, GetCurrTime(Clock));
+    // Sessions are served by a fixed set of workers instead of a thread per connection
+    Worker_Pool *Pool = Worker_Pool_Init(SS_WORKER_COUNT);
+    if (CheckNull(Pool, "[-]Client_Listner_Thread: Error in starting the worker pool"))
+    {
+        fprintf(Log_File, "[-]Client_Listner_Thread: Error in starting the worker pool [Time Stamp: %f]\n", GetCurrTime(Clock));
+        exit(EXIT_FAILURE);
+    }
+
+    const char *Engine = Pool->Workers[0].Ring ? "io_uring" : "syscalls";
+    printf("[+]Client_Listner_Thread: Listening for connections on Port: %d (%d workers, %s)\n", ClientPort, Pool->Worker_Count, Engine);
+    fprintf(Log_File, "[+]Client_Listner_Thread: Listening for connections on Port: %d (%d workers, %s) [Time Stamp: %f]\n", ClientPort, Pool->Worker_Count, Engine, GetCurrTime(Clock));
 
     struct sockaddr_in Client_Addr;
     socklen_t Client_Addr_Size = sizeof(Client_Addr);
     int Client_Socket;
-    // Accept connections and handle requests concurrently
+    // Accept connections and hand them to the workers
     while (Client_Socket = accept(Client_Listen_Socket, (struct sockaddr *)&Client_Addr, &Client_Addr_Size))
     {
-        char *client_IP = inet_ntoa(Client_Addr.sin_addr);
-        int client_Port = ntohs(Client_Addr.sin_port);
-
-        Client client;
-        client.socket = Client_Socket;
-        client.IP = client_IP;
-        client.port = client_Port;
-
         if (CheckError(Client_Socket, "[-]Client_Listner_Thread: Error in accepting connections"))
         {
             fprintf(Log_File, "[-]Client_Listner_Thread: Error in accepting connections [Time Stamp: %f]\n", GetCurrTime(Clock));
             exit(EXIT_FAILURE);
         }
 
+        // The pool owns (and frees) the client
+        Client *client = (Client *)malloc(sizeof(Client));
+        if (CheckNull(client, "[-]Client_Listner_Thread: Error in allocating client"))
+        {
+            close(Client_Socket);
+            continue;
+        }
+        client->socket = Client_Socket;
+        strncpy(client->IP, inet_ntoa(Client_Addr.sin_addr), IP_LENGTH - 1);
+        client->IP[IP_LENGTH - 1] = '\0';
+        client->port = ntohs(Client_Addr.sin_port);
+        client->Last_Active = GetCurrTime(Clock);
+        client->Served = 0;
+
         printf(GRN "[+]Client_Listner_Thread: Connection Established with Client\n" CRESET);
         fprintf(Log_File, "[+]Client_Listner_Thread: Connection Established with Client [Time Stamp: %f]\n", GetCurrTime(Clock));
 
-        // Create a thread to handle the request
-        pthread_t Client_Handler;
-        err = pthread_create(&Client_Handler, NULL, Client_Handler_Thread, (void *)&client);
-        if (CheckError(err, "[-]Client_Listner_Thread: Error in creating thread for handling client request"))
-        {
-            fprintf(Log_File, "[-]Client_Listner_Thread: Error in creating thread for handling client request [Time Stamp: %f]\n", GetCurrTime(Clock));
-            exit(EXIT_FAILURE);
-        }
-        fprintf(Log_File, "[+]Client_Listner_Thread: Thread Created for handling client request [Time Stamp: %f]\n", GetCurrTime(Clock));
+        // Blocks while CLIENT_QUEUE_SIZE sessions are already waiting, further connections wait in the backlog
+        Client_Queue_Push(Pool, client);
+        fprintf(Log_File, "[+]Client_Listner_Thread: Session queued for the workers [Time Stamp: %f]\n", GetCurrTime(Clock));
     }
 
     return NULL;
 }
 
 /**
- * @brief Thread to handle requests from the Client.
- * @param arg: The socket to communicate with the client.
- * @return: NULL
+ * @brief Serves the requests of a client session on a worker.
+ * @param worker: The worker serving the session.
+ * @param client: The session (malloced by the listener).
+ * @return: 0 if the session is over (the socket is closed), 1 if it was handed back to the queue
+ * @note: Requests are served one after the other until the client closes the session or stays idle for
+ *        CLIENT_IDLE_TIMEOUT seconds. A quiet session gives up its worker after CLIENT_YIELD_TIMEOUT_MS
+ *        when other sessions are waiting, so a few idle clients can not starve the pool
  */
-void *Client_Handler_Thread(void *arg)
+int Serve_Client_Session(Worker *worker, Client *client)
 {
-    Client client = *(Client *)arg;
-    int Client_Socket = client.socket;
-    char *client_IP = client.IP;
-    int client_Port = client.port;
-
-    // Receive the request from the Client
-    REQUEST_STRUCT Client_Request;
-    REQUEST_STRUCT *Client_Request_Struct = &Client_Request;
-    int err = recv(Client_Socket, Client_Request_Struct, sizeof(REQUEST_STRUCT), 0);
-    if (err < 0)
-    {
-        printf(RED "[-]Client_Handler_Thread: Error in receiving data from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Error in receiving data from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
-        exit(EXIT_FAILURE);
-    }
-    else if (err == 0)
+    int Client_Socket = client->socket;
+    char *client_IP = client->IP;
+    int client_Port = client->port;
+
+    while (1)
     {
-        printf(RED "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return NULL;
+        double Idle = GetCurrTime(Clock) - client->Last_Active;
+        if (Idle >= CLIENT_IDLE_TIMEOUT)
+        {
+            printf(YEL "[-]Serve_Client_Session: Session with Client (IP: %s, Port: %d) idle, closing\n" CRESET, client_IP, client_Port);
+            fprintf(Log_File, "[-]Serve_Client_Session: Session with Client (IP: %s, Port: %d) idle, closing [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
+            break;
+        }
+
+        // Wait for the next request of the session
+        int Waiting = Client_Queue_Waiting(worker->Pool);
+        int Timeout = Waiting ? CLIENT_YIELD_TIMEOUT_MS : (int)((CLIENT_IDLE_TIMEOUT - Idle) * 1000) + 1;
+        struct pollfd Client_Poll = {.fd = Client_Socket, .events = POLLIN};
+        int ready = poll(&Client_Poll, 1, Timeout);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready == 0)
+        {
+            if (Waiting && Client_Queue_Try_Push(worker->Pool, client) == 0)
+                return 1;
+            continue;
+        }
+
+        // Receive the request from the Client
+        REQUEST_STRUCT Client_Request;
+        int err = (ready < 0) ? -1 : RecvRequest(Client_Socket, &Client_Request);
+        if (err < 0)
+        {
+            printf(RED "[-]Serve_Client_Session: Error in receiving data from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
+            fprintf(Log_File, "[-]Serve_Client_Session: Error in receiving data from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
+            break;
+        }
+        else if (err == 0)
+        {
+            printf(GRN "[+]Serve_Client_Session: Client (IP: %s, Port: %d) closed the session after %d requests\n" CRESET, client_IP, client_Port, client->Served);
+            fprintf(Log_File, "[+]Serve_Client_Session: Client (IP: %s, Port: %d) closed the session after %d requests [Time Stamp: %f]\n", client_IP, client_Port, client->Served, GetCurrTime(Clock));
+            break;
+        }
+
+        client->Served++;
+        err = Serve_Client_Request(worker, client, &Client_Request);
+        client->Last_Active = GetCurrTime(Clock);
+        if (err < 0)
+            break;
     }
 
+    close(Client_Socket);
+    return 0;
+}
+
+/**
+ * @brief Serves one request of a client session.
+ * @param worker: The worker serving the session (its buffer and ring are used for the data path).
+ * @param client: The client that sent the request.
+ * @param Client_Request_Struct: The request.
+ * @return: 0 if the session can go on, -1 if the connection is no longer usable
+ */
+int Serve_Client_Request(Worker *worker, Client *client, REQUEST_STRUCT *Client_Request_Struct)
+{
+    unsigned char *Buffer = worker->Buffer;
+    int Client_Socket = client->socket;
+    char *client_IP = client->IP;
+    int client_Port = client->port;
+
     // Print the request received from the Client
     printf(GRN "[+]Client_Handler_Thread: Request Received from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
     fprintf(Log_File, "[+]Client_Handler_Thread: Request Received from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
@@ -540,6 +644,7 @@ void *Client_Handler_Thread(void *arg)
     RESPONSE_STRUCT *Client_Response_Struct = &Client_Response;
     memset(Client_Response_Struct, 0, sizeof(RESPONSE_STRUCT));
     Client_Response_Struct->iResponseOperation = Client_Request_Struct->iRequestOperation;
+    Client_Response_Struct->iResponseRequestID = Client_Request_Struct->iRequestID;
     Client_Response_Struct->iResponseFlags = Client_Request_Struct->iRequestFlags;
     Client_Response_Struct->iResponseServerID = Server_ID;
 
@@ -547,39 +652,38 @@ void *Client_Handler_Thread(void *arg)
     {
     case CMD_READ:
     {
-        // generate a random stop sequence
-        char stop_sequence[MAX_BUFFER_SIZE];
-        memset(stop_sequence, 0, MAX_BUFFER_SIZE);
-        snprintf(stop_sequence, MAX_BUFFER_SIZE, "STOP%d", rand() % 1000);
-
-        // send the stop sequence to the client
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
         // Check if the file is exposed by the server
         char file_path[MAX_BUFFER_SIZE];
         memset(file_path, 0, MAX_BUFFER_SIZE);
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path); // tokenises file_path
         if (!present)
         {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
             fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            printf("%s\n", msg);
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
             break;
         }
 
-        // Get the corresponding Lock for the file
-        Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
+        // Take IS on the directories above the file (a rename of one of them waits for us) and get the lock of the file
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
+        Trie_Path_Lock path_lock;
+        Reader_Writer_Lock *lock = trie_lock_path(File_Trie, file_path, INTENT_IS, &path_lock);
+        if (lock == NULL)
+        {
+            // Renamed or deleted since it was found
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
+            strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
@@ -589,38 +693,104 @@ void *Client_Handler_Thread(void *arg)
         __strtok_r(file_path, "/", &path);
 
         Read_Lock(lock);
-        // Open the file and read it's contents
-        FILE *file = fopen(path, "r");
-        if (CheckNull(file, "[-]Client_Handler_Thread: Error in opening file"))
+        // Open the file and find out how much of it will be streamed
+        int fd = open(path, O_RDONLY);
+        struct stat file_stat;
+        if (CheckError(fd, "[-]Client_Handler_Thread: Error in opening file") || CheckError(fstat(fd, &file_stat), "[-]Client_Handler_Thread: Error in getting file status"))
         {
+            if (fd >= 0)
+                close(fd);
             Read_Unlock(lock);
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
             fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
+        // Work out the range to be sent (the whole file unless a range was requested)
+        int range = (Client_Request_Struct->iRequestFlags == REQUEST_FLAG_RANGE);
+        uint64_t offset = range ? Client_Request_Struct->iRequestOffset : 0;
+        uint64_t length = 0;
+        if (range && (!S_ISREG(file_stat.st_mode) || offset > (uint64_t)file_stat.st_size))
+        {
+            close(fd);
+            Read_Unlock(lock);
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_RANGE;
+            strncpy(Client_Response_Struct->sResponseData, "Invalid Range", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: Invalid Range\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Invalid Range (Offset: %llu) [Time Stamp: %f]\n", (unsigned long long)offset, GetCurrTime(Clock));
             break;
         }
+        if (S_ISREG(file_stat.st_mode))
+        {
+            // A range is clamped to the end of the file
+            length = file_stat.st_size - offset;
+            if (range && Client_Request_Struct->iRequestLength != 0 && Client_Request_Struct->iRequestLength < length)
+                length = Client_Request_Struct->iRequestLength;
+        }
 
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
+        // Positional writers only exclude the bytes being read
+        Range_Lock_Entry *read_range = Range_Read_Lock(lock->Ranges, offset, S_ISREG(file_stat.st_mode) ? length : RANGE_LOCK_EOF);
+        if (read_range == NULL)
+        {
+            close(fd);
+            Read_Unlock(lock);
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_OPERATION;
+            strncpy(Client_Response_Struct->sResponseData, "Error in locking file", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: Error in locking file\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Error in locking file [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
-        while (fread(buffer, 1, MAX_BUFFER_SIZE, file) > 0)
+        // Negotiate the chunk size and start the stream
+        uint32_t chunk_size = NegotiateChunkSize(Client_Request_Struct->iRequestChunkSize);
+        int stream_err, err = 0;
+        if (S_ISREG(file_stat.st_mode))
+        {
+            // Regular files are read and framed on the worker's ring (sendfile without one)
+            stream_err = SendStreamStart(Client_Socket, CMD_READ, chunk_size, length);
+            if (stream_err >= 0)
+            {
+                int64_t sent = Uring_Send_File(worker->Ring, Client_Socket, CMD_READ, fd, offset, length, chunk_size);
+                if (sent < 0)
+                    stream_err = -1;
+                else if ((uint64_t)sent != length)
+                    err = 1; // The file was truncated while it was sent
+            }
+        }
+        else
         {
-            send(Client_Socket, buffer, MAX_BUFFER_SIZE, 0);
-            memset(buffer, 0, MAX_BUFFER_SIZE);
+            // Length is not known upfront (FIFOs and the like), stream until EOF through the worker's buffer
+            stream_err = SendStreamStart(Client_Socket, CMD_READ, chunk_size, STREAM_LENGTH_UNKNOWN);
+
+            ssize_t readSize = 0;
+            while (stream_err >= 0 && (readSize = read(fd, Buffer, chunk_size)) > 0)
+                stream_err = SendChunk(Client_Socket, CMD_READ, Buffer, readSize);
+            if (readSize < 0)
+                err = 1;
         }
 
+        Range_Unlock(lock->Ranges, read_range);
         Read_Unlock(lock);
-        // send the stop sequence to the client to indicate end of file
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
+        trie_unlock_path(&path_lock);
+        close(fd);
+
+        if (stream_err < 0)
+        {
+            printf(RED "[-]Client_Handler_Thread: Error in streaming file to Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Error in streaming file to Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
+            return -1;
+        }
 
-        int err = ferror(file);
+        // send the end of stream frame (carries the error if the file could not be read completely)
+        SendStreamEnd(Client_Socket, CMD_READ, err ? ERROR_INVALID_ACCESS : 0);
         if (err)
         {
             Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
@@ -636,13 +806,15 @@ void *Client_Handler_Thread(void *arg)
 
         printf(GRN "[+]Client_Handler_Thread: File Read Successfully\n" CRESET);
         fprintf(Log_File, "[+]Client_Handler_Thread: File Read Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+        break;
     }
     case CMD_WRITE:
     {
         // parse the write flag
         int write_flag = Client_Request_Struct->iRequestFlags;
-        if (write_flag != REQUEST_FLAG_APPEND && write_flag != REQUEST_FLAG_OVERWRITE)
+        if (write_flag != REQUEST_FLAG_APPEND && write_flag != REQUEST_FLAG_OVERWRITE && write_flag != REQUEST_FLAG_POSITIONAL)
         {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_FLAG;
             strncpy(Client_Response_Struct->sResponseData, "Invalid Write Flag", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: Invalid Write Flag\n" CRESET);
@@ -650,39 +822,38 @@ void *Client_Handler_Thread(void *arg)
             break;
         }
 
-        // generate a random stop sequence
-        char stop_sequence[MAX_BUFFER_SIZE];
-        memset(stop_sequence, 0, MAX_BUFFER_SIZE);
-        snprintf(stop_sequence, MAX_BUFFER_SIZE, "STOP%d", rand() % 1000);
-
-        // send the stop sequence to the client
-        send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
         // Check if the file is exposed by the server
         char file_path[MAX_BUFFER_SIZE];
         memset(file_path, 0, MAX_BUFFER_SIZE);
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path); // tokenises file_path
         if (!present)
         {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
             fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Fetching File" reset "\n";
-            printf("%s\n", msg);
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
             break;
         }
 
-        // Get the corresponding Lock for the file
-        Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
+        // Take IX on the directories above the file (a rename of one of them waits for us) and get the lock of the file
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
+        Trie_Path_Lock path_lock;
+        Reader_Writer_Lock *lock = trie_lock_path(File_Trie, file_path, INTENT_IX, &path_lock);
+        if (lock == NULL)
+        {
+            // Renamed or deleted since it was found
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
+            strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
@@ -691,45 +862,100 @@ void *Client_Handler_Thread(void *arg)
         char *path = NULL;
         __strtok_r(file_path, "/", &path);
 
-        // Open the file and write to it with the specified flag
-        char *mode = (write_flag == REQUEST_FLAG_OVERWRITE) ? "w" : "a";
+        // Open the file with the specified flag
+        int positional = (write_flag == REQUEST_FLAG_POSITIONAL);
+        int open_flags = O_WRONLY | (positional ? 0 : O_CREAT) | ((write_flag == REQUEST_FLAG_OVERWRITE) ? O_TRUNC : 0);
+
+        // A positional write only excludes the byte range it patches (writers of disjoint ranges run in parallel),
+        // appends and overwrites change the whole file and take the file wide lock
+        Range_Lock_Entry *range = NULL;
+        off_t offset;
+        if (positional)
+        {
+            Read_Lock(lock);
+            range = Range_Write_Lock(lock->Ranges, Client_Request_Struct->iRequestOffset, Client_Request_Struct->iRequestLength);
+            offset = (off_t)Client_Request_Struct->iRequestOffset;
+        }
+        else
+            Write_Lock(lock);
+        if (positional && range == NULL)
+        {
+            Read_Unlock(lock);
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_OPERATION;
+            strncpy(Client_Response_Struct->sResponseData, "Error in locking file", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: Error in locking file\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Error in locking file [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
-        Write_Lock(lock);
-        FILE *file = fopen(path, mode);
-        if (CheckNull(file, "[-]Client_Handler_Thread: Error in opening file"))
+        int fd = open(path, open_flags, 0644);
+        if (!positional)
+            offset = (fd >= 0) ? lseek(fd, 0, SEEK_END) : -1; // appends write at the end of the file found under the lock
+        if (CheckError(fd, "[-]Client_Handler_Thread: Error in opening file") || CheckError(offset, "[-]Client_Handler_Thread: Error in seeking file"))
         {
+            if (fd >= 0)
+                close(fd);
+            if (positional)
+            {
+                Range_Unlock(lock->Ranges, range);
+                Read_Unlock(lock);
+            }
+            else
+                Write_Unlock(lock);
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
             fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
-
-            // send a error buffer to indicate file not found
-            char msg[] = RED "Error Opening File" reset "\n";
-            send(Client_Socket, &msg, sizeof(msg), 0);
-            send(Client_Socket, stop_sequence, MAX_BUFFER_SIZE, 0);
-
             break;
         }
 
-        char buffer[MAX_BUFFER_SIZE];
-        memset(buffer, 0, MAX_BUFFER_SIZE);
+        // Negotiate the chunk size and ask the client to start streaming
+        uint32_t chunk_size = NegotiateChunkSize(Client_Request_Struct->iRequestChunkSize);
+        int stream_err = SendStreamStart(Client_Socket, CMD_WRITE, chunk_size, STREAM_LENGTH_UNKNOWN);
+
+        // receive the file contents from the client (through the worker's ring, spliced without one) until the end of stream frame
+        int client_err = 0, err = 0;
+        int64_t totalSize = 0;
+        uint64_t limit = positional ? Client_Request_Struct->iRequestLength : STREAM_LENGTH_UNKNOWN;
+        if (stream_err >= 0)
+            totalSize = Uring_Recv_To_File(worker->Ring, Client_Socket, fd, offset, chunk_size, limit, &client_err, &err, Buffer);
 
-        // receive the file contents from the client
-        while (recv(Client_Socket, buffer, MAX_BUFFER_SIZE, 0) > 0)
+        if (positional)
         {
-            // check if the stop sequence is received
-            if (strncmp(buffer, stop_sequence, MAX_BUFFER_SIZE) == 0)
-                break;
+            Range_Unlock(lock->Ranges, range);
+            Read_Unlock(lock);
+        }
+        else
+            Write_Unlock(lock);
+        trie_unlock_path(&path_lock);
+        close(fd);
 
-            size_t writeSize = fwrite(buffer, 1, strlen(buffer), file);
-            printf("Writing %ld bytes to file\n", writeSize);
-            fprintf(Log_File, "Writing %ld bytes to file\n", writeSize);
-            memset(buffer, 0, MAX_BUFFER_SIZE);
+        if (stream_err < 0 || totalSize < 0)
+        {
+            printf(RED "[-]Client_Handler_Thread: Error in receiving file from Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Error in receiving file from Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
+            return -1;
         }
 
-        Write_Unlock(lock);
-        int err = ferror(file);
-        if (err)
+        printf("Wrote %lld bytes to file\n", (long long)totalSize);
+        fprintf(Log_File, "Wrote %lld bytes to file [Time Stamp: %f]\n", (long long)totalSize, GetCurrTime(Clock));
+
+        if (positional && !err && !client_err && (uint64_t)totalSize != limit)
+            err = EFBIG; // The client sent less than the range it locked
+        if (err == EFBIG)
+        {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_RANGE;
+            strncpy(Client_Response_Struct->sResponseData, "Data does not match the range", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: Data does not match the range\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Data does not match the range [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
+        if (err || client_err)
         {
             Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_ACCESS;
@@ -739,8 +965,6 @@ void *Client_Handler_Thread(void *arg)
             break;
         }
 
-        fclose(file);
-
         Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
         strncpy(Client_Response_Struct->sResponseData, "File Written Successfully", MAX_BUFFER_SIZE);
 
@@ -756,9 +980,10 @@ void *Client_Handler_Thread(void *arg)
 
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
 
-        int present = trie_search(File_Trie, Client_Request_Struct->sRequestPath);
+        int present = trie_search(File_Trie, file_path); // tokenises file_path
         if (!present)
         {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
@@ -766,8 +991,21 @@ void *Client_Handler_Thread(void *arg)
             break;
         }
 
-        // Get the corresponding Lock for the file
-        Reader_Writer_Lock *lock = trie_get_path_lock(File_Trie, file_path);
+        // Take IS on the directories above the file (a rename of one of them waits for us) and get the lock of the file
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
+        Trie_Path_Lock path_lock;
+        Reader_Writer_Lock *lock = trie_lock_path(File_Trie, file_path, INTENT_IS, &path_lock);
+        if (lock == NULL)
+        {
+            // Renamed or deleted since it was found
+            trie_unlock_path(&path_lock);
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
+            strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: File Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
 
         memset(file_path, 0, MAX_BUFFER_SIZE);
         strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
@@ -783,11 +1021,13 @@ void *Client_Handler_Thread(void *arg)
         Read_Lock(lock);
         // Check if path is a file, executable or a directory
         struct stat file_stat;
-        int err = stat(path, &file_stat);
+        int err = Uring_Stat(worker->Ring, path, &file_stat);
         Read_Unlock(lock);
+        trie_unlock_path(&path_lock);
 
         if (err < 0)
         {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
             Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
             strncpy(Client_Response_Struct->sResponseData, "File Not Found", MAX_BUFFER_SIZE);
             printf(RED "[-]Client_Handler_Thread: File Not Found\n" CRESET);
@@ -799,7 +1039,7 @@ void *Client_Handler_Thread(void *arg)
         Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
         strncpy(Client_Response_Struct->sResponseData, "File Info Fetched Successfully", MAX_BUFFER_SIZE);
 
-        send(Client_Socket, Client_Response_Struct, sizeof(RESPONSE_STRUCT), 0);
+        SendResponse(Client_Socket, Client_Response_Struct);
 
         // Populate Info Struct
         strncpy(info_struct->sPath, path, MAX_BUFFER_SIZE);
@@ -812,18 +1052,39 @@ void *Client_Handler_Thread(void *arg)
         info_struct->iPathLinks = file_stat.st_nlink;
 
         // send the info struct to the client
-        send(Client_Socket, info_struct, sizeof(PATH_INFO_STRUCT), 0);
+        SendPathInfo(Client_Socket, info_struct);
 
         printf(GRN "[+]Client_Handler_Thread: File Info Fetched Successfully\n" CRESET);
         fprintf(Log_File, "[+]Client_Handler_Thread: File Info Fetched Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
 
-        return NULL;
+        return 0;
+    }
+    case CMD_LIST:
+    {
+        // The naming server only knows the export points, listings below them are served here
+        char file_path[MAX_BUFFER_SIZE];
+        strncpy(file_path, Client_Request_Struct->sRequestPath, MAX_BUFFER_SIZE);
+
+        if (trie_list(File_Trie, file_path, Client_Response_Struct->sResponseData) < 0) // tokenises file_path
+        {
+            Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_FAILURE;
+            Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_PATH;
+            strncpy(Client_Response_Struct->sResponseData, "Path Not Found", MAX_BUFFER_SIZE);
+            printf(RED "[-]Client_Handler_Thread: Path Not Found\n" CRESET);
+            fprintf(Log_File, "[-]Client_Handler_Thread: Path Not Found [Time Stamp: %f]\n", GetCurrTime(Clock));
+            break;
+        }
+
+        Client_Response_Struct->iResponseFlags = RESPONSE_FLAG_SUCCESS;
+        Client_Response_Struct->iResponseErrorCode = ERROR_CODE_SUCCESS;
+        printf(GRN "[+]Client_Handler_Thread: Directory Listed Successfully\n" CRESET);
+        fprintf(Log_File, "[+]Client_Handler_Thread: Directory Listed Successfully [Time Stamp: %f]\n", GetCurrTime(Clock));
+        break;
     }
     case CMD_CREATE:
     case CMD_DELETE:
     case CMD_COPY:
     case CMD_RENAME:
-    case CMD_LIST:
     case CMD_MOVE:
     {
         Client_Response_Struct->iResponseErrorCode = ERROR_INVALID_AUTHENTICATION;
@@ -844,24 +1105,18 @@ void *Client_Handler_Thread(void *arg)
     }
 
     // Send the response to the Client
-    err = send(Client_Socket, Client_Response_Struct, sizeof(RESPONSE_STRUCT), 0);
+    int err = SendResponse(Client_Socket, Client_Response_Struct);
     if (err < 0)
     {
         printf(RED "[-]Client_Handler_Thread: Error in sending data to Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
         fprintf(Log_File, "[-]Client_Handler_Thread: Error in sending data to Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
-        exit(EXIT_FAILURE);
-    }
-    else if (err == 0)
-    {
-        printf(RED "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly\n" CRESET);
-        fprintf(Log_File, "[-]Client_Handler_Thread: Connection with Client Closed Unexpectedly [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return NULL;
+        return -1;
     }
 
     printf(GRN "[+]Client_Handler_Thread: Response Sent to Client (IP: %s, Port: %d)\n" CRESET, client_IP, client_Port);
     fprintf(Log_File, "[+]Client_Handler_Thread: Response Sent to Client (IP: %s, Port: %d) [Time Stamp: %f]\n", client_IP, client_Port, GetCurrTime(Clock));
 
-    return NULL;
+    return 0;
 }
 
 /**
@@ -886,6 +1141,9 @@ void *Log_Flusher_Thread()
             exit(EXIT_FAILURE);
         }
         fprintf(Log_File, "%s\n", buffer);
+        uint64_t Waits, Wait_Ns;
+        RW_Lock_Totals(&Waits, &Wait_Ns);
+        fprintf(Log_File, "[+]Log_Flusher_Thread: File locks waited %lu times for %f seconds in total [Time Stamp: %f]\n", (unsigned long)Waits, Wait_Ns / 1e9, GetCurrTime(Clock));
         fprintf(Log_File, "------------------------------------------------------------\n");
 
         fflush(Log_File);
@@ -990,7 +1248,8 @@ int main()
     SS_Init_Struct->sServerPort_NServer = NSPort;
     char root_path[MAX_BUFFER_SIZE] = "./";
     memset(SS_Init_Struct->MountPaths, 0, MAX_BUFFER_SIZE);
-    err = trie_paths(File_Trie, SS_Init_Struct->MountPaths, root_path);
+    // Only the export points are registered, the naming server resolves the files below them to this server
+    err = trie_exports(File_Trie, SS_Init_Struct->MountPaths, root_path);
     if (CheckError(err, "[-]main: Error in getting mount paths"))
     {
         fprintf(Log_File, "[-]main: Error in getting mount paths [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -999,8 +1258,8 @@ int main()
 
     // printf("[+]main: Sent Mounted Paths: \n%s\n", SS_Init_Struct->MountPaths);
 
-    err = send(NS_Write_Socket, SS_Init_Struct, sizeof(STORAGE_SERVER_INIT_STRUCT), 0);
-    if (err != sizeof(STORAGE_SERVER_INIT_STRUCT))
+    err = SendInit(NS_Write_Socket, SS_Init_Struct);
+    if (err < 0)
     {
         fprintf(Log_File, "[-]main: Error in sending data to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
         exit(EXIT_FAILURE);
@@ -1008,7 +1267,7 @@ int main()
     fprintf(Log_File, "[+]Initialization Packet Sent to Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
 
     // receive the Server ID from the Name Server
-    err = recv(NS_Write_Socket, &Server_ID, sizeof(unsigned long), 0);
+    err = RecvID(NS_Write_Socket, &Server_ID);
     if (CheckError(err, "[-]main: Error in receiving data from Name Server"))
     {
         fprintf(Log_File, "[-]main: Error in receiving data from Name Server [Time Stamp: %f]\n", GetCurrTime(Clock));
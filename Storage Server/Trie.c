@@ -1,74 +1,453 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "./Trie.h"
 #include "./Headers.h"
+#include "./Epoch.h"
 #include "../Externals.h"
 
-#define PRIME 31
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+/*
+PHASE FAIR READER/WRITER LOCK
+    1. Readers enter by adding RW_READER to Reader_In and leave by adding it to Reader_Out, the
+       low bits of Reader_In are set while a writer holds (or waits for) the lock
+    2. A reader that finds the writer bits set waits only for that writer, readers that arrived
+       during a write phase are let in before the next writer, so writers can not starve readers
+    3. Readers arriving after a writer sets its bits wait for it, so readers can not starve writers
+    4. Writers queue on tickets (Writer_In, Writer_Out) and are served in order
+    5. Threads sleep on a futex of the word they wait on, unlocks only enter the kernel if
+       someone may be sleeping
+*/
+
+#define RW_WRITER 0x1u        // A writer holds or waits for the lock
+#define RW_PHASE 0x2u         // Parity of the writer ticket, tells consecutive write phases apart
+#define RW_WRITER_BITS 0xffu
+#define RW_READER 0x100u
+#define RW_SPIN_YIELDS 4 // Times a waiter yields the cpu before it sleeps
+
+static uint64_t Total_Waits = 0; // Acquisitions of any lock that had to sleep
+static uint64_t Total_Wait_Ns = 0;
+
+static void Futex_Wait(uint32_t *Word, uint32_t Expected)
+{
+    // Critical sections are short, give the holder a chance to finish before sleeping
+    for (int i = 0; i < RW_SPIN_YIELDS; i++)
+    {
+        sched_yield();
+        if (__atomic_load_n(Word, __ATOMIC_SEQ_CST) != Expected)
+        {
+            return;
+        }
+    }
+    // Returns at once if the word no longer holds the expected value
+    syscall(SYS_futex, Word, FUTEX_WAIT_PRIVATE, Expected, NULL, NULL, 0);
+}
+
+static void Futex_Wake_All(uint32_t *Word)
+{
+    syscall(SYS_futex, Word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static uint64_t Now_Ns()
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (uint64_t)Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+}
+
+static void Count_Wait(uint64_t *Waits, uint64_t *Wait_Ns, uint64_t Waited)
+{
+    __atomic_fetch_add(Waits, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(Wait_Ns, Waited, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&Total_Waits, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&Total_Wait_Ns, Waited, __ATOMIC_RELAXED);
+}
+
 /**
  * @brief Initializes a Reader_Writer_Lock Object
  * @param None
  * @return a pointer to Reader_Writer_Lock_Object
- * @note the lock maintains a service queue to prevent starvation
+ * @note the lock is phase fair to prevent starvation of readers and writers
  */
 Reader_Writer_Lock *RW_Lock_Init()
 {
-    Reader_Writer_Lock *Lock = (Reader_Writer_Lock *)malloc(sizeof(Reader_Writer_Lock));
-    Lock->Reader_Count = 0;
-    pthread_mutex_init(&Lock->Service_Q_Lock, NULL);
-    pthread_mutex_init(&Lock->Read_Init_Lock, NULL);
-    pthread_mutex_init(&Lock->Write_Lock, NULL);
+    Reader_Writer_Lock *Lock = (Reader_Writer_Lock *)calloc(1, sizeof(Reader_Writer_Lock));
+    if (Lock == NULL)
+    {
+        return NULL;
+    }
+    Lock->Ranges = Range_Lock_Init();
+    if (Lock->Ranges == NULL)
+    {
+        free(Lock);
+        return NULL;
+    }
 
     return Lock;
 }
+
+/**
+ * @brief Destroys a Reader_Writer_Lock Object
+ * @param Lock the lock (not held and nobody waiting)
+ */
+void RW_Lock_Destroy(Reader_Writer_Lock *Lock)
+{
+    if (Lock == NULL)
+    {
+        return;
+    }
+    Range_Lock_Destroy(Lock->Ranges);
+    free(Lock);
+}
 // Reader Accquire Lock
 void Read_Lock(Reader_Writer_Lock *Lock)
 {
-    pthread_mutex_lock(&Lock->Service_Q_Lock);
-    pthread_mutex_lock(&Lock->Read_Init_Lock);
-    Lock->Reader_Count++;
-    if (Lock->Reader_Count == 1)
+    uint32_t Seen = __atomic_fetch_add(&Lock->Reader_In, RW_READER, __ATOMIC_SEQ_CST);
+    uint32_t Writer = Seen & RW_WRITER_BITS;
+    if (Writer == 0)
     {
-        pthread_mutex_lock(&Lock->Write_Lock);
+        return;
     }
-    pthread_mutex_unlock(&Lock->Read_Init_Lock);
-    pthread_mutex_unlock(&Lock->Service_Q_Lock);
+
+    // Wait for the write phase that was on when we arrived to end
+    uint64_t Start = Now_Ns();
+    while (((Seen = __atomic_load_n(&Lock->Reader_In, __ATOMIC_SEQ_CST)) & RW_WRITER_BITS) == Writer)
+    {
+        Futex_Wait(&Lock->Reader_In, Seen);
+    }
+    Count_Wait(&Lock->Read_Waits, &Lock->Read_Wait_Ns, Now_Ns() - Start);
 }
 // Reader Release Lock
 void Read_Unlock(Reader_Writer_Lock *Lock)
 {
-    pthread_mutex_lock(&Lock->Read_Init_Lock);
-    Lock->Reader_Count--;
-    if (Lock->Reader_Count == 0)
+    __atomic_fetch_add(&Lock->Reader_Out, RW_READER, __ATOMIC_SEQ_CST);
+    // A writer sets its bits before it sleeps on Reader_Out
+    if (__atomic_load_n(&Lock->Reader_In, __ATOMIC_SEQ_CST) & RW_WRITER)
     {
-        pthread_mutex_unlock(&Lock->Write_Lock);
+        Futex_Wake_All(&Lock->Reader_Out);
     }
-    pthread_mutex_unlock(&Lock->Read_Init_Lock);
 }
 // Writer Accquire Lock
 void Write_Lock(Reader_Writer_Lock *Lock)
 {
-    pthread_mutex_lock(&Lock->Service_Q_Lock);
-    pthread_mutex_lock(&Lock->Write_Lock);
-    pthread_mutex_unlock(&Lock->Service_Q_Lock);
+    uint64_t Start = 0;
+    uint32_t Ticket = __atomic_fetch_add(&Lock->Writer_In, 1, __ATOMIC_SEQ_CST);
+    uint32_t Serving;
+    while ((Serving = __atomic_load_n(&Lock->Writer_Out, __ATOMIC_SEQ_CST)) != Ticket)
+    {
+        if (Start == 0)
+        {
+            Start = Now_Ns();
+        }
+        Futex_Wait(&Lock->Writer_Out, Serving);
+    }
+
+    // Stop new readers, then wait for the ones already in to leave
+    uint32_t Readers = __atomic_fetch_add(&Lock->Reader_In, RW_WRITER | (Ticket & 1 ? RW_PHASE : 0), __ATOMIC_SEQ_CST);
+    uint32_t Left;
+    while ((Left = __atomic_load_n(&Lock->Reader_Out, __ATOMIC_SEQ_CST)) != Readers)
+    {
+        if (Start == 0)
+        {
+            Start = Now_Ns();
+        }
+        Futex_Wait(&Lock->Reader_Out, Left);
+    }
+    if (Start != 0)
+    {
+        Count_Wait(&Lock->Write_Waits, &Lock->Write_Wait_Ns, Now_Ns() - Start);
+    }
 }
-// Writer Release Lock
+// Writer Release Lock (may be called by another thread than the one that locked it)
 void Write_Unlock(Reader_Writer_Lock *Lock)
 {
-    pthread_mutex_unlock(&Lock->Write_Lock);
+    // No reader is in, any reader counted in Reader_In beyond Reader_Out arrived during the write phase
+    uint32_t Readers = __atomic_fetch_and(&Lock->Reader_In, ~RW_WRITER_BITS, __ATOMIC_SEQ_CST) & ~RW_WRITER_BITS;
+    if (Readers != __atomic_load_n(&Lock->Reader_Out, __ATOMIC_SEQ_CST))
+    {
+        Futex_Wake_All(&Lock->Reader_In);
+    }
+
+    uint32_t Next = __atomic_add_fetch(&Lock->Writer_Out, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&Lock->Writer_In, __ATOMIC_SEQ_CST) != Next)
+    {
+        Futex_Wake_All(&Lock->Writer_Out);
+    }
+}
+
+/**
+ * @brief Gets the wait counters of all locks
+ * @param Waits set to the number of acquisitions that had to wait
+ * @param Wait_Ns set to the total time they waited in ns
+ */
+void RW_Lock_Totals(uint64_t *Waits, uint64_t *Wait_Ns)
+{
+    *Waits = __atomic_load_n(&Total_Waits, __ATOMIC_RELAXED);
+    *Wait_Ns = __atomic_load_n(&Total_Wait_Ns, __ATOMIC_RELAXED);
+}
+
+unsigned int hash(const char *path_token)
+{
+    // FNV-1a over the whole token, the child tables mask it to their size
+    uint32_t hash = FNV_OFFSET;
+    for (const unsigned char *c = (const unsigned char *)path_token; *c; c++)
+    {
+        hash ^= *c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+CHILD TABLES
+    1. A directory starts with no table, and moves through a packed array of TRIE_NODE_4 and
+       TRIE_NODE_16 children (scanned, comparing the hash before the name) to open addressing
+       tables of TRIE_NODE_64, TRIE_NODE_256 and then doubling slots, kept at most 3/4 full
+    2. Names are compared in full, two names with the same hash are two children
+    3. Lookups take no lock, they read inside an epoch (Epoch.h) and check the Version of the
+       node (a seqlock) before and after probing its table, retrying if a writer got in between
+    4. Writers hold the node's Write_Lock and make the Version odd while they change its table,
+       a resized table is published as a whole and the old one (like a replaced name)
+       is retired to be freed once no reader can still see it
+*/
+
+/**
+ * @brief Returns the table size for a number of children
+ * @param count the number of children
+ * @return the smallest table that holds them
+ */
+uint32_t trie_children_capacity(uint32_t count)
+{
+    if (count == 0)
+        return 0;
+    if (count <= TRIE_NODE_4)
+        return TRIE_NODE_4;
+    if (count <= TRIE_NODE_16)
+        return TRIE_NODE_16;
+    uint32_t capacity = TRIE_NODE_64;
+    while (count * 4 > capacity * 3)
+        capacity = capacity < TRIE_NODE_256 ? TRIE_NODE_256 : capacity * 2;
+    return capacity;
+}
+
+/**
+ * @brief Starts a change to the table of a node (Write_Lock held)
+ */
+void trie_write_begin(Trie *node)
+{
+    __atomic_store_n(&node->Version, node->Version + 1, __ATOMIC_RELAXED);
+    // The odd version must be visible before any change to the table
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ends a change to the table of a node (Write_Lock held)
+ */
+void trie_write_end(Trie *node)
+{
+    __atomic_store_n(&node->Version, node->Version + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Probes a child table for a name
+ * @param table the table (may be NULL)
+ * @param path_token the name
+ * @param token_hash the hash of the name
+ * @return the child, NULL if it is not in the table
+ * @note the table may be changing, the caller validates the result with the node's Version
+ */
+Trie *trie_probe(Trie_Children *table, const char *path_token, uint32_t token_hash)
+{
+    if (table == NULL)
+        return NULL;
+
+    uint32_t mask = table->Capacity - 1;
+    uint32_t i = table->Capacity <= TRIE_NODE_16 ? 0 : token_hash & mask;
+    for (uint32_t probes = 0; probes < table->Capacity; probes++, i = (i + 1) & mask)
+    {
+        Trie *child = __atomic_load_n(&table->Slots[i], __ATOMIC_ACQUIRE);
+        if (child == NULL)
+            return NULL;
+        if (__atomic_load_n(&child->token_hash, __ATOMIC_RELAXED) == token_hash &&
+            strcmp(__atomic_load_n(&child->path_token, __ATOMIC_ACQUIRE), path_token) == 0)
+            return child;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the child of a node with the given name
+ * @param node the node
+ * @param path_token the name of the child
+ * @return the child, NULL if the node has no such child
+ * @note takes no lock, called inside an epoch (Epoch_Enter), the child stays valid until Epoch_Exit
+ */
+Trie *trie_child(Trie *node, const char *path_token)
+{
+    uint32_t token_hash = hash(path_token);
+    while (1)
+    {
+        uint32_t Version = __atomic_load_n(&node->Version, __ATOMIC_ACQUIRE);
+        if (Version & 1)
+        {
+            // A writer is changing the table
+            sched_yield();
+            continue;
+        }
+
+        Trie *child = trie_probe(__atomic_load_n(&node->children, __ATOMIC_ACQUIRE), path_token, token_hash);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&node->Version, __ATOMIC_RELAXED) == Version)
+            return child;
+    }
+}
+
+/**
+ * @brief Places a child in a table (the name must not be in it and the table must have room)
+ */
+void trie_place_child(Trie_Children *table, Trie *child)
+{
+    uint32_t i = table->Count;
+    if (table->Capacity > TRIE_NODE_16)
+    {
+        uint32_t mask = table->Capacity - 1;
+        for (i = child->token_hash & mask; table->Slots[i] != NULL; i = (i + 1) & mask)
+            ;
+    }
+    __atomic_store_n(&table->Slots[i], child, __ATOMIC_RELEASE);
+    table->Count++;
 }
 
-unsigned int hash(char *path_token)
+/**
+ * @brief Moves the children of a node to a table of another size
+ * @param node the node (in a write section)
+ * @param capacity the new table size (from trie_children_capacity)
+ * @return 0 on success, -1 on failure
+ */
+int trie_resize_children(Trie *node, uint32_t capacity)
 {
-    int hash = 0;
-    for (int i = 0; i < strlen(path_token); i++)
+    Trie_Children *table = NULL;
+    if (capacity > 0)
+    {
+        table = (Trie_Children *)calloc(1, sizeof(Trie_Children) + capacity * sizeof(Trie *));
+        if (CheckNull(table, "trie_resize_children: Error allocating child table"))
+            return -1;
+        table->Capacity = capacity;
+    }
+
+    Trie_Children *old = node->children;
+    for (uint32_t i = 0; old != NULL && i < old->Capacity; i++)
     {
-        // Use polynomial rolling hash function
-        hash = (hash * PRIME + path_token[i]) % MAX_SUB_FILES;
+        if (old->Slots[i] != NULL)
+            trie_place_child(table, old->Slots[i]);
     }
-    return hash % MAX_SUB_FILES;
+
+    // Readers still probing the old table keep it until their epoch ends
+    __atomic_store_n(&node->children, table, __ATOMIC_RELEASE);
+    Epoch_Retire(old, free);
+    return 0;
+}
+
+/**
+ * @brief Adds a child to a node, growing its table if needed
+ * @param node the node (in a write section)
+ * @param child the child (its name must not be a child of the node)
+ * @return 0 on success, -1 on failure
+ */
+int trie_add_child(Trie *node, Trie *child)
+{
+    uint32_t count = node->children == NULL ? 0 : node->children->Count;
+    uint32_t capacity = trie_children_capacity(count + 1);
+    if ((node->children == NULL || capacity > node->children->Capacity) && trie_resize_children(node, capacity) < 0)
+        return -1;
+    trie_place_child(node->children, child);
+    return 0;
+}
+
+/**
+ * @brief Removes a child from a node
+ * @param node the node (in a write section)
+ * @param child the child
+ * @return 0 on success, -1 if it is not a child of the node
+ */
+int trie_remove_child(Trie *node, Trie *child)
+{
+    Trie_Children *table = node->children;
+    if (table == NULL)
+        return -1;
+
+    uint32_t i = 0;
+    uint32_t hole;
+    if (table->Capacity <= TRIE_NODE_16)
+    {
+        while (i < table->Count && table->Slots[i] != child)
+            i++;
+        if (i == table->Count)
+            return -1;
+        // Keep the array packed
+        __atomic_store_n(&table->Slots[i], table->Slots[table->Count - 1], __ATOMIC_RELEASE);
+        hole = table->Count - 1;
+    }
+    else
+    {
+        uint32_t mask = table->Capacity - 1;
+        for (i = child->token_hash & mask; table->Slots[i] != child; i = (i + 1) & mask)
+        {
+            if (table->Slots[i] == NULL)
+                return -1;
+        }
+        // Shift back the entries of the probe run so lookups never stop early
+        hole = i;
+        for (uint32_t j = (hole + 1) & mask; table->Slots[j] != NULL; j = (j + 1) & mask)
+        {
+            uint32_t home = table->Slots[j]->token_hash & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask))
+            {
+                __atomic_store_n(&table->Slots[hole], table->Slots[j], __ATOMIC_RELEASE);
+                hole = j;
+            }
+        }
+    }
+    __atomic_store_n(&table->Slots[hole], NULL, __ATOMIC_RELEASE);
+    table->Count--;
+    return 0;
+}
+
+/**
+ * @brief Walks to the node of a path
+ * @param file_trie the trie
+ * @param path the path (first token is the cwd, tokenised)
+ * @param parent set to the parent of the node (NULL for the root), may be NULL
+ * @return the node, NULL if the path is not in the trie
+ * @note called inside an epoch, the nodes stay valid until Epoch_Exit
+ */
+Trie *trie_walk(Trie *file_trie, char *path, Trie **parent)
+{
+    char *save = NULL;
+    char *path_token = strtok_r(path, "/", &save);
+    // Ignore the first token as it is the cwd
+    path_token = strtok_r(NULL, "/", &save);
+
+    Trie *curr = file_trie;
+    Trie *prev = NULL;
+    while (path_token != NULL && curr != NULL)
+    {
+        prev = curr;
+        curr = trie_child(curr, path_token);
+        path_token = strtok_r(NULL, "/", &save);
+    }
+    if (parent != NULL)
+        *parent = prev;
+    return curr;
 }
 
 /**
@@ -77,7 +456,7 @@ unsigned int hash(char *path_token)
  * @param buffer the buffer to be printed to
  * @param cur_dir the current directory path
  * @return 0 on success, -1 on failure
- * @note This function is called as a subroutine of trie_paths
+ * @note This function is called as a subroutine of trie_paths (inside an epoch)
  */
 int trie_paths_helper(Trie *file_trie, char *buffer, char *cur_dir)
 {
@@ -92,19 +471,19 @@ int trie_paths_helper(Trie *file_trie, char *buffer, char *cur_dir)
         cur_dir[strlen(cur_dir) - 1] = '\0';
     }
 
-    Read_Lock(file_trie->Lock);
-    for (int i = 0; i < MAX_SUB_FILES; i++)
+    // Listings are a snapshot taken without locks, an entry changed meanwhile may be missed
+    Trie_Children *table = __atomic_load_n(&file_trie->children, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; table != NULL && i < table->Capacity && strlen(buffer) + 1 < MAX_BUFFER_SIZE; i++)
     {
-        if (file_trie->children[i] != NULL)
+        Trie *child = __atomic_load_n(&table->Slots[i], __ATOMIC_ACQUIRE);
+        if (child != NULL)
         {
             char path[MAX_BUFFER_SIZE];
-            snprintf(path, MAX_BUFFER_SIZE, "%s/%s", cur_dir, file_trie->children[i]->path_token);
+            snprintf(path, MAX_BUFFER_SIZE, "%s/%s", cur_dir, __atomic_load_n(&child->path_token, __ATOMIC_ACQUIRE));
 
-            strncat(buffer, path, MAX_BUFFER_SIZE);
-            strcat(buffer, "\n");
-            Read_Unlock(file_trie->Lock);
-            int status = trie_paths_helper(file_trie->children[i], buffer, path);
-            Read_Lock(file_trie->Lock);
+            strncat(buffer, path, MAX_BUFFER_SIZE - strlen(buffer) - 1);
+            strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+            int status = trie_paths_helper(child, buffer, path);
             if (CheckError(status, "trie_paths_helper: Error printing to buffer"))
             {
                 fprintf(Log_File, "trie_paths_helper: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -112,29 +491,104 @@ int trie_paths_helper(Trie *file_trie, char *buffer, char *cur_dir)
             }
         }
     }
-    Read_Unlock(file_trie->Lock);
     return 0;
 }
 
 /**
  * @brief Initializes a Trie_Node Object to store lock corresponding to paths
- * @param None
- * @return a pointer to Trie_Node_Object
+ * @param path_token the name of the node (copied)
+ * @return a pointer to Trie_Node_Object, NULL on failure
  * @note called as a subroutine of trie_insert
  */
-Trie *trie_init()
+Trie *trie_init(const char *path_token)
 {
-    Trie *file_trie = (Trie *)malloc(sizeof(Trie));
-    file_trie->path_token[0] = '\0';
-    for (int i = 0; i < MAX_SUB_FILES; i++)
+    Trie *file_trie = (Trie *)calloc(1, sizeof(Trie));
+    if (file_trie == NULL)
+    {
+        return NULL;
+    }
+    file_trie->path_token = strdup(path_token);
+    if (file_trie->path_token == NULL)
     {
-        file_trie->children[i] = NULL;
+        free(file_trie);
+        return NULL;
     }
-    file_trie->Lock = RW_Lock_Init();
+    file_trie->token_hash = hash(path_token);
+    // The lock is allocated on first use (trie_node_lock)
 
     return file_trie;
 }
 
+/**
+ * @brief Returns the lock of a node, allocating it on first use
+ * @param node the node
+ * @return a pointer to the lock of the node, NULL if it could not be allocated
+ * @note most files are never opened, so nodes are created without a lock
+ */
+Reader_Writer_Lock *trie_node_lock(Trie *node)
+{
+    Reader_Writer_Lock *Lock = __atomic_load_n(&node->Lock, __ATOMIC_ACQUIRE);
+    if (Lock != NULL)
+    {
+        return Lock;
+    }
+
+    Reader_Writer_Lock *Created = RW_Lock_Init();
+    if (Created == NULL)
+    {
+        return NULL;
+    }
+    if (!__atomic_compare_exchange_n(&node->Lock, &Lock, Created, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        // Another thread installed its lock first
+        RW_Lock_Destroy(Created);
+        return Lock;
+    }
+    return Created;
+}
+
+/**
+ * @brief Returns the intent lock of a node, allocating it on first use
+ * @param node the node
+ * @return a pointer to the intent lock of the node, NULL if it could not be allocated
+ */
+Intent_Lock *trie_node_intent(Trie *node)
+{
+    Intent_Lock *Lock = __atomic_load_n(&node->Intent, __ATOMIC_ACQUIRE);
+    if (Lock != NULL)
+    {
+        return Lock;
+    }
+
+    Intent_Lock *Created = Intent_Lock_Init();
+    if (Created == NULL)
+    {
+        return NULL;
+    }
+    if (!__atomic_compare_exchange_n(&node->Intent, &Lock, Created, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        // Another thread installed its lock first
+        Intent_Lock_Destroy(Created);
+        return Lock;
+    }
+    return Created;
+}
+
+/**
+ * @brief Frees a node that no reader can reach, with its locks
+ * @param node the node
+ * @note used for a node that was never published and for the whole trie on shutdown
+ */
+void trie_free_node(void *node)
+{
+    Trie *file_trie = (Trie *)node;
+    RW_Lock_Destroy(file_trie->Lock);
+    Intent_Lock_Destroy(file_trie->Intent);
+    free(file_trie->children);
+    free(file_trie->path_token);
+    free(file_trie);
+}
+
 /**
  * @brief Inserts a path into the trie
  * @param file_trie the trie to be inserted into
@@ -143,149 +597,172 @@ Trie *trie_init()
  */
 int trie_insert(Trie *file_trie, char *path)
 {
-    char *path_token = strtok(path, "/");
+    char *save = NULL;
+    char *path_token = strtok_r(path, "/", &save);
     // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
+    path_token = strtok_r(NULL, "/", &save);
 
+    Epoch_Enter();
     Trie *curr = file_trie;
     while (path_token != NULL)
     {
-        int index = hash(path_token);
-        Read_Lock(curr->Lock);
-        if (curr->children[index] == NULL)
+        Trie *child = trie_child(curr, path_token);
+        if (child == NULL)
         {
-            Read_Unlock(curr->Lock);
-            Write_Lock(curr->Lock);
-            curr->children[index] = trie_init();
-            if (CheckNull(curr->children[index], "trie_insert: Error initializing trie node"))
+            Write_Lock(trie_node_lock(curr));
+            // Another writer may have added it in between
+            child = trie_child(curr, path_token);
+            if (child == NULL)
             {
-                Write_Unlock(curr->Lock);
-                fprintf(Log_File, "trie_insert: Error initializing trie node [Time Stamp: %f]\n", GetCurrTime(Clock));
-                return -1;
+                child = trie_init(path_token);
+                int status = -1;
+                if (!CheckNull(child, "trie_insert: Error initializing trie node"))
+                {
+                    trie_write_begin(curr);
+                    status = trie_add_child(curr, child);
+                    trie_write_end(curr);
+                }
+                if (status < 0)
+                {
+                    if (child != NULL)
+                        trie_free_node(child);
+                    Write_Unlock(trie_node_lock(curr));
+                    Epoch_Exit();
+                    fprintf(Log_File, "trie_insert: Error initializing trie node [Time Stamp: %f]\n", GetCurrTime(Clock));
+                    return -1;
+                }
             }
-            strncpy(curr->children[index]->path_token, path_token, TOKEN_SIZE);
-            Write_Unlock(curr->Lock);
+            Write_Unlock(trie_node_lock(curr));
         }
-        Read_Unlock(curr->Lock);
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        curr = child;
+        path_token = strtok_r(NULL, "/", &save);
     }
+    Epoch_Exit();
     return 0;
 }
 
 /**
- * @brief Gets the lock corresponding to a path in the trie
- * @param file_trie the trie to be searched
- * @param path the path to be inserted
- * @return a pointer to the lock corresponding to the path
- * @note returns NULL if path not found
+ * @brief Locks a path for an operation, multi granularity locking down the path
+ * @param file_trie the trie
+ * @param path the path (tokenised)
+ * @param mode INTENT_IS or INTENT_IX for an operation on the file, INTENT_S or INTENT_X for one on the whole subtree
+ * @param held set to the locks taken, to be passed to trie_unlock_path (also when the path is not found)
+ * @return the lock of the path, NULL if the path is not found or its locks could not be allocated
+ * @note the directories above the path are taken in IS (IS and S) or IX (IX and X), the path itself in mode,
+ *       a file operation then locks the file with the returned lock
  */
-Reader_Writer_Lock *trie_get_path_lock(Trie *file_trie, char *path)
+Reader_Writer_Lock *trie_lock_path(Trie *file_trie, char *path, int mode, Trie_Path_Lock *held)
 {
-    char *path_token = strtok(path, "/");
-    // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
+    held->Held = held->Inline;
+    held->Count = 0;
+    held->Mode = (mode == INTENT_IS || mode == INTENT_S) ? INTENT_IS : INTENT_IX;
+    held->Target = NULL;
+    held->Target_Mode = mode;
 
-    Trie *curr = file_trie;
-    while (path_token != NULL)
+    // A path of n tokens has atmost n / 2 directories below the root
+    size_t depth = strlen(path) / 2 + 1;
+    if (depth > TRIE_PATH_LOCK_INLINE)
     {
-        int index = hash(path_token);
-        if (curr->children[index] == NULL)
+        held->Held = (Intent_Lock **)malloc(depth * sizeof(Intent_Lock *));
+        if (CheckNull(held->Held, "trie_lock_path: Error allocating lock list"))
         {
+            held->Held = held->Inline;
             return NULL;
         }
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
     }
-    return curr->Lock;
-}
 
-/**
- * @brief Deletes a path from the trie
- * @param file_trie the trie to be deleted from
- * @param path the path to be deleted
- * @return 0 on success, -1 on failure
- */
-int trie_delete(Trie *file_trie, char *path)
-{
-    char *path_token = strtok(path, "/");
+    char *save = NULL;
+    char *path_token = strtok_r(path, "/", &save);
     // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
+    path_token = strtok_r(NULL, "/", &save);
 
+    Epoch_Enter();
+    Trie *parent = NULL;
+    char *name = NULL;
     Trie *curr = file_trie;
-    while (path_token != NULL)
+    Reader_Writer_Lock *Lock = NULL;
+    while (curr != NULL)
     {
-        int index = hash(path_token);
-        Read_Lock(curr->Lock);
-        if (curr->children[index] == NULL)
+        int target = (path_token == NULL);
+        int curr_mode = target ? mode : held->Mode;
+        Intent_Lock *intent = trie_node_intent(curr);
+        if (intent == NULL)
         {
-            Read_Unlock(curr->Lock);
-            return -1;
+            break;
         }
-        path_token = strtok(NULL, "/");
-        if (path_token == NULL)
-        {
-            Trie *temp = curr->children[index];
+        Intent_Lock_Acquire(intent, curr_mode);
 
-            Read_Unlock(curr->Lock);
-            Write_Lock(curr->Lock);
-            curr->children[index] = NULL;
-            Write_Unlock(curr->Lock);
-
-            curr = temp;
-        }
-        else
+        // Renamed while we waited for it (the lock on the parent keeps the parent in place)
+        if (parent != NULL && trie_child(parent, name) != curr)
         {
-            Trie *temp = curr;
-            curr = curr->children[index];
-            Read_Unlock(temp->Lock);
+            Intent_Lock_Release(intent, curr_mode);
+            curr = trie_child(parent, name);
+            continue;
         }
-    }
 
-    // Delete all children
-    Write_Lock(curr->Lock);
-    for (int i = 0; i < MAX_SUB_FILES; i++)
-    {
-        if (curr->children[i] != NULL)
+        if (target)
         {
-            int status = trie_destroy(curr->children[i]);
-            if (CheckError(status, "trie_delete: Error deleting children"))
-            {
-                fprintf(Log_File, "trie_delete: Error deleting children [Time Stamp: %f]\n", GetCurrTime(Clock));
-                return -1;
-            }
-            curr->children[i] = NULL;
+            held->Target = intent;
+            Lock = trie_node_lock(curr);
+            break;
         }
+        held->Held[held->Count++] = intent;
+        parent = curr;
+        name = path_token;
+        curr = trie_child(curr, path_token);
+        path_token = strtok_r(NULL, "/", &save);
     }
-    // dont need to unlock as the lock is destroyed
-    // Write_Unlock(curr->Lock);
+    Epoch_Exit();
+    return Lock;
+}
 
-    // Delete the current node
-    free(curr);
-    return 0;
+/**
+ * @brief Releases the intent locks of a path
+ * @param held the locks taken by trie_lock_path
+ */
+void trie_unlock_path(Trie_Path_Lock *held)
+{
+    if (held->Target != NULL)
+    {
+        Intent_Lock_Release(held->Target, held->Target_Mode);
+        held->Target = NULL;
+    }
+    while (held->Count > 0)
+    {
+        Intent_Lock_Release(held->Held[--held->Count], held->Mode);
+    }
+    if (held->Held != held->Inline)
+    {
+        free(held->Held);
+        held->Held = held->Inline;
+    }
 }
 
 /**
  * @brief Recursively deletes a trie
  * @param file_trie the trie to be destroyed
  * @return 0 on success, -1 on failure
- * @note This function is called as a subroutine of trie_delete
+ * @note Frees the nodes at once, only used on shutdown
  */
 int trie_destroy(Trie *file_trie)
 {
-    Write_Lock(file_trie->Lock);
+    if (file_trie->Lock != NULL)
+    {
+        Write_Lock(file_trie->Lock);
+    }
     // Delete all children
-    for (int i = 0; i < MAX_SUB_FILES; i++)
+    Trie_Children *table = file_trie->children;
+    for (uint32_t i = 0; table != NULL && i < table->Capacity; i++)
     {
-        if (file_trie->children[i] != NULL)
+        if (table->Slots[i] != NULL)
         {
-            int status = trie_destroy(file_trie->children[i]);
+            int status = trie_destroy(table->Slots[i]);
             if (CheckError(status, "trie_destroy: Error deleting children"))
             {
                 fprintf(Log_File, "trie_destroy: Error deleting children [Time Stamp: %f]\n", GetCurrTime(Clock));
                 return -1;
             }
-            file_trie->children[i] = NULL;
+            table->Slots[i] = NULL;
         }
     }
 
@@ -293,7 +770,7 @@ int trie_destroy(Trie *file_trie)
     // Write_Unlock(file_trie->Lock);
 
     // Delete the current node
-    free(file_trie);
+    trie_free_node(file_trie);
     return 0;
 }
 
@@ -308,43 +785,51 @@ int trie_destroy(Trie *file_trie)
  */
 int trie_rename(Trie *file_trie, char *old_path, char *new_token)
 {
-    char *path_token = strtok(old_path, "/");
-    // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
+    char *name = strdup(new_token);
+    if (CheckNull(name, "trie_rename: Error allocating name"))
+    {
+        return -1;
+    }
 
-    Trie *curr = file_trie;
+    Epoch_Enter();
     Trie *prev = NULL;
-    int cur_index = -1;
-    while (path_token != NULL)
+    Trie *curr = trie_walk(file_trie, old_path, &prev);
+    if (curr == NULL || prev == NULL)
     {
-        int index = hash(path_token);
-        Read_Lock(curr->Lock);
-        if (curr->children[index] == NULL)
-        {
-            Read_Unlock(curr->Lock);
-            return -1;
-        }
-        cur_index = index;
-        prev = curr;
-        curr = curr->children[index];
-        path_token = strtok(NULL, "/");
+        Epoch_Exit();
+        free(name);
+        return -1;
     }
 
-    Write_Lock(curr->Lock);
-    int index = hash(new_token);
-    if (prev->children[index] == NULL)
+    // The node is rehashed under its new name in the parent's table
+    Write_Lock(trie_node_lock(prev));
+    if (trie_child(prev, new_token) != NULL)
     {
-        prev->children[cur_index] = NULL;
-        prev->children[index] = curr;
-        strncpy(prev->children[index]->path_token, new_token, TOKEN_SIZE);
-        Write_Unlock(curr->Lock);
-        return 0;
+        Write_Unlock(trie_node_lock(prev));
+        Epoch_Exit();
+        free(name);
+        return -1;
     }
-    else
+    trie_write_begin(prev);
+    if (trie_remove_child(prev, curr) < 0)
     {
-        Write_Unlock(curr->Lock);
+        trie_write_end(prev);
+        Write_Unlock(trie_node_lock(prev));
+        Epoch_Exit();
+        free(name);
         return -1;
     }
+    char *old_name = curr->path_token;
+    __atomic_store_n(&curr->path_token, name, __ATOMIC_RELEASE);
+    __atomic_store_n(&curr->token_hash, hash(name), __ATOMIC_RELAXED);
+    // Its slot was freed and the table was not shrunk, so this does not allocate
+    trie_add_child(prev, curr);
+    trie_write_end(prev);
+    Write_Unlock(trie_node_lock(prev));
+
+    // Readers may still be comparing the old name
+    Epoch_Retire(old_name, free);
+    Epoch_Exit();
     return 0;
 }
 
@@ -356,43 +841,43 @@ int trie_rename(Trie *file_trie, char *old_path, char *new_token)
  */
 int trie_print(Trie *file_trie, char *buffer, int level)
 {
-    if (file_trie == NULL)
+    if (file_trie == NULL || strlen(buffer) + 1 >= MAX_BUFFER_SIZE)
     {
         return 0;
     }
 
-    // Print the current node
+    // Print the current node (the output is truncated at MAX_BUFFER_SIZE)
     int status;
     for (int i = 0; i < level; i++)
     {
         if (i % 2 == 0)
-            sprintf(buffer, "%s|", buffer);
+            strncat(buffer, "|", MAX_BUFFER_SIZE - strlen(buffer) - 1);
         else
-            sprintf(buffer, "%s  ", buffer);
-    }
-    Read_Lock(file_trie->Lock);
-    status = sprintf(buffer, "%s|-%s\n", buffer, file_trie->path_token);
-    if (CheckError(status, "trie_print: Error printing to buffer"))
-    {
-        Read_Unlock(file_trie->Lock);
-        fprintf(Log_File, "trie_print: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
-        return -1;
+            strncat(buffer, "  ", MAX_BUFFER_SIZE - strlen(buffer) - 1);
     }
+    Epoch_Enter();
+    strncat(buffer, "|-", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+    strncat(buffer, __atomic_load_n(&file_trie->path_token, __ATOMIC_ACQUIRE), MAX_BUFFER_SIZE - strlen(buffer) - 1);
+    strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
 
-    for (int i = 0; i < MAX_SUB_FILES; i++)
+    // Listings are a snapshot taken without locks, an entry changed meanwhile may be missed
+    Trie_Children *table = __atomic_load_n(&file_trie->children, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; table != NULL && i < table->Capacity; i++)
     {
-        if (file_trie->children[i] != NULL)
+        Trie *child = __atomic_load_n(&table->Slots[i], __ATOMIC_ACQUIRE);
+        if (child != NULL)
         {
-            status = trie_print(file_trie->children[i], buffer, level + 1);
+            status = trie_print(child, buffer, level + 1);
             if (CheckError(status, "trie_print: Error printing to buffer"))
             {
+                Epoch_Exit();
                 fprintf(Log_File, "trie_print: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
                 return -1;
             }
         }
     }
 
-    Read_Unlock(file_trie->Lock);
+    Epoch_Exit();
     return 0;
 }
 
@@ -414,28 +899,17 @@ int trie_paths(Trie *file_trie, char *buffer, char *root)
     strncpy(root_path, root, MAX_BUFFER_SIZE);
 
     // traverse to the root
-    Trie *curr = file_trie;
-    char *path_token = strtok(root, "/");
-    // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
-    while (path_token != NULL)
+    Epoch_Enter();
+    Trie *curr = trie_walk(file_trie, root, NULL);
+    if (CheckNull(curr, "trie_paths: Error traversing to root"))
     {
-        int index = hash(path_token);
-        Read_Lock(curr->Lock);
-        if (CheckNull(curr->children[index], "trie_paths: Error traversing to root"))
-        {
-            Read_Unlock(curr->Lock);
-            fprintf(Log_File, "trie_paths: Error traversing to root [Time Stamp: %f]\n", GetCurrTime(Clock));
-            return -1;
-        }
-
-        Trie *temp = curr;
-        curr = curr->children[index];
-        Read_Unlock(temp->Lock);
-        path_token = strtok(NULL, "/");
+        Epoch_Exit();
+        fprintf(Log_File, "trie_paths: Error traversing to root [Time Stamp: %f]\n", GetCurrTime(Clock));
+        return -1;
     }
 
     int status = trie_paths_helper(curr, buffer, root_path);
+    Epoch_Exit();
     if (CheckError(status, "trie_paths: Error printing to buffer"))
     {
         fprintf(Log_File, "trie_paths: Error printing to buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
@@ -444,33 +918,123 @@ int trie_paths(Trie *file_trie, char *buffer, char *root)
     return 0;
 }
 
+/**
+ * @brief Outputs the export points of the server (the entries directly under the root) to a buffer seperated by newlines
+ * @param file_trie the trie
+ * @param buffer the buffer to be printed to
+ * @param root the prefix of the exported paths (the cwd, e.g. "./")
+ * @return 0 on success, -1 on failure
+ * @note The files below an export point are not sent, the naming server resolves them to the server by longest prefix
+ */
+int trie_exports(Trie *file_trie, char *buffer, char *root)
+{
+    if (file_trie == NULL)
+    {
+        return 0;
+    }
+
+    char prefix[MAX_BUFFER_SIZE];
+    strncpy(prefix, root, MAX_BUFFER_SIZE - 1);
+    prefix[MAX_BUFFER_SIZE - 1] = '\0';
+    // Remove '/' if it is the last character
+    if (strlen(prefix) > 0 && prefix[strlen(prefix) - 1] == '/')
+    {
+        prefix[strlen(prefix) - 1] = '\0';
+    }
+
+    Epoch_Enter();
+    Trie_Children *table = __atomic_load_n(&file_trie->children, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; table != NULL && i < table->Capacity; i++)
+    {
+        Trie *child = __atomic_load_n(&table->Slots[i], __ATOMIC_ACQUIRE);
+        if (child != NULL)
+        {
+            char path[MAX_BUFFER_SIZE];
+            snprintf(path, MAX_BUFFER_SIZE, "%s/%s\n", prefix, __atomic_load_n(&child->path_token, __ATOMIC_ACQUIRE));
+            if (strlen(buffer) + strlen(path) >= MAX_BUFFER_SIZE)
+            {
+                Epoch_Exit();
+                fprintf(Log_File, "trie_exports: Too many export points for the buffer [Time Stamp: %f]\n", GetCurrTime(Clock));
+                return -1;
+            }
+            strcat(buffer, path);
+        }
+    }
+    Epoch_Exit();
+    return 0;
+}
+
+/**
+ * @brief Recursively helper function to list a subtree
+ * @param file_trie the node to be listed
+ * @param buffer the buffer to be printed to (truncated at MAX_BUFFER_SIZE)
+ * @param level the depth of the node in the listing
+ * @note This function is called as a subroutine of trie_list (inside an epoch)
+ */
+void trie_list_helper(Trie *file_trie, char *buffer, int level)
+{
+    if (strlen(buffer) + 1 >= MAX_BUFFER_SIZE)
+    {
+        return;
+    }
+    for (int i = 0; i < level; i++)
+    {
+        if (i % 2 == 0)
+            strncat(buffer, "|", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+        else
+            strncat(buffer, " ", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+    }
+    strncat(buffer, "|-", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+    strncat(buffer, __atomic_load_n(&file_trie->path_token, __ATOMIC_ACQUIRE), MAX_BUFFER_SIZE - strlen(buffer) - 1);
+    strncat(buffer, "\n", MAX_BUFFER_SIZE - strlen(buffer) - 1);
+
+    Trie_Children *table = __atomic_load_n(&file_trie->children, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; table != NULL && i < table->Capacity; i++)
+    {
+        Trie *child = __atomic_load_n(&table->Slots[i], __ATOMIC_ACQUIRE);
+        if (child != NULL)
+        {
+            trie_list_helper(child, buffer, level + 1);
+        }
+    }
+}
+
+/**
+ * @brief Outputs the directory tree under a path to a buffer (in the format of the naming server's listing)
+ * @param file_trie the trie
+ * @param path the path to be listed (first token is the mount root)
+ * @param buffer the buffer to be printed to, atleast MAX_BUFFER_SIZE bytes
+ * @return 0 on success, -1 if the path is not in the trie
+ * @note modifies the path string provided
+ */
+int trie_list(Trie *file_trie, char *path, char *buffer)
+{
+    Epoch_Enter();
+    Trie *curr = trie_walk(file_trie, path, NULL);
+    if (curr == NULL)
+    {
+        Epoch_Exit();
+        return -1;
+    }
+
+    buffer[0] = '\0';
+    trie_list_helper(curr, buffer, 0);
+    Epoch_Exit();
+    return 0;
+}
+
 /**
  * @brief Searches for a path in the trie
  * @param file_trie the trie to be searched
  * @param path the path to be searched
  * @return 1 if found, 0 if not found
  * @note modifies the path string provided
+ * @note takes no lock, see CHILD TABLES
  */
 int trie_search(Trie *file_trie, char *path)
 {
-    char *path_token = strtok(path, "/");
-    // Ignore the first token as it is the cwd
-    path_token = strtok(NULL, "/");
-
-    Trie *curr = file_trie;
-    while (path_token != NULL)
-    {
-        int index = hash(path_token);
-        Read_Lock(curr->Lock);
-        if (curr->children[index] == NULL)
-        {
-            Read_Unlock(curr->Lock);
-            return 0;
-        }
-        Trie *temp = curr;
-        curr = curr->children[index];
-        Read_Unlock(temp->Lock);
-        path_token = strtok(NULL, "/");
-    }
-    return 1;
-}
\ No newline at end of file
+    Epoch_Enter();
+    int found = trie_walk(file_trie, path, NULL) != NULL;
+    Epoch_Exit();
+    return found;
+}
@@ -1,47 +1,93 @@
 #ifndef __TRIE_H__
 #define __TRIE_H__
 
+#include <stdint.h>
 #include <pthread.h>
+#include "./Range_Lock.h"
+#include "./Intent_Lock.h"
 
-#define MAX_SUB_FILES 512 // Max number of sub files in a directory(High for good hash distribution)
-#define TOKEN_SIZE 32 // Max size of a path token
+// Child table sizes, a directory grows through them as entries are added
+#define TRIE_NODE_4 4     // Small directories, children scanned linearly
+#define TRIE_NODE_16 16
+#define TRIE_NODE_64 64   // Open addressing from here on, holds 48 children at 3/4 load
+#define TRIE_NODE_256 256 // Doubled beyond this while 3/4 full
 
 // Reader/Writer lock struct
+// Phase fair (readers and writers take turns so neither starves), threads sleep on futexes
 typedef struct Reader_Writer_Lock
 {
-    pthread_mutex_t Service_Q_Lock;
-    pthread_mutex_t Read_Init_Lock;
-    pthread_mutex_t Write_Lock;
+    uint32_t Reader_In;  // Readers that entered (or wait) times RW_READER, low bits set by a writer
+    uint32_t Reader_Out; // Readers that left times RW_READER
+    uint32_t Writer_In;  // Ticket of the next writer to queue
+    uint32_t Writer_Out; // Ticket of the writer being served
 
-    int Reader_Count;
+    // Wait counters, only updated by acquisitions that had to sleep
+    uint64_t Read_Waits;
+    uint64_t Read_Wait_Ns;
+    uint64_t Write_Waits;
+    uint64_t Write_Wait_Ns;
+
+    Range_Lock *Ranges; // Byte ranges of the file, taken while holding the Read_Lock
 }Reader_Writer_Lock;
 
 Reader_Writer_Lock *RW_Lock_Init();
+void RW_Lock_Destroy(Reader_Writer_Lock *Lock);
 void Read_Lock(Reader_Writer_Lock *Lock);
 void Read_Unlock(Reader_Writer_Lock *Lock);
 void Write_Lock(Reader_Writer_Lock *Lock);
 void Write_Unlock(Reader_Writer_Lock *Lock);
+void RW_Lock_Totals(uint64_t *Waits, uint64_t *Wait_Ns); // Waits and time waited on all locks since startup
+
+struct Trie_Node;
+
+// Child table of a node, replaced as a whole when it is resized so lock-free readers always see a consistent size
+typedef struct Trie_Children
+{
+    uint32_t Count;
+    uint32_t Capacity;            // TRIE_NODE_4, TRIE_NODE_16 or a power of two >= TRIE_NODE_64
+    struct Trie_Node *Slots[];    // Packed array up to TRIE_NODE_16, hash table (linear probing) above
+}Trie_Children;
 
 // Trie node struct
 typedef struct Trie_Node
 {
-    char path_token[TOKEN_SIZE];
-    Reader_Writer_Lock* Lock;
-    struct Trie_Node *children[MAX_SUB_FILES];
+    char *path_token;             // Full length name of the entry
+    uint32_t token_hash;          // Hash of path_token, compared before the name
+    uint32_t Version;             // Odd while a writer changes the child table (seqlock for lock-free lookups)
+    Reader_Writer_Lock* Lock;     // Taken by file operations on the path and by writers of the child table, NULL until first used
+    Intent_Lock* Intent;          // Taken by every operation on a path through the node (trie_lock_path), NULL until first used
+    Trie_Children *children;      // NULL if the node has no children
 }Trie_Node;
 
 typedef Trie_Node Trie;
 
+#define TRIE_PATH_LOCK_INLINE 16 // Directories above a path held without allocating
+
+// Intent locks held on a path (trie_lock_path), released by trie_unlock_path
+typedef struct Trie_Path_Lock
+{
+    Intent_Lock *Inline[TRIE_PATH_LOCK_INLINE];
+    Intent_Lock **Held;   // Directories above the target from the root down (Inline unless the path is deeper)
+    int Count;
+    int Mode;             // INTENT_IS or INTENT_IX
+    Intent_Lock *Target;  // NULL if the path was not found
+    int Target_Mode;
+}Trie_Path_Lock;
+
 // Function prototypes
-Trie* trie_init(); // Initialize the trie on startup in the cwd for all paths in cwd
+Trie* trie_init(const char* path_token); // Initialize a trie node (the root of the trie on startup)
 int trie_insert(Trie* file_trie, char* path); // Insert a path into the trie
-Reader_Writer_Lock* trie_get_path_lock(Trie* file_trie, char* path); // Get correspomding lock for a path in trie
-int trie_delete(Trie* file_trie, char *path); // Delete a path from the trie (deletes all children path)
+Reader_Writer_Lock* trie_node_lock(Trie* node); // Get the lock of a node (allocated on first use)
+Intent_Lock* trie_node_intent(Trie* node); // Get the intent lock of a node (allocated on first use)
+Reader_Writer_Lock* trie_lock_path(Trie* file_trie, char* path, int mode, Trie_Path_Lock* held); // Take the intent locks of a path, returns the lock of the path
+void trie_unlock_path(Trie_Path_Lock* held); // Release the intent locks taken by trie_lock_path
 int trie_destroy(Trie* file_trie); // Destroy the trie on shutdown
 int trie_rename(Trie* file_trie, char* old_path, char* new_token); // Rename a path in the trie
 
-int trie_search(Trie* file_trie, char* path); // Search for a path in the trie
+int trie_search(Trie* file_trie, char* path); // Search for a path in the trie (takes no lock)
 int trie_print(Trie* file_trie, char* buffer, int level); // Print the trie
 int trie_paths(Trie* file_trie, char* buffer, char* root); // Get all paths in the trie under root-path
+int trie_exports(Trie* file_trie, char* buffer, char* root); // Get the export points of the server (entries under the root)
+int trie_list(Trie* file_trie, char* path, char* buffer); // Get the directory tree under a path
 
 #endif // __TRIE_H__
\ No newline at end of file
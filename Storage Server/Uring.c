@@ -0,0 +1,543 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "./Uring.h"
+
+/*
+IO_URING DATA PATH
+    1. Every worker owns a ring and a fixed buffer registered with it, the client socket and the
+       file being served are registered in file slots URING_SLOT_SOCKET and URING_SLOT_FILE
+    2. READ queues a linked chain of READ_FIXED (file -> buffer) and SEND (buffer -> socket) pairs,
+       one pair per DATA frame, as many frames as fit the buffer go in with a single io_uring_enter
+    3. WRITE queues RECV (socket -> buffer), WRITE_FIXED (buffer -> file) and the RECV of the next
+       frame header as one chain per DATA frame
+    4. INFO runs STATX on the ring
+    A chain stops at the first failed (or short) entry, the rest come back with -ECANCELED
+*/
+
+#define URING_SLOT_SOCKET 0
+#define URING_SLOT_FILE 1
+
+/**
+ * @brief Initializes a SS_Ring Object
+ * @param Buffer: The buffer to be registered as fixed buffer 0
+ * @param Buffer_Size: The size of the buffer (atleast URING_BUFFER_SIZE)
+ * @return a pointer to SS_Ring Object, NULL if io_uring is not available (callers fall back to plain syscalls)
+ */
+SS_Ring *Uring_Init(unsigned char *Buffer, size_t Buffer_Size)
+{
+#if SS_USE_IO_URING
+    if (Buffer == NULL || Buffer_Size < URING_BUFFER_SIZE)
+        return NULL;
+
+    struct io_uring_params Params;
+    memset(&Params, 0, sizeof(Params));
+    int Ring_Fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &Params);
+    if (Ring_Fd < 0)
+        return NULL;
+    if (!(Params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close(Ring_Fd);
+        return NULL;
+    }
+
+    SS_Ring *Ring = (SS_Ring *)calloc(1, sizeof(SS_Ring));
+    if (Ring == NULL)
+    {
+        close(Ring_Fd);
+        return NULL;
+    }
+    Ring->Ring_Fd = Ring_Fd;
+    Ring->Sq_Entries = Params.sq_entries;
+    Ring->Stat = (struct statx *)malloc(sizeof(struct statx));
+    if (Ring->Stat == NULL)
+    {
+        close(Ring_Fd);
+        free(Ring);
+        return NULL;
+    }
+
+    // The submission and completion rings share one mapping
+    size_t Sq_Size = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+    size_t Cq_Size = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+    Ring->Ring_Map_Size = Sq_Size > Cq_Size ? Sq_Size : Cq_Size;
+    Ring->Ring_Map = mmap(NULL, Ring->Ring_Map_Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring_Fd, IORING_OFF_SQ_RING);
+    Ring->Sqes_Size = Params.sq_entries * sizeof(struct io_uring_sqe);
+    Ring->Sqes = mmap(NULL, Ring->Sqes_Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring_Fd, IORING_OFF_SQES);
+    if (Ring->Ring_Map == MAP_FAILED || Ring->Sqes == MAP_FAILED)
+    {
+        if (Ring->Ring_Map != MAP_FAILED)
+            munmap(Ring->Ring_Map, Ring->Ring_Map_Size);
+        if (Ring->Sqes != MAP_FAILED)
+            munmap(Ring->Sqes, Ring->Sqes_Size);
+        close(Ring_Fd);
+        free(Ring->Stat);
+        free(Ring);
+        return NULL;
+    }
+
+    unsigned char *Map = (unsigned char *)Ring->Ring_Map;
+    Ring->Sq_Head = (unsigned *)(Map + Params.sq_off.head);
+    Ring->Sq_Tail = (unsigned *)(Map + Params.sq_off.tail);
+    Ring->Sq_Mask = (unsigned *)(Map + Params.sq_off.ring_mask);
+    Ring->Sq_Array = (unsigned *)(Map + Params.sq_off.array);
+    Ring->Sq_Local_Tail = *Ring->Sq_Tail;
+    Ring->Cq_Head = (unsigned *)(Map + Params.cq_off.head);
+    Ring->Cq_Tail = (unsigned *)(Map + Params.cq_off.tail);
+    Ring->Cq_Mask = (unsigned *)(Map + Params.cq_off.ring_mask);
+    Ring->Cqes = (struct io_uring_cqe *)(Map + Params.cq_off.cqes);
+
+    // Register the buffer and two (empty) file slots, filled for every request
+    struct iovec Iov = {.iov_base = Buffer, .iov_len = Buffer_Size};
+    int Files[2] = {-1, -1};
+    if (syscall(__NR_io_uring_register, Ring_Fd, IORING_REGISTER_BUFFERS, &Iov, 1) < 0 ||
+        syscall(__NR_io_uring_register, Ring_Fd, IORING_REGISTER_FILES, Files, 2) < 0)
+    {
+        Uring_Destroy(Ring);
+        return NULL;
+    }
+    Ring->Buffer = Buffer;
+    Ring->Buffer_Size = Buffer_Size;
+    return Ring;
+#else
+    (void)Buffer;
+    (void)Buffer_Size;
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Tears down a SS_Ring Object (the fixed buffer belongs to the caller)
+ * @param Ring: The ring
+ * @return: None
+ */
+void Uring_Destroy(SS_Ring *Ring)
+{
+    if (Ring == NULL)
+        return;
+    munmap(Ring->Sqes, Ring->Sqes_Size);
+    munmap(Ring->Ring_Map, Ring->Ring_Map_Size);
+    close(Ring->Ring_Fd);
+    // Entries of a broken ring may still complete, the memory they point at is left allocated
+    if (Ring->Broken)
+        return;
+    free(Ring->Stat);
+    free(Ring);
+}
+
+/**
+ * @brief Takes the next free submission queue entry
+ * @param Ring: The ring
+ * @return: The cleared entry, NULL if the queue is full
+ * @note: The entry is only handed to the kernel by Uring_Submit_And_Wait
+ */
+static struct io_uring_sqe *Uring_Get_Sqe(SS_Ring *Ring)
+{
+    unsigned Head = __atomic_load_n(Ring->Sq_Head, __ATOMIC_ACQUIRE);
+    if (Ring->Sq_Local_Tail - Head >= Ring->Sq_Entries)
+        return NULL;
+
+    unsigned Index = Ring->Sq_Local_Tail & *Ring->Sq_Mask;
+    struct io_uring_sqe *Sqe = &Ring->Sqes[Index];
+    memset(Sqe, 0, sizeof(*Sqe));
+    Ring->Sq_Array[Index] = Index;
+    Ring->Sq_Local_Tail++;
+    return Sqe;
+}
+
+/**
+ * @brief Checks if an io_uring_enter error is transient
+ * @return: 1 if the call is to be retried, 0 otherwise
+ */
+static int Uring_Retry(int Error)
+{
+    // EBUSY: the completion queue is full, it is reaped before the retry
+    return Error == EINTR || Error == EAGAIN || Error == EBUSY;
+}
+
+/**
+ * @brief Waits for the entries the kernel has taken from the submission queue to complete
+ * @param Ring: The ring
+ * @param Start_Head: The submission queue head before the batch was published
+ * @param Done: The completions of the batch already reaped
+ * @return: None
+ * @note: Best effort after io_uring_enter failed, the ring is marked broken either way
+ */
+static void Uring_Drain(SS_Ring *Ring, unsigned Start_Head, unsigned Done)
+{
+    unsigned Taken = __atomic_load_n(Ring->Sq_Head, __ATOMIC_ACQUIRE) - Start_Head;
+    while (Done < Taken)
+    {
+        unsigned Head = *Ring->Cq_Head;
+        unsigned Tail = __atomic_load_n(Ring->Cq_Tail, __ATOMIC_ACQUIRE);
+        Done += Tail - Head;
+        __atomic_store_n(Ring->Cq_Head, Tail, __ATOMIC_RELEASE);
+        if (Done >= Taken)
+            break;
+        if (syscall(__NR_io_uring_enter, Ring->Ring_Fd, 0, Taken - Done, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && !Uring_Retry(errno))
+            break;
+    }
+    Ring->Broken = 1;
+}
+
+/**
+ * @brief Submits the queued entries and collects the given number of completions
+ * @param Ring: The ring
+ * @param Count: The number of completions to wait for
+ * @param Results: Filled with the result of every completion, indexed by its user_data (< Count)
+ * @return: 0 on success, -1 on failure (the ring is then broken and callers fall back to the syscalls)
+ * @note: The user_data of the entries is tagged with the batch, a stale completion is never taken as a result
+ */
+static int Uring_Submit_And_Wait(SS_Ring *Ring, unsigned Count, int *Results)
+{
+    Ring->Generation++;
+    for (unsigned i = *Ring->Sq_Tail; i != Ring->Sq_Local_Tail; i++)
+        Ring->Sqes[i & *Ring->Sq_Mask].user_data |= (uint64_t)Ring->Generation << 32;
+
+    unsigned Start_Head = __atomic_load_n(Ring->Sq_Head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(Ring->Sq_Tail, Ring->Sq_Local_Tail, __ATOMIC_RELEASE);
+
+    unsigned Done = 0;
+    while (Done < Count)
+    {
+        // Reap what has completed so far
+        unsigned Head = *Ring->Cq_Head;
+        unsigned Tail = __atomic_load_n(Ring->Cq_Tail, __ATOMIC_ACQUIRE);
+        while (Head != Tail)
+        {
+            struct io_uring_cqe *Cqe = &Ring->Cqes[Head & *Ring->Cq_Mask];
+            uint64_t Index = Cqe->user_data & 0xffffffffu;
+            if ((uint32_t)(Cqe->user_data >> 32) == Ring->Generation && Index < Count)
+            {
+                Results[Index] = Cqe->res;
+                Done++;
+            }
+            Head++;
+        }
+        __atomic_store_n(Ring->Cq_Head, Head, __ATOMIC_RELEASE);
+        if (Done >= Count)
+            break;
+
+        // Hand over the entries the kernel has not consumed yet and wait for the rest
+        unsigned To_Submit = Ring->Sq_Local_Tail - __atomic_load_n(Ring->Sq_Head, __ATOMIC_ACQUIRE);
+        int ret = syscall(__NR_io_uring_enter, Ring->Ring_Fd, To_Submit, Count - Done, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && !Uring_Retry(errno))
+        {
+            // Entries the kernel took may still write to their buffers, wait for them before giving up
+            int Error = errno;
+            Uring_Drain(Ring, Start_Head, Done);
+            errno = Error;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Places the client socket and the file in the registered file slots
+ * @param Ring: The ring
+ * @param Socket: The client socket
+ * @param Fd: The file (-1 to leave the slot empty)
+ * @return: 0 on success, -1 on failure
+ */
+static int Uring_Register_Files(SS_Ring *Ring, int Socket, int Fd)
+{
+    int Files[2] = {Socket, Fd};
+    struct io_uring_files_update Update;
+    memset(&Update, 0, sizeof(Update));
+    Update.offset = 0;
+    Update.fds = (uint64_t)(uintptr_t)Files;
+    return syscall(__NR_io_uring_register, Ring->Ring_Fd, IORING_REGISTER_FILES_UPDATE, &Update, 2) == 2 ? 0 : -1;
+}
+
+/**
+ * @brief Gets the status of a path
+ * @param Ring: The ring of the worker (NULL for stat)
+ * @param Path: The path
+ * @param St: Filled with the mode, size, link count and times of the path
+ * @return: 0 on success, -1 on failure (errno is set)
+ */
+int Uring_Stat(SS_Ring *Ring, const char *Path, struct stat *St)
+{
+    if (Ring == NULL || Ring->Broken)
+        return stat(Path, St);
+
+    struct statx Stx;
+    struct io_uring_sqe *Sqe = Uring_Get_Sqe(Ring);
+    if (Sqe == NULL)
+        return stat(Path, St);
+    Sqe->opcode = IORING_OP_STATX;
+    Sqe->fd = AT_FDCWD;
+    Sqe->addr = (uint64_t)(uintptr_t)Path;
+    Sqe->len = STATX_BASIC_STATS;
+    Sqe->off = (uint64_t)(uintptr_t)Ring->Stat;
+    Sqe->user_data = 0;
+
+    int Result;
+    if (Uring_Submit_And_Wait(Ring, 1, &Result) < 0)
+        return stat(Path, St);
+    if (Result < 0)
+    {
+        errno = -Result;
+        return -1;
+    }
+    Stx = *Ring->Stat;
+
+    memset(St, 0, sizeof(*St));
+    St->st_mode = Stx.stx_mode;
+    St->st_size = Stx.stx_size;
+    St->st_nlink = Stx.stx_nlink;
+    St->st_atime = Stx.stx_atime.tv_sec;
+    St->st_mtime = Stx.stx_mtime.tv_sec;
+    St->st_ctime = Stx.stx_ctime.tv_sec;
+    return 0;
+}
+
+/**
+ * @brief Streams a range of a file as DATA frames through the ring
+ * @param Ring: The ring (socket and file registered)
+ * @return: Same as Uring_Send_File
+ */
+static int64_t Uring_Send_Registered(SS_Ring *Ring, int Socket, int Opcode, int Fd, off_t Offset, uint64_t Length, uint32_t Chunk_Size)
+{
+    size_t Slot_Size = PACKET_HEADER_SIZE + Chunk_Size;
+    unsigned Slots = Ring->Buffer_Size / Slot_Size;
+    if (Slots > Ring->Sq_Entries / 2)
+        Slots = Ring->Sq_Entries / 2;
+
+    int Results[URING_ENTRIES];
+    uint64_t Sent = 0;
+    while (Sent < Length)
+    {
+        // One READ_FIXED + SEND pair per frame, all linked so that the frames leave in order
+        unsigned Queued = 0;
+        uint32_t Frame_Length[URING_ENTRIES / 2];
+        uint64_t Queued_Bytes = 0;
+        while (Queued < Slots && Sent + Queued_Bytes < Length)
+        {
+            uint64_t Left = Length - Sent - Queued_Bytes;
+            uint32_t Frame = Left < Chunk_Size ? (uint32_t)Left : Chunk_Size;
+            unsigned char *Slot = Ring->Buffer + Queued * Slot_Size;
+
+            PACKET_HEADER Header;
+            Header.iMagic = PROTOCOL_MAGIC;
+            Header.iVersion = PROTOCOL_VERSION;
+            Header.iType = PACKET_TYPE_DATA;
+            Header.iOpcode = Opcode;
+            Header.iRequestID = 0;
+            Header.iLength = Frame;
+            EncodeHeader(&Header, Slot);
+
+            struct io_uring_sqe *Read = Uring_Get_Sqe(Ring);
+            struct io_uring_sqe *Send = Uring_Get_Sqe(Ring);
+            Read->opcode = IORING_OP_READ_FIXED;
+            Read->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            Read->fd = URING_SLOT_FILE;
+            Read->addr = (uint64_t)(uintptr_t)(Slot + PACKET_HEADER_SIZE);
+            Read->len = Frame;
+            Read->off = Offset + Sent + Queued_Bytes;
+            Read->buf_index = 0;
+            Read->user_data = 2 * Queued;
+
+            Send->opcode = IORING_OP_SEND;
+            Send->flags = IOSQE_FIXED_FILE;
+            Send->fd = URING_SLOT_SOCKET;
+            Send->addr = (uint64_t)(uintptr_t)Slot;
+            Send->len = PACKET_HEADER_SIZE + Frame;
+            Send->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            Send->user_data = 2 * Queued + 1;
+
+            Frame_Length[Queued++] = Frame;
+            Queued_Bytes += Frame;
+            if (Queued < Slots && Sent + Queued_Bytes < Length)
+                Send->flags |= IOSQE_IO_LINK;
+        }
+
+        if (Uring_Submit_And_Wait(Ring, 2 * Queued, Results) < 0)
+            return -1;
+
+        for (unsigned i = 0; i < Queued; i++)
+        {
+            int Read_Result = Results[2 * i], Send_Result = Results[2 * i + 1];
+            if (Read_Result == (int)Frame_Length[i] && Send_Result == (int)(PACKET_HEADER_SIZE + Frame_Length[i]))
+            {
+                Sent += Frame_Length[i];
+                continue;
+            }
+
+            // A frame went out partially or with bytes the file did not have, the stream is out of sync
+            if (Send_Result != -ECANCELED)
+                return -1;
+
+            // The file could not be read (or shrank), nothing of this frame was sent, finish with sendfile
+            int64_t Rest = SendFileChunks(Socket, Opcode, Fd, Offset + Sent, Length - Sent, Chunk_Size);
+            return Rest < 0 ? -1 : (int64_t)Sent + Rest;
+        }
+    }
+    return (int64_t)Sent;
+}
+
+/**
+ * @brief Receives the DATA frames of a stream into a file through the ring
+ * @param Ring: The ring (socket and file registered)
+ * @return: Same as Uring_Recv_To_File
+ * @note: The header of the next frame is received in the same chain as the payload of the current one
+ */
+static int64_t Uring_Recv_Registered(SS_Ring *Ring, int Socket, off_t Offset, uint32_t Chunk_Size, uint64_t Limit, int *Error_Code, int *Write_Error)
+{
+    *Error_Code = 0;
+    *Write_Error = 0;
+
+    unsigned char *Raw = Ring->Buffer;                        // Frame header
+    unsigned char *Payload = Ring->Buffer + PACKET_HEADER_SIZE; // Frame payload
+    uint64_t Written = 0;
+    int Have_Header = 0;
+    while (1)
+    {
+        if (!Have_Header)
+        {
+            int err = RecvAll(Socket, Raw, PACKET_HEADER_SIZE);
+            if (err == 0)
+                errno = ECONNRESET;
+            if (err <= 0)
+                return -1;
+        }
+        Have_Header = 0;
+
+        PACKET_HEADER Header;
+        if (DecodeHeader(Raw, &Header) < 0)
+            return -1;
+        if (Header.iType == PACKET_TYPE_END && Header.iLength == 4)
+        {
+            unsigned char Code[4];
+            if (RecvAll(Socket, Code, 4) <= 0)
+                return -1;
+            *Error_Code = (int)(((uint32_t)Code[0] << 24) | ((uint32_t)Code[1] << 16) | ((uint32_t)Code[2] << 8) | Code[3]);
+            return (int64_t)Written;
+        }
+        if (Header.iType != PACKET_TYPE_DATA || Header.iLength > Chunk_Size)
+        {
+            errno = EPROTO;
+            return -1;
+        }
+        if (*Write_Error == 0 && Written + Header.iLength > Limit)
+            *Write_Error = EFBIG;
+
+        // After a write error the rest of the stream is only drained
+        if (*Write_Error)
+        {
+            if (Header.iLength && RecvAll(Socket, Payload, Header.iLength) <= 0)
+                return -1;
+            continue;
+        }
+        if (Header.iLength == 0)
+            continue;
+
+        struct io_uring_sqe *Recv = Uring_Get_Sqe(Ring);
+        struct io_uring_sqe *Write = Uring_Get_Sqe(Ring);
+        struct io_uring_sqe *Next = Uring_Get_Sqe(Ring);
+        Recv->opcode = IORING_OP_RECV;
+        Recv->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        Recv->fd = URING_SLOT_SOCKET;
+        Recv->addr = (uint64_t)(uintptr_t)Payload;
+        Recv->len = Header.iLength;
+        Recv->msg_flags = MSG_WAITALL;
+        Recv->user_data = 0;
+
+        Write->opcode = IORING_OP_WRITE_FIXED;
+        Write->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        Write->fd = URING_SLOT_FILE;
+        Write->addr = (uint64_t)(uintptr_t)Payload;
+        Write->len = Header.iLength;
+        Write->off = Offset + Written;
+        Write->buf_index = 0;
+        Write->user_data = 1;
+
+        // Every DATA frame is followed by another frame (DATA or END)
+        Next->opcode = IORING_OP_RECV;
+        Next->flags = IOSQE_FIXED_FILE;
+        Next->fd = URING_SLOT_SOCKET;
+        Next->addr = (uint64_t)(uintptr_t)Raw;
+        Next->len = PACKET_HEADER_SIZE;
+        Next->msg_flags = MSG_WAITALL;
+        Next->user_data = 2;
+
+        int Results[3];
+        if (Uring_Submit_And_Wait(Ring, 3, Results) < 0)
+            return -1;
+        if (Results[0] != (int)Header.iLength)
+        {
+            errno = Results[0] < 0 ? -Results[0] : ECONNRESET;
+            return -1;
+        }
+        if (Results[1] == (int)Header.iLength)
+            Written += Header.iLength;
+        else
+            *Write_Error = Results[1] < 0 ? -Results[1] : EIO;
+
+        if (Results[2] == PACKET_HEADER_SIZE)
+            Have_Header = 1;
+        else if (Results[2] != -ECANCELED)
+        {
+            errno = Results[2] < 0 ? -Results[2] : ECONNRESET;
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Streams a range of a file as DATA frames
+ * @param Ring: The ring of the worker (NULL for sendfile)
+ * @param Socket: The socket to send on
+ * @param Opcode: The operation the stream belongs to
+ * @param Fd: The file to send from
+ * @param Offset: The offset of the range
+ * @param Length: The length of the range
+ * @param Chunk_Size: The negotiated chunk size
+ * @return: Same as SendFileChunks, the number of bytes of the file sent, -1 if the connection is unusable
+ */
+int64_t Uring_Send_File(SS_Ring *Ring, int Socket, int Opcode, int Fd, off_t Offset, uint64_t Length, uint32_t Chunk_Size)
+{
+    if (Ring == NULL || Ring->Broken || Uring_Register_Files(Ring, Socket, Fd) < 0)
+        return SendFileChunks(Socket, Opcode, Fd, Offset, Length, Chunk_Size);
+
+    int64_t Sent = Uring_Send_Registered(Ring, Socket, Opcode, Fd, Offset, Length, Chunk_Size);
+
+    // Registered files hold a reference, the slots are emptied so that close() really closes them
+    Uring_Register_Files(Ring, -1, -1);
+    return Sent;
+}
+
+/**
+ * @brief Receives the DATA frames of a stream into a file
+ * @param Ring: The ring of the worker (NULL for RecvStreamToFile)
+ * @param Socket: The socket to receive from
+ * @param Fd: The file to write to
+ * @param Offset: The offset in the file to write the stream at
+ * @param Chunk_Size: The negotiated chunk size
+ * @param Limit: The most bytes to be written (STREAM_LENGTH_UNKNOWN for no limit)
+ * @param Error_Code: The error code of the END frame
+ * @param Write_Error: Set to errno if the file could not be written (EFBIG past Limit), 0 otherwise
+ * @param Scratch: Buffer for the fallback (atleast Chunk_Size bytes)
+ * @return: Same as RecvStreamToFile, the number of bytes written, -1 if the connection is unusable
+ */
+int64_t Uring_Recv_To_File(SS_Ring *Ring, int Socket, int Fd, off_t Offset, uint32_t Chunk_Size, uint64_t Limit, int *Error_Code, int *Write_Error, unsigned char *Scratch)
+{
+    if (Ring == NULL || Ring->Broken || Uring_Register_Files(Ring, Socket, Fd) < 0)
+        return RecvStreamToFile(Socket, Fd, Offset, Chunk_Size, Limit, Error_Code, Write_Error, Scratch);
+
+    int64_t Written = Uring_Recv_Registered(Ring, Socket, Offset, Chunk_Size, Limit, Error_Code, Write_Error);
+    Uring_Register_Files(Ring, -1, -1);
+    return Written;
+}
@@ -0,0 +1,48 @@
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "../Protocol.h"
+
+#ifndef SS_USE_IO_URING
+#define SS_USE_IO_URING 1 // Build with -DSS_USE_IO_URING=0 to always use the plain syscalls
+#endif
+#define URING_ENTRIES 32 // Submission queue entries of a ring
+#define URING_BUFFER_SIZE (2 * (STREAM_CHUNK_MAX + PACKET_HEADER_SIZE)) // Fixed buffer, holds atleast two framed chunks
+
+// io_uring instance of a worker, set up with raw syscalls
+typedef struct SS_Ring
+{
+    int Ring_Fd;
+    unsigned Sq_Entries;
+    unsigned *Sq_Head;
+    unsigned *Sq_Tail;
+    unsigned *Sq_Mask;
+    unsigned *Sq_Array;
+    unsigned Sq_Local_Tail; // Tail of the entries filled but not yet published
+    struct io_uring_sqe *Sqes;
+    unsigned *Cq_Head;
+    unsigned *Cq_Tail;
+    unsigned *Cq_Mask;
+    struct io_uring_cqe *Cqes;
+    void *Ring_Map;
+    size_t Ring_Map_Size;
+    size_t Sqes_Size;
+    unsigned char *Buffer; // Registered as fixed buffer 0
+    size_t Buffer_Size;
+    uint32_t Generation;   // Tags the user_data of every batch, completions of an older batch are dropped
+    int Broken;            // Set after io_uring_enter failed for good, the ring is not used again
+    struct statx *Stat;    // STATX result, kept off the stack so a late completion can not land in a dead frame
+}SS_Ring;
+
+SS_Ring *Uring_Init(unsigned char *Buffer, size_t Buffer_Size);
+void Uring_Destroy(SS_Ring *Ring);
+
+// Each of these falls back to the plain syscalls when Ring is NULL (or broken)
+int Uring_Stat(SS_Ring *Ring, const char *Path, struct stat *St);
+int64_t Uring_Send_File(SS_Ring *Ring, int Socket, int Opcode, int Fd, off_t Offset, uint64_t Length, uint32_t Chunk_Size);
+int64_t Uring_Recv_To_File(SS_Ring *Ring, int Socket, int Fd, off_t Offset, uint32_t Chunk_Size, uint64_t Limit, int *Error_Code, int *Write_Error, unsigned char *Scratch);
+
+#endif // __URING_H__
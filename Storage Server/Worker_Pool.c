@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../Protocol.h"
+#include "./Worker_Pool.h"
+
+/**
+ * @brief Thread of a worker, serves the queued sessions one after the other
+ * @param arg: The worker
+ * @return: NULL
+ */
+static void *Worker_Thread(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    while (1)
+    {
+        Client *client = Client_Queue_Pop(worker->Pool);
+        if (Serve_Client_Session(worker, client) == 0)
+            free(client);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Initializes a Worker_Pool Object and starts its workers
+ * @param Worker_Count: The number of workers
+ * @return a pointer to Worker_Pool Object, NULL on failure
+ */
+Worker_Pool *Worker_Pool_Init(int Worker_Count)
+{
+    Worker_Pool *Pool = (Worker_Pool *)malloc(sizeof(Worker_Pool));
+    if (Pool == NULL)
+        return NULL;
+    Pool->Workers = (Worker *)calloc(Worker_Count, sizeof(Worker));
+    if (Pool->Workers == NULL)
+    {
+        free(Pool);
+        return NULL;
+    }
+    Pool->Worker_Count = Worker_Count;
+    Pool->Queue.Head = 0;
+    Pool->Queue.Count = 0;
+    pthread_mutex_init(&Pool->Queue.Mutex, NULL);
+    pthread_cond_init(&Pool->Queue.Not_Empty, NULL);
+    pthread_cond_init(&Pool->Queue.Not_Full, NULL);
+
+    for (int i = 0; i < Worker_Count; i++)
+    {
+        Worker *worker = &Pool->Workers[i];
+        worker->ID = i;
+        worker->Pool = Pool;
+        worker->Buffer = (unsigned char *)malloc(WORKER_BUFFER_SIZE);
+        worker->Ring = Uring_Init(worker->Buffer, WORKER_BUFFER_SIZE);
+        if (worker->Buffer == NULL || pthread_create(&worker->Thread, NULL, Worker_Thread, (void *)worker) != 0)
+        {
+            // Workers already started keep the pool usable, the rest are dropped
+            Uring_Destroy(worker->Ring);
+            free(worker->Buffer);
+            Pool->Worker_Count = i;
+            break;
+        }
+        pthread_detach(worker->Thread);
+    }
+
+    if (Pool->Worker_Count == 0)
+    {
+        free(Pool->Workers);
+        free(Pool);
+        return NULL;
+    }
+    return Pool;
+}
+
+/**
+ * @brief Queues a session for the workers, waits while the queue is full
+ * @param Pool: The worker pool
+ * @param client: The session (owned by the pool from now on)
+ * @return: None
+ */
+void Client_Queue_Push(Worker_Pool *Pool, Client *client)
+{
+    Client_Queue *Queue = &Pool->Queue;
+    pthread_mutex_lock(&Queue->Mutex);
+    while (Queue->Count == CLIENT_QUEUE_SIZE)
+        pthread_cond_wait(&Queue->Not_Full, &Queue->Mutex);
+    Queue->Slots[(Queue->Head + Queue->Count) % CLIENT_QUEUE_SIZE] = client;
+    Queue->Count++;
+    pthread_cond_signal(&Queue->Not_Empty);
+    pthread_mutex_unlock(&Queue->Mutex);
+}
+
+/**
+ * @brief Queues a session for the workers if there is room
+ * @param Pool: The worker pool
+ * @param client: The session
+ * @return: 0 if the session was queued, -1 if the queue is full
+ */
+int Client_Queue_Try_Push(Worker_Pool *Pool, Client *client)
+{
+    Client_Queue *Queue = &Pool->Queue;
+    pthread_mutex_lock(&Queue->Mutex);
+    if (Queue->Count == CLIENT_QUEUE_SIZE)
+    {
+        pthread_mutex_unlock(&Queue->Mutex);
+        return -1;
+    }
+    Queue->Slots[(Queue->Head + Queue->Count) % CLIENT_QUEUE_SIZE] = client;
+    Queue->Count++;
+    pthread_cond_signal(&Queue->Not_Empty);
+    pthread_mutex_unlock(&Queue->Mutex);
+    return 0;
+}
+
+/**
+ * @brief Takes the oldest queued session, waits while the queue is empty
+ * @param Pool: The worker pool
+ * @return: The session
+ */
+Client *Client_Queue_Pop(Worker_Pool *Pool)
+{
+    Client_Queue *Queue = &Pool->Queue;
+    pthread_mutex_lock(&Queue->Mutex);
+    while (Queue->Count == 0)
+        pthread_cond_wait(&Queue->Not_Empty, &Queue->Mutex);
+    Client *client = Queue->Slots[Queue->Head];
+    Queue->Head = (Queue->Head + 1) % CLIENT_QUEUE_SIZE;
+    Queue->Count--;
+    pthread_cond_signal(&Queue->Not_Full);
+    pthread_mutex_unlock(&Queue->Mutex);
+    return client;
+}
+
+/**
+ * @brief Returns the number of sessions waiting for a worker
+ * @param Pool: The worker pool
+ * @return: The number of queued sessions
+ * @note: The count may change as soon as it is returned, it is only a hint
+ */
+int Client_Queue_Waiting(Worker_Pool *Pool)
+{
+    pthread_mutex_lock(&Pool->Queue.Mutex);
+    int Count = Pool->Queue.Count;
+    pthread_mutex_unlock(&Pool->Queue.Mutex);
+    return Count;
+}
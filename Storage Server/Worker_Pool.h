@@ -0,0 +1,63 @@
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <pthread.h>
+#include "./Headers.h"
+#include "./Uring.h"
+#include "./Epoch.h"
+
+#ifndef SS_WORKER_COUNT
+#define SS_WORKER_COUNT 8 // Threads serving client sessions (build with -DSS_WORKER_COUNT=N to change)
+#endif
+#define SS_OTHER_READERS 4 // The main thread, both listeners and the log flusher also read the trie
+#if SS_WORKER_COUNT + SS_OTHER_READERS > EPOCH_MAX_THREADS
+#error "SS_WORKER_COUNT leaves no epoch slot for the listeners and the log flusher, raise EPOCH_MAX_THREADS"
+#endif
+#ifndef CLIENT_QUEUE_SIZE
+#define CLIENT_QUEUE_SIZE 64 // Sessions waiting for a worker, the listener stops accepting while it is full
+#endif
+#define CLIENT_YIELD_TIMEOUT_MS 50 // How long a worker waits on a quiet session before serving a queued one
+#define WORKER_BUFFER_SIZE URING_BUFFER_SIZE // Atleast STREAM_CHUNK_MAX, registered with the worker's ring
+
+// Bounded FIFO of client sessions waiting for a worker
+typedef struct Client_Queue
+{
+    Client *Slots[CLIENT_QUEUE_SIZE];
+    int Head;
+    int Count;
+    pthread_mutex_t Mutex;
+    pthread_cond_t Not_Empty;
+    pthread_cond_t Not_Full;
+}Client_Queue;
+
+struct Worker_Pool;
+
+// A worker thread and the buffer and ring it reuses for every request it serves
+typedef struct Worker
+{
+    int ID;
+    pthread_t Thread;
+    unsigned char *Buffer; // WORKER_BUFFER_SIZE bytes
+    SS_Ring *Ring;         // NULL if io_uring is not available
+    struct Worker_Pool *Pool;
+}Worker;
+
+// Fixed set of workers serving the sessions handed over by the client listener
+typedef struct Worker_Pool
+{
+    Client_Queue Queue;
+    int Worker_Count;
+    Worker *Workers;
+}Worker_Pool;
+
+Worker_Pool *Worker_Pool_Init(int Worker_Count);
+void Client_Queue_Push(Worker_Pool *Pool, Client *client);
+int Client_Queue_Try_Push(Worker_Pool *Pool, Client *client);
+Client *Client_Queue_Pop(Worker_Pool *Pool);
+int Client_Queue_Waiting(Worker_Pool *Pool);
+
+// Serves a session until it ends (returns 0) or is handed back to the queue (returns 1), defined in SS.c
+int Serve_Client_Session(Worker *worker, Client *client);
+int Serve_Client_Request(Worker *worker, Client *client, REQUEST_STRUCT *Client_Request_Struct);
+
+#endif // __WORKER_POOL_H__